@@ -0,0 +1,158 @@
+/**
+ * @file cache-scaling.cpp
+ *
+ * @brief Measure how cache_pool read throughput scales with the number of threads
+ *
+ * A fixed set of grids is inserted to cache, after which 1, 2, 4, ... threads
+ * read random grids from it for a fixed time. Most of the reads are cache
+ * hits; a configurable share of them are inserts of new grids, which take the
+ * exclusive lock of one shard and may evict old grids.
+ *
+ * Build in this directory against a built himan source tree, for example:
+ *
+ *   g++ -std=c++11 -O2 -I../../himan-lib/include -I../../himan-plugins/include \
+ *       cache-scaling.cpp -o cache-scaling \
+ *       -L/usr/lib64/himan-plugins -Wl,-rpath,/usr/lib64/himan-plugins -lcache \
+ *       -lhiman -lboost_thread -lpthread
+ *
+ * Usage: cache-scaling [grids] [grid size] [insert percentage] [seconds per run]
+ *
+ * Defaults are 2000 grids of 10000 values, 5% inserts and 2 seconds per run.
+ * Throughput should grow close to linearly with threads as long as the cache
+ * is not over its limit; with a single lock it flattens after one thread.
+ */
+
+#include "cache.h"
+#include "info.h"
+#include "point_list.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace himan;
+using namespace himan::plugin;
+
+namespace
+{
+unique_key Key(size_t i)
+{
+	return unique_key(1, 0, static_cast<time_t>(i / 100) * 3600, "T-K", kHybrid, static_cast<double>(i % 100), -1,
+	                  kDeterministic, -1);
+}
+
+std::shared_ptr<info<double>> Grid(size_t gridSize)
+{
+	auto ret = std::make_shared<info<double>>(forecast_type(kDeterministic),
+	                                          forecast_time("2020-01-01 00:00:00", "2020-01-01 00:00:00"),
+	                                          level(kHybrid, 1), param("T-K"));
+
+	auto b = std::make_shared<base<double>>();
+	b->grid = std::shared_ptr<grid>(new point_list());
+
+	ret->Create(b);
+	ret->Data().Resize(gridSize, 1, 1);
+	ret->Data().Fill(273.15);
+
+	return ret;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+	const size_t grids = (argc > 1) ? std::stoul(argv[1]) : 2000;
+	const size_t gridSize = (argc > 2) ? std::stoul(argv[2]) : 10000;
+	const unsigned insertPercentage = (argc > 3) ? static_cast<unsigned>(std::stoul(argv[3])) : 5;
+	const double seconds = (argc > 4) ? std::stod(argv[4]) : 2.0;
+
+	auto pool = cache_pool::Instance();
+
+	// Inserted grids share one data buffer, so that the benchmark measures
+	// locking and lookups and not memory bandwidth
+
+	const auto data = Grid(gridSize);
+
+	for (size_t i = 0; i < grids; i++)
+	{
+		pool->Insert<double>(Key(i), data, false);
+	}
+
+	// Cache is allowed to grow by the number of inserted grids, after which
+	// inserts start to evict
+
+	pool->CacheLimit(static_cast<int>(grids + grids / 2));
+
+	const unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::cout << "grids: " << grids << ", grid size: " << gridSize << ", inserts: " << insertPercentage << "%"
+	          << std::endl;
+	std::cout << "threads  operations/s  speedup" << std::endl;
+
+	double single = 0;
+	std::atomic<size_t> nextKey(grids);
+
+	for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		std::atomic<bool> stop(false);
+		std::vector<size_t> counts(threads, 0);
+		std::vector<std::thread> workers;
+
+		for (unsigned t = 0; t < threads; t++)
+		{
+			workers.emplace_back([&, t]() {
+				std::mt19937 gen(t);
+				std::uniform_int_distribution<size_t> key(0, grids - 1);
+				std::uniform_int_distribution<unsigned> percentage(0, 99);
+
+				size_t count = 0;
+
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					if (percentage(gen) < insertPercentage)
+					{
+						pool->Insert<double>(Key(nextKey++), data, false);
+					}
+					else
+					{
+						pool->GetInfo<double>(Key(key(gen)), true);
+					}
+
+					count++;
+				}
+
+				counts[t] = count;
+			});
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		stop = true;
+
+		for (auto& w : workers)
+		{
+			w.join();
+		}
+
+		size_t total = 0;
+
+		for (size_t c : counts)
+		{
+			total += c;
+		}
+
+		const double rate = static_cast<double>(total) / seconds;
+
+		if (threads == 1)
+		{
+			single = rate;
+		}
+
+		std::cout.width(7);
+		std::cout << threads << "  ";
+		std::cout.width(12);
+		std::cout << static_cast<size_t>(rate) << "  " << rate / single << std::endl;
+	}
+
+	return 0;
+}
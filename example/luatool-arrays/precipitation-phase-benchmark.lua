@@ -0,0 +1,76 @@
+--
+-- Compare the loop version of himan-scripts/precipitation-phase.lua to the
+-- same calculation written with arrays and whole-grid functions.
+--
+-- Both versions are run several times for the same input data. The timings
+-- and the largest difference between the results are logged, and the result
+-- of the array version is written to file.
+--
+-- Usage: himan -f precipitation-phase-benchmark.json -d 4 [source data]
+--
+
+local rounds = 10
+
+local T = luatool:FetchWithType(current_time, level(HPLevelType.kHeight, 2), param("T-K"), current_forecast_type)
+local RH = luatool:FetchWithType(current_time, level(HPLevelType.kHeight, 2), param("RH-PRCNT"), current_forecast_type)
+
+local Ta = luatool:FetchArrayWithType(current_time, level(HPLevelType.kHeight, 2), param("T-K"), current_forecast_type)
+local RHa = luatool:FetchArrayWithType(current_time, level(HPLevelType.kHeight, 2), param("RH-PRCNT"), current_forecast_type)
+
+if not T or not RH then
+  logger:Error("T-K or RH-PRCNT not found")
+  return
+end
+
+-- Loop version, as in precipitation-phase.lua
+
+local function loop_version()
+  local res = {}
+
+  for i=1, #T do
+    res[i] = 1 / (1 + math.exp(22 - 2.7 * (T[i] - 273.15) - 0.2 * RH[i]))
+  end
+
+  result:SetValues(res)
+  return res
+end
+
+-- Array version
+
+local function array_version()
+  local res = 1 / (1 + Exp(22 - 2.7 * KelvinToCelsius(Ta) - 0.2 * RHa))
+
+  result:SetValues(res)
+  return res
+end
+
+local function measure(f)
+  local start = os.clock()
+  local res
+
+  for i=1, rounds do
+    res = f()
+  end
+
+  return res, (os.clock() - start) * 1000 / rounds
+end
+
+local loopRes, loopTime = measure(loop_version)
+local arrayRes, arrayTime = measure(array_version)
+
+local maxDiff = 0
+
+for i=1, #loopRes do
+  local diff = math.abs(loopRes[i] - arrayRes:Get(i))
+
+  if diff > maxDiff then
+    maxDiff = diff
+  end
+end
+
+logger:Info(string.format("grid size %d: loop %.1f ms, array %.1f ms (%.1fx), largest difference %g",
+  #loopRes, loopTime, arrayTime, loopTime / arrayTime, maxDiff))
+
+result:SetParam(param("PRECPHASE-0TO1"))
+result:SetValues(arrayRes)
+luatool:WriteToFile(result)
@@ -0,0 +1,133 @@
+#!/bin/sh
+#
+# Run all lua scripts of a directory (by default himan-scripts) with both
+# the regular lua build and the LuaJIT build of luatool (scons --luajit-build),
+# and compare the results and the running times.
+#
+# Usage: compare-engines.sh <template configuration> <lua plugin dir> <luajit plugin dir> [other himan options]
+#
+# Template is a himan configuration where @LUAFILE@ is replaced with the script
+# and @ENGINE@ with the engine name; see template.json. Paths in the template
+# and in himan options should be absolute, as himan is run in a separate
+# directory for each script and engine. For example:
+#
+#   ./compare-engines.sh $PWD/template.json \
+#       $HOME/himan/himan-plugins/build/release \
+#       $HOME/himan/himan-plugins/build/release/luajit
+#
+# Results go to directory compare-engines (SCRIPTS and WORKDIR environment
+# variables change the script and result directories). Output grib files of
+# the two engines are compared with grib_compare; TOLERANCE sets the allowed
+# absolute difference of values (default: 0, values must be identical).
+
+set -e
+
+if [ $# -lt 3 ]; then
+	echo "Usage: $0 <template configuration> <lua plugin dir> <luajit plugin dir> [other himan options]" >&2
+	exit 1
+fi
+
+HIMAN=${HIMAN:-himan}
+SCRIPTS=${SCRIPTS:-$(cd "$(dirname "$0")/../../himan-scripts" && pwd)}
+WORKDIR=${WORKDIR:-compare-engines}
+TOLERANCE=${TOLERANCE:-0}
+
+template=$1
+luadir=$2
+jitdir=$3
+shift 3
+
+mkdir -p "$WORKDIR"
+WORKDIR=$(cd "$WORKDIR" && pwd)
+
+# Run one script with one engine; print the running time in seconds, or
+# FAILED if himan did not finish successfully
+
+run() {
+	script=$1
+	engine=$2
+	plugindir=$3
+	shift 3
+
+	name=$(basename "$script" .lua)
+	dir="$WORKDIR/$name/$engine"
+
+	rm -rf "$dir"
+	mkdir -p "$dir"
+
+	sed -e "s|@LUAFILE@|$script|" -e "s|@ENGINE@|$engine|" "$template" > "$dir/$name.json"
+
+	start=$(date +%s.%N)
+
+	if (cd "$dir" && HIMAN_LIBRARY_PATH="$plugindir${HIMAN_LIBRARY_PATH:+:$HIMAN_LIBRARY_PATH}" \
+		"$HIMAN" -f "$name.json" -d 4 "$@" > himan.log 2>&1); then
+		end=$(date +%s.%N)
+		echo "$start $end" | awk '{ printf "%.2f", $2 - $1 }'
+	else
+		echo "FAILED"
+	fi
+}
+
+# Compare output files of both engines
+
+compare() {
+	name=$1
+	luaout="$WORKDIR/$name/lua"
+	jitout="$WORKDIR/$name/luajit"
+
+	files=$(cd "$luaout" && ls | grep -v '\.json$\|\.log$' || true)
+
+	if [ -z "$files" ]; then
+		echo "no output"
+		return
+	fi
+
+	for f in $files; do
+		if [ ! -f "$jitout/$f" ]; then
+			echo "missing $f"
+			return
+		fi
+
+		if ! grib_compare -A "$TOLERANCE" "$luaout/$f" "$jitout/$f" > "$WORKDIR/$name/compare.log" 2>&1; then
+			echo "DIFFERENT (see $name/compare.log)"
+			return
+		fi
+	done
+
+	echo "same"
+}
+
+printf "%-40s %-10s %-10s %-8s %s\n" "script" "lua (s)" "luajit (s)" "speedup" "result"
+
+status=0
+
+for script in "$SCRIPTS"/*.lua; do
+	name=$(basename "$script" .lua)
+
+	luatime=$(run "$script" lua "$luadir" "$@")
+	jittime=$(run "$script" luajit "$jitdir" "$@")
+
+	if [ "$luatime" = "FAILED" ] || [ "$jittime" = "FAILED" ]; then
+		speedup="-"
+
+		if [ "$luatime" = "$jittime" ]; then
+			# Script does not run with this configuration at all
+			result="failed with both engines"
+		else
+			result="FAILED with one engine"
+			status=1
+		fi
+	else
+		speedup=$(echo "$luatime $jittime" | awk '{ if ($2 > 0) printf "%.2f", $1 / $2; else print "-" }')
+		result=$(compare "$name")
+
+		case "$result" in
+			same|"no output") ;;
+			*) status=1 ;;
+		esac
+	fi
+
+	printf "%-40s %-10s %-10s %-8s %s\n" "$name" "$luatime" "$jittime" "$speedup" "$result"
+done
+
+exit $status
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Measure how a himan run scales with the number of CPU sockets (NUMA nodes),
+# with and without option --numa. The run is restricted to the cores of the
+# first N nodes with taskset, and himan sizes its thread pool to those cores.
+#
+# Usage: numa-scaling.sh <configuration file> [other himan options]
+#
+# For example, with a hybrid_height or cape configuration and source data
+# from a local file:
+#
+#   ./numa-scaling.sh hybrid_height.json --no-database --param-file params.txt source.grib
+#
+# Input data should be read from local files (or the page cache) so that the
+# timings measure calculation and not I/O; run the script twice and use the
+# second result. Output of himan is appended to numa-scaling.log.
+
+set -e
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 <configuration file> [other himan options]" >&2
+	exit 1
+fi
+
+HIMAN=${HIMAN:-himan}
+
+nodes=$(ls -d /sys/devices/system/node/node[0-9]* 2>/dev/null | wc -l)
+
+if [ "$nodes" -eq 0 ]; then
+	nodes=1
+	allcpus="0-$(($(nproc --all) - 1))"
+fi
+
+conf=$1
+shift
+
+run() {
+	cpuset=$1
+	shift
+	start=$(date +%s.%N)
+	taskset -c "$cpuset" "$HIMAN" -f "$conf" "$@" >> numa-scaling.log 2>&1
+	end=$(date +%s.%N)
+	echo "$start $end" | awk '{ printf "%.2f", $2 - $1 }'
+}
+
+printf "%-6s %-8s %-12s %-12s\n" "nodes" "cores" "default (s)" "--numa (s)"
+
+cpus=""
+n=0
+
+while [ $n -lt $nodes ]; do
+	if [ -n "$allcpus" ]; then
+		cpus=$allcpus
+	else
+		cpus="${cpus:+$cpus,}$(cat /sys/devices/system/node/node$n/cpulist)"
+	fi
+
+	n=$((n + 1))
+	cores=$(taskset -c "$cpus" nproc)
+
+	default=$(run "$cpus" "$@")
+	numa=$(run "$cpus" --numa "$@")
+
+	printf "%-6s %-8s %-12s %-12s\n" "$n" "$cores" "$default" "$numa"
+done
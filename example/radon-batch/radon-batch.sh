@@ -0,0 +1,103 @@
+#!/bin/sh
+#
+# Check that batched radon writes (RADON_BATCH_SIZE) produce the same grid
+# rows as writing each grid separately. A throwaway PostgreSQL server is
+# started in a temporary directory and loaded with a radon schema, himan is
+# run against it once with RADON_BATCH_SIZE=1 and once with the default batch
+# size, and the rows of all tables listed in as_grid are compared.
+#
+# Usage: radon-batch.sh [himan options]
+#
+# Without options the seaicing example is run with radon-batch.json:
+#
+#   cd example/radon-batch
+#   ./radon-batch.sh
+#
+# The database is created from radon-fixture.sql, which has the radon tables
+# that himan uses and the metadata (producer, geometry, parameters, levels,
+# as_grid) for radon-batch.json. To use another configuration, give the sql
+# file that creates its metadata in RADON_SQL and the himan options as
+# arguments:
+#
+#   RADON_SQL=radon.sql ./radon-batch.sh -f other.json other.grib
+#
+# PostgreSQL server binaries (initdb, pg_ctl) must be in PATH. Output of himan
+# is appended to radon-batch.log.
+
+set -e
+
+HIMAN=${HIMAN:-himan}
+
+dir=$(dirname "$(readlink -f "$0")")
+sql=$(readlink -f "${RADON_SQL:-$dir/radon-fixture.sql}")
+
+if [ $# -eq 0 ]; then
+	set -- -f "$dir/radon-batch.json" "$dir/../seaicing/ICING-N_height_0_ll_150_150_0_003.grib"
+fi
+
+tmpdir=$(mktemp -d)
+port=${RADON_PORT:-55432}
+
+cleanup() {
+	pg_ctl -D "$tmpdir/data" -m immediate stop >/dev/null 2>&1 || true
+	rm -rf "$tmpdir"
+}
+
+trap cleanup EXIT
+
+initdb -D "$tmpdir/data" -U postgres -A trust >/dev/null
+pg_ctl -D "$tmpdir/data" -o "-p $port -k $tmpdir -c listen_addresses=localhost" -l "$tmpdir/postgres.log" -w start >/dev/null
+
+psql="psql -h localhost -p $port -U postgres -v ON_ERROR_STOP=1 -q"
+
+$psql -c "CREATE ROLE wetodb LOGIN PASSWORD 'wetodb' SUPERUSER"
+
+export RADON_HOSTNAME=localhost
+export RADON_PORT=$port
+export RADON_WETODB_PASSWORD=wetodb
+
+columns="producer_id, analysis_time, geometry_id, param_id, level_id, level_value, level_value2, forecast_period, \
+forecast_type_id, forecast_type_value, file_location, file_server, file_format_id, file_protocol_id, \
+message_no, byte_offset, byte_length"
+
+run() {
+	name=$1
+	batch=$2
+	shift 2
+
+	$psql -c "CREATE DATABASE $name"
+	$psql -d "$name" -f "$sql"
+
+	export RADON_DATABASENAME=$name
+
+	if [ -n "$batch" ]; then
+		export RADON_BATCH_SIZE=$batch
+	else
+		unset RADON_BATCH_SIZE
+	fi
+
+	echo "RADON_BATCH_SIZE=${batch:-default}" >>radon-batch.log
+	$HIMAN "$@" >>radon-batch.log 2>&1
+
+	for table in $($psql -d "$name" -At -c "SELECT DISTINCT schema_name || '.' || table_name FROM as_grid ORDER BY 1"); do
+		echo "$table"
+		$psql -d "$name" -At -c "SELECT $columns FROM $table ORDER BY $columns"
+	done >"$tmpdir/$name.txt"
+}
+
+run single 1 "$@"
+run batched "" "$@"
+
+rows=$(grep -c '|' "$tmpdir/batched.txt" || true)
+
+if [ "$rows" -eq 0 ]; then
+	echo "FAIL: no grid rows were written, see radon-batch.log" >&2
+	exit 1
+fi
+
+if diff "$tmpdir/single.txt" "$tmpdir/batched.txt"; then
+	echo "OK: $rows rows, batched and single row writes are identical"
+else
+	echo "FAIL: batched and single row writes differ" >&2
+	exit 1
+fi
@@ -0,0 +1,187 @@
+--
+-- Minimal radon database for radon-batch.sh: the part of the radon schema
+-- that himan reads and writes when it stores the result of radon-batch.json
+-- (seaicing for producer 999999 on one latitude-longitude geometry).
+--
+-- Only the tables and columns that himan and the radon client library use
+-- for these lookups are created. If the client library of an installation
+-- needs objects that are missing here, create the schema from a real radon
+-- database instead (pg_dump --schema-only) and load the INSERT statements of
+-- this file after it.
+--
+
+CREATE TABLE producer_class (
+	id integer PRIMARY KEY,
+	name text NOT NULL
+);
+
+CREATE TABLE fmi_producer (
+	id integer PRIMARY KEY,
+	name text NOT NULL,
+	class_id integer NOT NULL REFERENCES producer_class (id),
+	description text,
+	hours_to_keep integer
+);
+
+CREATE TABLE producer_grib (
+	producer_id integer NOT NULL REFERENCES fmi_producer (id),
+	centre integer NOT NULL,
+	ident integer NOT NULL,
+	type_id integer NOT NULL DEFAULT 1
+);
+
+CREATE TABLE producer_meta (
+	producer_id integer NOT NULL REFERENCES fmi_producer (id),
+	attribute text NOT NULL,
+	value text NOT NULL
+);
+
+CREATE TABLE geom (
+	id integer PRIMARY KEY,
+	name text NOT NULL UNIQUE,
+	projection_id integer NOT NULL,
+	ni integer NOT NULL,
+	nj integer NOT NULL,
+	first_lat double precision NOT NULL,
+	first_lon double precision NOT NULL,
+	di double precision NOT NULL,
+	dj double precision NOT NULL,
+	scanning_mode text NOT NULL
+);
+
+CREATE VIEW geom_v AS
+	SELECT id, id AS geometry_id, name, name AS geometry_name, projection_id, ni, nj, first_lat, first_lon, di, dj,
+	       scanning_mode
+	FROM geom;
+
+CREATE TABLE level (
+	id integer PRIMARY KEY,
+	name text NOT NULL UNIQUE
+);
+
+CREATE TABLE level_grib1 (
+	level_id integer NOT NULL REFERENCES level (id),
+	producer_id integer NOT NULL REFERENCES fmi_producer (id),
+	grib_level_id integer NOT NULL
+);
+
+CREATE TABLE level_grib2 (
+	level_id integer NOT NULL REFERENCES level (id),
+	producer_id integer NOT NULL REFERENCES fmi_producer (id),
+	grib_level_id integer NOT NULL
+);
+
+CREATE TABLE param (
+	id integer PRIMARY KEY,
+	name text NOT NULL UNIQUE,
+	version integer NOT NULL DEFAULT 1,
+	interpolation_id integer NOT NULL DEFAULT 1
+);
+
+CREATE TABLE param_grib1 (
+	producer_id integer NOT NULL REFERENCES fmi_producer (id),
+	table_version integer NOT NULL,
+	number integer NOT NULL,
+	timerange_indicator integer NOT NULL DEFAULT 0,
+	level_id integer REFERENCES level (id),
+	level_value double precision,
+	param_id integer NOT NULL REFERENCES param (id)
+);
+
+CREATE TABLE param_grib2 (
+	producer_id integer NOT NULL REFERENCES fmi_producer (id),
+	discipline integer NOT NULL,
+	category integer NOT NULL,
+	number integer NOT NULL,
+	level_id integer REFERENCES level (id),
+	level_value double precision,
+	type_of_statistical_processing integer,
+	param_id integer NOT NULL REFERENCES param (id)
+);
+
+-- Data set definitions: which table has the grids of a producer, geometry and
+-- analysis time
+
+CREATE TABLE as_grid (
+	producer_id integer NOT NULL REFERENCES fmi_producer (id),
+	analysis_time timestamp with time zone NOT NULL,
+	geometry_id integer NOT NULL REFERENCES geom (id),
+	schema_name text NOT NULL,
+	table_name text NOT NULL,
+	partition_name text NOT NULL,
+	record_count integer NOT NULL DEFAULT 0,
+	PRIMARY KEY (producer_id, analysis_time, geometry_id)
+);
+
+CREATE VIEW as_grid_v AS
+	SELECT a.producer_id, a.analysis_time, a.geometry_id, g.name AS geometry_name, a.schema_name, a.table_name,
+	       a.partition_name, a.record_count
+	FROM as_grid a, geom g
+	WHERE a.geometry_id = g.id;
+
+CREATE SCHEMA data;
+
+-- Unique key is the one that himan uses for batched inserts (ON CONFLICT)
+
+CREATE TABLE data.grid_999999 (
+	producer_id integer NOT NULL,
+	analysis_time timestamp with time zone NOT NULL,
+	geometry_id integer NOT NULL,
+	param_id integer NOT NULL,
+	level_id integer NOT NULL,
+	level_value double precision NOT NULL,
+	level_value2 double precision NOT NULL DEFAULT -1,
+	forecast_period interval NOT NULL,
+	forecast_type_id integer NOT NULL,
+	forecast_type_value double precision NOT NULL DEFAULT -1,
+	file_location text NOT NULL,
+	file_server text NOT NULL,
+	file_format_id integer NOT NULL,
+	file_protocol_id integer NOT NULL DEFAULT 1,
+	message_no integer,
+	byte_offset bigint,
+	byte_length bigint,
+	last_updated timestamp with time zone NOT NULL DEFAULT now(),
+	UNIQUE (producer_id, analysis_time, geometry_id, param_id, level_id, level_value, level_value2, forecast_period,
+	        forecast_type_id, forecast_type_value)
+);
+
+-- Metadata for radon-batch.json
+
+INSERT INTO producer_class (id, name) VALUES (1, 'GRID');
+
+INSERT INTO fmi_producer (id, name, class_id, description, hours_to_keep)
+	VALUES (999999, 'HIMANTEST', 1, 'Producer for radon-batch.sh', 24);
+
+INSERT INTO producer_grib (producer_id, centre, ident, type_id) VALUES (999999, 86, 255, 1);
+
+INSERT INTO producer_meta (producer_id, attribute, value) VALUES (999999, 'last hybrid level number', '65');
+
+-- 150 x 150 points over 5,45,30,65 as in ../seaicing/seaicing.json
+
+INSERT INTO geom (id, name, projection_id, ni, nj, first_lat, first_lon, di, dj, scanning_mode)
+	VALUES (1, 'RADONBATCH', 1, 150, 150, 45, 5, 25. / 149, 20. / 149, '+x+y');
+
+INSERT INTO level (id, name) VALUES (1, 'GROUND'), (2, 'PRESSURE'), (3, 'HYBRID'), (6, 'HEIGHT');
+
+INSERT INTO level_grib1 (level_id, producer_id, grib_level_id)
+	VALUES (1, 999999, 1), (2, 999999, 100), (3, 999999, 109), (6, 999999, 105);
+
+INSERT INTO level_grib2 (level_id, producer_id, grib_level_id)
+	VALUES (1, 999999, 1), (2, 999999, 100), (3, 999999, 105), (6, 999999, 103);
+
+INSERT INTO param (id, name) VALUES (4, 'T-K'), (186, 'TG-K'), (20, 'FF-MS'), (480, 'ICING-N');
+
+-- Input parameters as in ../seaicing/param-file.txt (ECMWF table 128: 2t, t,
+-- ws), and the output parameter
+
+INSERT INTO param_grib1 (producer_id, table_version, number, level_id, level_value, param_id)
+	VALUES (999999, 128, 167, NULL, NULL, 4), (999999, 128, 130, NULL, NULL, 186), (999999, 128, 10, NULL, NULL, 20),
+	       (999999, 203, 100, NULL, NULL, 480);
+
+INSERT INTO param_grib2 (producer_id, discipline, category, number, level_id, level_value, param_id)
+	VALUES (999999, 0, 0, 0, NULL, NULL, 4), (999999, 0, 0, 17, NULL, NULL, 186), (999999, 0, 2, 1, NULL, NULL, 20),
+	       (999999, 0, 0, 2, NULL, NULL, 480);
+
+INSERT INTO as_grid (producer_id, analysis_time, geometry_id, schema_name, table_name, partition_name, record_count)
+	VALUES (999999, '2017-04-05 00:00:00+00', 1, 'data', 'grid_999999', 'grid_999999', 0);
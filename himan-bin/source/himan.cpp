@@ -14,12 +14,16 @@
 #include "logger.h"
 #include "plugin_factory.h"
 #include "radon.h"
+#include "s3.h"
 #include "statistics.h"
+#include "thread_pool.h"
 #include "timer.h"
 #include "util.h"
 #include <boost/program_options.hpp>
+#include <algorithm>
 #include <future>
 #include <iostream>
+#include <mutex>
 #include <vector>
 
 using namespace himan;
@@ -193,6 +197,11 @@ void UpdateSSState(const shared_ptr<plugin_configuration>& pc)
 	log.Debug("Update of ss_state: " + to_string(inserts) + " inserts, " + to_string(updates) + " updates");
 }
 
+// Protects plugin timings, statistics output and ss_state updates when
+// plugins are executed concurrently
+
+mutex pluginResultMutex;
+
 void ExecutePlugin(const shared_ptr<plugin_configuration>& pc, vector<plugin_timing>& pluginTimes)
 {
 	timer aTimer(true);
@@ -218,6 +227,8 @@ void ExecutePlugin(const shared_ptr<plugin_configuration>& pc, vector<plugin_tim
 		exit(1);
 	}
 
+	lock_guard<mutex> lock(pluginResultMutex);
+
 	if (pc->StatisticsEnabled())
 	{
 		aTimer.Stop();
@@ -244,6 +255,41 @@ void ExecutePlugin(const shared_ptr<plugin_configuration>& pc, vector<plugin_tim
 #endif
 }
 
+/**
+ * @brief Find the plugins that must finish before plugin at given index can start
+ *
+ * If plugin has declared its dependencies with 'depends_on', it depends on all
+ * earlier plugins with a matching id. Otherwise it depends on all earlier plugins
+ * that are not marked async, which retains the traditional serialized execution.
+ */
+
+vector<size_t> Dependencies(const vector<shared_ptr<plugin_configuration>>& plugins, size_t index)
+{
+	const auto& pc = plugins[index];
+	vector<size_t> ret;
+
+	for (size_t j = 0; j < index; j++)
+	{
+		const auto& other = plugins[j];
+
+		if (pc->DependenciesDeclared())
+		{
+			const auto& deps = pc->DependsOn();
+
+			if (find(deps.begin(), deps.end(), other->Id()) != deps.end())
+			{
+				ret.push_back(j);
+			}
+		}
+		else if (!other->AsyncExecution())
+		{
+			ret.push_back(j);
+		}
+	}
+
+	return ret;
+}
+
 int main(int argc, char** argv)
 {
 	shared_ptr<configuration> conf;
@@ -287,33 +333,89 @@ int main(int argc, char** argv)
 
 	aLogger.Debug("Processqueue size: " + std::to_string(plugins.size()));
 
-	vector<future<void>> asyncs;
+	// Calculations of all concurrently executed plugins share one pool of threads
+
+	if (conf->ThreadPoolSize() != -1)
+	{
+		thread_pool::Instance()->Size(static_cast<size_t>(conf->ThreadPoolSize()));
+	}
+
+	thread_pool::Instance()->NumaPlacement(conf->NumaPlacement());
+
+	// Process queue is executed as a dependency graph: each plugin is started
+	// as soon as the plugins it depends on have finished.
+
+	vector<shared_future<void>> tasks;
 	vector<plugin_timing> pluginTimes;
 
-	while (plugins.size() > 0)
+	for (size_t i = 0; i < plugins.size(); i++)
 	{
-		auto pc = plugins[0];
+		const auto pc = plugins[i];
+		const auto dependencies = Dependencies(plugins, i);
+
+		vector<shared_future<void>> waitFor;
+		string waitList;
 
-		plugins.erase(plugins.begin());
+		for (size_t j : dependencies)
+		{
+			waitFor.push_back(tasks[j]);
+			waitList += plugins[j]->Id() + "#" + to_string(j) + " ";
+		}
 
 		if (pc->AsyncExecution())
 		{
 			aLogger.Info("Asynchronous launch for " + pc->Name());
-			asyncs.push_back(
-			    async(launch::async,
-			          [&pluginTimes](shared_ptr<plugin_configuration> _pc) { ExecutePlugin(_pc, pluginTimes); }, pc));
-
-			continue;
 		}
 
-		ExecutePlugin(pc, pluginTimes);
+		aLogger.Debug("Plugin " + pc->Id() + "#" + to_string(i) + " " +
+		              (waitList.empty() ? "has no dependencies" : "waits for: " + waitList));
+
+		tasks.push_back(async(launch::async,
+		                      [&pluginTimes](shared_ptr<plugin_configuration> _pc,
+		                                     vector<shared_future<void>> _waitFor) {
+			                      for (auto& fut : _waitFor)
+			                      {
+				                      fut.wait();
+			                      }
+
+			                      ExecutePlugin(_pc, pluginTimes);
+		                      },
+		                      pc, waitFor)
+		                    .share());
 	}
 
-	for (auto& fut : asyncs)
+	for (auto& fut : tasks)
 	{
 		fut.wait();
 	}
 
+	// Objects written to S3 in parts become visible only after they are completed
+
+	try
+	{
+		s3::Flush();
+	}
+	catch (const std::exception& e)
+	{
+		aLogger.Fatal(e.what());
+		exit(1);
+	}
+
+	// Write radon rows that were held until their objects were complete
+
+	if (conf->DatabaseType() == kRadon)
+	{
+		try
+		{
+			GET_PLUGIN(radon)->Flush();
+		}
+		catch (const std::exception& e)
+		{
+			aLogger.Fatal(e.what());
+			exit(1);
+		}
+	}
+
 	if (!conf->StatisticsLabel().empty())
 	{
 		// bubble sort
@@ -482,6 +584,8 @@ shared_ptr<configuration> ParseCommandLine(int argc, char** argv)
 	string outfileCompression;
 	string confFile, paramFile;
 	string statisticsLabel;
+	string cacheLimitBytes;
+	string interpolationCacheDir;
 	vector<string> auxFiles;
 #ifdef HAVE_CUDA
 	short int cudaDeviceId = 0;
@@ -491,6 +595,9 @@ shared_ptr<configuration> ParseCommandLine(int argc, char** argv)
 
 	int logLevel = 0;
 	short int threadCount = -1;
+	short int writeThreadCount = 0;
+	short int prefetchDistance = 1;
+	short int threadPoolSize = -1;
 
 	// clang-format off
 
@@ -502,6 +609,10 @@ shared_ptr<configuration> ParseCommandLine(int argc, char** argv)
 		("configuration-file,f", po::value(&confFile), "configuration file")
 		("auxiliary-files,a", po::value<vector<string>>(&auxFiles), "file(s) containing source data for calculation")
 		("threads,j", po::value(&threadCount), "number of started threads")
+		("write-threads", po::value(&writeThreadCount), "number of threads writing calculated data in the background (default: 0, calculating threads write)")
+		("prefetch-distance", po::value(&prefetchDistance), "number of grids whose input data plugins read ahead of calculation (default: 1)")
+		("thread-pool-size", po::value(&threadPoolSize), "number of worker threads shared by all plugins (default: number of cores available to the process)")
+		("numa", "pin worker threads to cores NUMA node by node, so that grids are allocated from the node of the thread that uses them")
 		("list-plugins,l", "list all defined plugins")
 		("debug-level,d", po::value(&logLevel), "set log level: 0(fatal) 1(error) 2(warning) 3(info) 4(debug) 5(trace)")
 		("statistics,s", po::value(&statisticsLabel)->implicit_value("Himan"), "record statistics information")
@@ -511,10 +622,15 @@ shared_ptr<configuration> ParseCommandLine(int argc, char** argv)
 		("no-cuda", "disable all cuda extensions")
 		("no-cuda-packing", "disable cuda packing of grib data")
 		("no-cuda-unpacking", "disable cuda unpacking of grib data")
+#else
+		("packed-cache", "keep simple packed grids packed in cache and unpack them when they are read")
 #endif
 		("no-database", "disable database access")
 		("param-file", po::value(&paramFile), "parameter definition file for no-database mode (syntax: shortName,paramName)")
 		("no-auxiliary-file-full-cache-read", "disable the initial reading of all auxiliary files to cache")
+		("auxiliary-file-index", "store the message index of auxiliary files next to the files and reuse it in later runs")
+		("cache-limit-bytes", po::value(&cacheLimitBytes), "maximum size of cache in bytes, suffixes K, M, G and T are allowed (for example: 16G)")
+		("interpolation-cache-dir", po::value(&interpolationCacheDir), "directory where interpolation weights are stored and shared between runs")
 		("no-ss_state-update,X", "do not update ss_state table information")
 		("no-statistics-upload", "do not upload statistics to database")
 	;
@@ -534,6 +650,30 @@ shared_ptr<configuration> ParseCommandLine(int argc, char** argv)
 		conf->ThreadCount(threadCount);
 	}
 
+	if (writeThreadCount < 0)
+	{
+		cerr << "Invalid number of write threads: " << writeThreadCount << endl;
+		exit(1);
+	}
+
+	conf->WriteThreadCount(writeThreadCount);
+
+	if (prefetchDistance < 1)
+	{
+		cerr << "Invalid prefetch distance: " << prefetchDistance << endl;
+		exit(1);
+	}
+
+	conf->PrefetchDistance(prefetchDistance);
+
+	if (threadPoolSize == 0 || threadPoolSize < -1)
+	{
+		cerr << "Invalid thread pool size: " << threadPoolSize << endl;
+		exit(1);
+	}
+
+	conf->ThreadPoolSize(threadPoolSize);
+
 	if (auxFiles.size())
 	{
 		conf->AuxiliaryFiles(auxFiles);
@@ -764,9 +904,44 @@ shared_ptr<configuration> ParseCommandLine(int argc, char** argv)
 		conf->StatisticsLabel(statisticsLabel);
 	}
 
+#ifndef HAVE_CUDA
+	if (opt.count("packed-cache"))
+	{
+		conf->UsePackedCache(true);
+	}
+#endif
+
 	if (opt.count("no-auxiliary-file-full-cache-read"))
 	{
 		conf->ReadAllAuxiliaryFilesToCache(false);
 	}
+
+	if (opt.count("auxiliary-file-index"))
+	{
+		conf->StoreAuxiliaryFileIndex(true);
+	}
+
+	if (opt.count("numa"))
+	{
+		conf->NumaPlacement(true);
+	}
+
+	if (!cacheLimitBytes.empty())
+	{
+		try
+		{
+			conf->CacheLimitBytes(util::ParseByteSize(cacheLimitBytes));
+		}
+		catch (const exception& e)
+		{
+			cerr << "Invalid value for cache-limit-bytes: " << cacheLimitBytes << endl;
+			exit(1);
+		}
+	}
+
+	if (!interpolationCacheDir.empty())
+	{
+		conf->InterpolationCacheDirectory(interpolationCacheDir);
+	}
 	return conf;
 }
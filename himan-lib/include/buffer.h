@@ -3,6 +3,8 @@
 
 namespace himan
 {
+// Memory allocated with malloc(), owned by the buffer. Buffer can be moved
+// but not copied, so that the memory is freed only once.
 struct buffer
 {
         unsigned char* data;
@@ -10,6 +12,25 @@ struct buffer
         buffer() : data(0), length(0)
         {
         }
+        buffer(const buffer&) = delete;
+        buffer& operator=(const buffer&) = delete;
+        buffer(buffer&& other) noexcept : data(other.data), length(other.length)
+        {
+                other.data = 0;
+                other.length = 0;
+        }
+        buffer& operator=(buffer&& other) noexcept
+        {
+                if (this != &other)
+                {
+                        free(data);
+                        data = other.data;
+                        length = other.length;
+                        other.data = 0;
+                        other.length = 0;
+                }
+                return *this;
+        }
         ~buffer()
         {
                 if (data)
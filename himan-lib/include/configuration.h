@@ -125,6 +125,37 @@ class configuration
 	void ThreadCount(short theThreadCount);
 	short ThreadCount() const;
 
+	/**
+	 * @brief Number of threads writing calculated data, zero means that
+	 * calculating threads write the data themselves
+	 */
+
+	void WriteThreadCount(short theWriteThreadCount);
+	short WriteThreadCount() const;
+
+	/**
+	 * @brief Number of dimensions whose input data is read ahead of the
+	 * calculation when a plugin uses prefetching
+	 */
+
+	void PrefetchDistance(short thePrefetchDistance);
+	short PrefetchDistance() const;
+
+	/**
+	 * @brief Number of worker threads in the process-wide thread pool,
+	 * -1 means the number of cores
+	 */
+
+	void ThreadPoolSize(short theThreadPoolSize);
+	short ThreadPoolSize() const;
+
+	/**
+	 * @brief Pin worker threads of the thread pool to cores, NUMA node by node
+	 */
+
+	void NumaPlacement(bool theNumaPlacement);
+	bool NumaPlacement() const;
+
 	std::string ConfigurationFile() const;
 	void ConfigurationFile(const std::string& theConfigurationFile);
 
@@ -148,6 +179,14 @@ class configuration
 	bool UseCacheForWrites() const;
 	void UseCacheForWrites(bool theUseCacheForWrites);
 
+	/**
+	 * @brief Keep simple packed grids packed in cache and unpack them on CPU
+	 * when they are read. Only possible when himan is compiled without CUDA.
+	 */
+
+	bool UsePackedCache() const;
+	void UsePackedCache(bool theUsePackedCache);
+
 	void SourceGeomNames(const std::vector<std::string>& theNames);
 	std::vector<std::string> SourceGeomNames() const;
 
@@ -195,6 +234,29 @@ class configuration
 	int CacheLimit() const;
 	void CacheLimit(int theCacheLimit);
 
+	/**
+	 * @brief Maximum size of cache in bytes, zero means no limit
+	 */
+
+	size_t CacheLimitBytes() const;
+	void CacheLimitBytes(size_t theCacheLimitBytes);
+
+	/**
+	 * @brief Directory where interpolation weights are stored between runs,
+	 * empty value means that weights are not stored
+	 */
+
+	std::string InterpolationCacheDirectory() const;
+	void InterpolationCacheDirectory(const std::string& theInterpolationCacheDirectory);
+
+	/**
+	 * @brief Store the message index of auxiliary files to a file next to each
+	 * auxiliary file, so that later runs do not need to create it again
+	 */
+
+	bool StoreAuxiliaryFileIndex() const;
+	void StoreAuxiliaryFileIndex(bool theStoreAuxiliaryFileIndex);
+
 	bool UseDynamicMemoryAllocation() const;
 	void UseDynamicMemoryAllocation(bool theUseDynamicMemoryAllocation);
 
@@ -236,6 +298,10 @@ class configuration
 
 	bool itsReadFromDatabase;
 	short itsThreadCount;
+	short itsWriteThreadCount;
+	short itsPrefetchDistance;
+	short itsThreadPoolSize;
+	bool itsNumaPlacement;
 	std::string itsTargetGeomName;
 	std::vector<std::string> itsSourceGeomNames;
 	std::string itsStatisticsLabel;
@@ -247,8 +313,10 @@ class configuration
 	bool itsUseCudaForUnpacking;
 	bool itsUseCacheForReads;
 	bool itsUseCacheForWrites;
+	bool itsUsePackedCache;
 	bool itsUseDynamicMemoryAllocation;
 	bool itsReadAllAuxiliaryFilesToCache;
+	bool itsStoreAuxiliaryFileIndex;
 
 	int itsCudaDeviceCount;
 	int itsCudaDeviceId;
@@ -256,6 +324,8 @@ class configuration
 	time_duration itsForecastStep;
 
 	int itsCacheLimit;
+	size_t itsCacheLimitBytes;
+	std::string itsInterpolationCacheDirectory;
 	std::string itsParamFile;
 	bool itsAsyncExecution;
 	bool itsUpdateSSStateTable;
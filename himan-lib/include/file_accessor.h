@@ -2,15 +2,109 @@
 
 #include "buffer.h"
 #include "file_information.h"
+#include "statistics.h"
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace himan
 {
+/**
+ * @brief Location of a single GRIB message inside a file
+ */
+
+struct message_location
+{
+	unsigned long offset;
+	unsigned long length;
+};
+
+/**
+ * @brief Memory mapping of a whole local file
+ *
+ * Messages are read directly from the mapping, so they do not need to be copied
+ * to a separate buffer. Mapping is read-only and data must not be modified. The
+ * offsets of GRIB messages in the file are searched when they are first needed.
+ */
+
+class mapped_file
+{
+   public:
+	explicit mapped_file(const std::string& fileName);
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	const std::string& FileName() const;
+	unsigned char* Data() const;
+	size_t Size() const;
+	time_t ModificationTime() const;
+
+	/**
+	 * @brief Return the locations of all GRIB messages in file, in the order they
+	 * appear. Index is built on the first call.
+	 */
+
+	const std::vector<message_location>& Messages() const;
+
+   private:
+	std::string itsFileName;
+	unsigned char* itsData;
+	size_t itsSize;
+	time_t itsModificationTime;
+
+	mutable std::once_flag itsIndexFlag;
+	mutable std::vector<message_location> itsMessages;
+};
+
 class file_accessor
 {
    public:
 	file_accessor() = default;
 	~file_accessor() = default;
 
-	buffer Read(const file_information& finfo) const;
+	/**
+	 * @brief Read a message (or whole file if offset and length are not set)
+	 *
+	 * @param stats If set, S3 reads are recorded to these statistics
+	 */
+
+	buffer Read(const file_information& finfo, const std::shared_ptr<statistics>& stats = nullptr) const;
+
+	/**
+	 * @brief Memory map a local file
+	 *
+	 * Mappings are kept in a process-wide table, so that a file is opened and
+	 * indexed only once even if thousands of messages are read from it. The
+	 * least recently used mappings are evicted when the table grows large.
+	 *
+	 * A file is checked for changes on disk once per mapping generation, or on
+	 * every call if checkForChanges is set. If it has changed since it was
+	 * mapped, it is mapped again.
+	 *
+	 * Throws if file cannot be opened or mapped.
+	 */
+
+	static std::shared_ptr<const mapped_file> Map(const std::string& fileName, bool checkForChanges = false);
+
+	/**
+	 * @brief Start a new mapping generation: files that are already mapped are
+	 * checked for changes again when they are next used. Called when a plugin
+	 * starts, so that input files are checked once per plugin run instead of on
+	 * every read.
+	 */
+
+	static void NewMappingGeneration();
+
+	/**
+	 * @brief Remove mapping of a file from the table, for example after Himan
+	 * has written to the file. Mapping stays valid as long as someone is still
+	 * using it.
+	 */
+
+	static void Unmap(const std::string& fileName);
 };
 }  // namespace himan
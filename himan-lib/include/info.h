@@ -394,6 +394,10 @@ struct base
 	base(std::shared_ptr<himan::grid> grid_, const matrix<T>& data_) : grid(grid_), data(data_), pdata(new packed_data)
 	{
 	}
+	base(std::shared_ptr<himan::grid> grid_, matrix<T>&& data_)
+	    : grid(grid_), data(std::move(data_)), pdata(new packed_data)
+	{
+	}
 };
 
 template <typename T>
@@ -572,6 +576,28 @@ class info
 		return itsDimensions[Index()];
 	}
 
+	/**
+	 * @brief Give this info a private copy of the current grid and data
+	 *
+	 * Data fetched from cache is shared with the cache and with all other
+	 * callers that fetched it. Data must be detached before it is modified
+	 * in place. Does nothing if the current grid is not shared.
+	 */
+
+	void Detach()
+	{
+		ASSERT(itsDimensions.size() > Index());
+
+		auto& b = itsDimensions[Index()];
+
+		if (b && b.use_count() > 1)
+		{
+			auto copy = std::make_shared<base<T>>(std::shared_ptr<grid>(b->grid->Clone()), b->data);
+			copy->pdata = b->pdata;
+			b = copy;
+		}
+	}
+
 	/**
 	 * @brief Shortcut to get the current data matrix
 	 * @return Current data matrix
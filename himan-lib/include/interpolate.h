@@ -45,6 +45,8 @@ namespace interpolate
  * with i denotin source locations and j target locations
  */
 
+struct weight_file;
+
 template <typename T>
 class area_interpolation
 {
@@ -55,8 +57,30 @@ class area_interpolation
 	size_t SourceSize() const;
 	size_t TargetSize() const;
 
+	/**
+	 * @brief Read weights from a file created with Write()
+	 *
+	 * File is memory mapped and weights are used directly from there.
+	 *
+	 * @return false if file does not exist or it does not match the given sizes
+	 */
+
+	bool Read(const std::string& fileName, size_t sourceSize, size_t targetSize);
+
+	/**
+	 * @brief Write weights to a file so that other processes can use them
+	 *
+	 * File is first written with a temporary name and then renamed, so that
+	 * readers never see a partially written file.
+	 */
+
+	void Write(const std::string& fileName) const;
+
    private:
 	Eigen::SparseMatrix<T, Eigen::RowMajor> itsInterpolation;
+
+	// Set if weights were read from file; itsInterpolation is then empty
+	std::shared_ptr<const weight_file> itsWeightFile;
 };
 
 template class area_interpolation<double>;
@@ -77,8 +101,20 @@ class interpolator
 	bool Interpolate(base<T>& source, base<T>& target, HPInterpolationMethod method);
 
    private:
+	// Each interpolation is created only once. Threads that need the same
+	// interpolation wait for the first one to finish; others are not blocked.
+	struct cache_entry
+	{
+		std::once_flag flag;
+		area_interpolation<T> interpolation;
+		bool valid = false;
+	};
+
+	static std::shared_ptr<cache_entry> Entry(const base<T>& source, const base<T>& target,
+	                                          HPInterpolationMethod method);
+
 	static std::mutex interpolatorAccessMutex;
-	static std::map<size_t, area_interpolation<T>> cache;
+	static std::map<size_t, std::shared_ptr<cache_entry>> cache;
 };
 template class interpolator<double>;
 template class interpolator<float>;
@@ -93,6 +129,15 @@ bool Interpolate(const grid* baseGrid, std::vector<std::shared_ptr<info<T>>>& in
 
 bool IsVectorComponent(const std::string& paramName);
 
+/**
+ * @brief Set directory where area interpolation weights are stored and
+ * shared between himan processes. Empty value (the default) means that
+ * weights are only kept in memory.
+ */
+
+void InterpolationCacheDirectory(const std::string& theDirectory);
+std::string InterpolationCacheDirectory();
+
 HPInterpolationMethod InterpolationMethod(const std::string& paramName, HPInterpolationMethod interpolationMethod);
 
 template <typename T>
@@ -68,6 +68,11 @@ class logger
 		printf("Fatal::%s %s\n", itsUserName.c_str(), msg.c_str());
 	};
 
+	HPDebugState DebugState() const
+	{
+		return itsDebugState;
+	}
+
 	static HPDebugState MainDebugState;
 
    private:
@@ -12,6 +12,7 @@
 #include "serialization.h"
 #include <algorithm>
 #include <mutex>
+#include <utility>
 
 namespace himan
 {
@@ -109,7 +110,17 @@ class matrix
 		                     [=](const U& val) { return Compare(val, other.MissingValue()); }, itsMissingValue);
 	}
 
-	matrix(matrix&&) = default;
+	// Move constructor and assignment need to be written out because
+	// the mutex member would otherwise make them deleted, and all moves
+	// would silently fall back to copying the data.
+
+	matrix(matrix&& other) noexcept : itsData(std::move(other.itsData)),
+	                                  itsWidth(other.itsWidth),
+	                                  itsHeight(other.itsHeight),
+	                                  itsDepth(other.itsDepth),
+	                                  itsMissingValue(other.itsMissingValue)
+	{
+	}
 
 	matrix& operator=(const matrix& other)
 	{
@@ -122,7 +133,16 @@ class matrix
 		return *this;
 	}
 
-	matrix& operator=(matrix&&) = default;
+	matrix& operator=(matrix&& other) noexcept
+	{
+		itsData = std::move(other.itsData);
+		itsWidth = other.itsWidth;
+		itsHeight = other.itsHeight;
+		itsDepth = other.itsDepth;
+		itsMissingValue = other.itsMissingValue;
+
+		return *this;
+	}
 
 	bool operator==(const matrix& other) const
 	{
@@ -288,7 +308,7 @@ class matrix
 	void Set(std::vector<T>&& theData)
 	{
 		ASSERT(itsData.size() == theData.size());
-		itsData = theData;
+		itsData = std::move(theData);
 	}
 
 	/**
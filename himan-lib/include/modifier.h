@@ -72,6 +72,18 @@ class modifier
 	 */
 
 	virtual bool Evaluate(double theValue, double theHeight, double thePreviousValue, double thePreviousHeight);
+
+	/**
+	 * @brief Process one grid with statically bound Evaluate() and Calculate()
+	 *
+	 * Same as Process(), but the per-point calls are made to the functions of
+	 * the concrete modifier M, so that they are not virtual and can be inlined
+	 * to the loop. Modifiers implement Process() with this function.
+	 */
+
+	template <typename M>
+	void ProcessGrid(const std::vector<double>& theData, const std::vector<double>& theHeights);
+
 	virtual double Value() const;
 	virtual void Value(double theValue);
 
@@ -145,6 +157,7 @@ class modifier_max : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 };
 
 /**
@@ -166,6 +179,7 @@ class modifier_min : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 };
 
 /**
@@ -187,6 +201,7 @@ class modifier_maxmin : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 	virtual const std::vector<double>& Result() const override;
 
    protected:
@@ -215,6 +230,7 @@ class modifier_sum : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 };
 
 /**
@@ -237,6 +253,7 @@ class modifier_integral : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 
    protected:
 	explicit modifier_integral(HPModifierType theModifierType) : modifier(theModifierType)
@@ -263,6 +280,7 @@ class modifier_mean : public modifier_integral
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 
 	virtual const std::vector<double>& Result() const override;
 
@@ -291,6 +309,7 @@ class modifier_count : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 
    protected:
 	virtual void Init(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
@@ -322,6 +341,7 @@ class modifier_findheight : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 
 	virtual bool CalculationFinished() const override;
 
@@ -357,6 +377,7 @@ class modifier_findheight_gt : public modifier_findheight
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 	virtual void FindNth(int theNth) override;
 };
 
@@ -379,6 +400,7 @@ class modifier_findheight_lt : public modifier_findheight
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 	virtual void FindNth(int theNth) override;
 };
 
@@ -401,6 +423,7 @@ class modifier_findvalue : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 
 	virtual bool CalculationFinished() const override;
 
@@ -429,6 +452,7 @@ class modifier_plusminusarea : public modifier
 	}
 	virtual void Calculate(double theValue, double theHeight, double thePreviousValue,
 	                       double thePreviousHeight) override;
+	virtual void Process(const std::vector<double>& theData, const std::vector<double>& theHeights) override;
 
 	virtual const std::vector<double>& Result() const override;
 
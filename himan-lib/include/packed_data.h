@@ -3,8 +3,9 @@
  *
  * @brief Container to hold packed data.
  *
- * Data is later on unpacked in GPU, so we have CUDA specific functions (this should be always
- * the case since it makes no sense to unpack it in host CPU outside grib_api)
+ * With CUDA data is later on unpacked in GPU, so we have CUDA specific functions. Without CUDA
+ * packed data is kept in host memory (for example in cache, where it takes only a fraction of
+ * the space of unpacked data) and unpacked in CPU when it is needed.
  *
  * All CUDA commands are still wrapped with preprocessor macros so that HIMAN can be compiled
  * even on a machine that does not have CUDA SDK installed.
@@ -14,17 +15,61 @@
 #pragma once
 
 #ifndef HAVE_CUDA
-// Define shells so that compilation succeeds
+// Without CUDA packed data is held in regular host memory and it is unpacked
+// with the CPU implementation of simple packing (see simple_packing.h)
+#include "himan_common.h"
 #include "serialization.h"
+#include "simple_packing.h"
+#include <vector>
+
 namespace himan
 {
 struct packed_data
 {
+	packed_data() = default;
+	virtual ~packed_data() = default;
+	packed_data(const packed_data& other) = default;
+
+	void Clear()
+	{
+		std::vector<unsigned char>().swap(data);
+		std::vector<unsigned char>().swap(bitmap);
+
+		packedLength = 0;
+		unpackedLength = 0;
+		bitmapLength = 0;
+	}
+
 	bool HasData() const
 	{
-		return false;
+		return (unpackedLength > 0);
+	}
+
+	bool HasBitmap() const
+	{
+		return (bitmapLength > 0);
 	}
 
+	/**
+	 * @brief Memory used by packed data and bitmap, in bytes
+	 */
+
+	size_t SizeInBytes() const
+	{
+		return data.capacity() + bitmap.capacity();
+	}
+
+	std::vector<unsigned char> data;
+	size_t packedLength = 0;
+	size_t unpackedLength = 0;
+
+	// Bitmap as it is stored in grib: one bit per grid point, most
+	// significant bit first
+	std::vector<unsigned char> bitmap;
+	size_t bitmapLength = 0;
+
+	HPPackingType packingType = kUnknownPackingType;
+
    private:
 #ifdef SERIALIZATION
 	friend class cereal::access;
@@ -36,6 +81,28 @@ struct packed_data
 #endif
 };
 
+struct simple_packed : public packed_data
+{
+	simple_packed() : packed_data()
+	{
+		packingType = kSimplePacking;
+	}
+
+	simple_packed(int theBitsPerValue, double theBinaryScaleFactor, double theDecimalScaleFactor,
+	              double theReferenceValue)
+	    : simple_packed()
+	{
+		coefficients.bitsPerValue = theBitsPerValue;
+		coefficients.binaryScaleFactor = theBinaryScaleFactor;
+		coefficients.decimalScaleFactor = theDecimalScaleFactor;
+		coefficients.referenceValue = theReferenceValue;
+	}
+
+	simple_packed(const simple_packed& other) = default;
+
+	simple_packing::coefficients coefficients;
+};
+
 #else
 
 #include "cuda_helper.h"
@@ -78,6 +145,11 @@ struct packed_data
 		return (bitmapLength > 0);
 	}
 
+	CUDA_HOST size_t SizeInBytes() const
+	{
+		return packedLength * sizeof(unsigned char) + bitmapLength * sizeof(int);
+	}
+
 	unsigned char* data = nullptr;
 	size_t packedLength = 0;
 	size_t unpackedLength = 0;
@@ -132,6 +132,25 @@ class plugin_configuration : public configuration
 	unsigned int RelativeOrdinalNumber() const;
 	void RelativeOrdinalNumber(unsigned int theRelativeOrdinalNumber);
 
+	/**
+	 * @brief Identifier that other plugins use in their 'depends_on' lists.
+	 * Defaults to plugin name.
+	 */
+
+	std::string Id() const;
+	void Id(const std::string& theId);
+
+	/**
+	 * @brief Identifiers of the plugins that produce the input data of this plugin.
+	 *
+	 * If no dependencies are declared, plugin is started when all previous
+	 * non-async plugins have finished.
+	 */
+
+	const std::vector<std::string>& DependsOn() const;
+	void DependsOn(const std::vector<std::string>& theDependencies);
+	bool DependenciesDeclared() const;
+
    private:
 	friend class json_parser;
 
@@ -145,6 +164,9 @@ class plugin_configuration : public configuration
 	std::unique_ptr<grid> itsBaseGrid;
 	unsigned int itsOrdinalNumber;
 	unsigned int itsRelativeOrdinalNumber;
+	std::string itsId;
+	std::vector<std::string> itsDependsOn;
+	bool itsDependenciesDeclared;
 };
 
 inline std::ostream& operator<<(std::ostream& file, const plugin_configuration& ob)
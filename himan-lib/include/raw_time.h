@@ -80,6 +80,14 @@ class raw_time
 	bool Empty() const;
 	bool IsLeapYear() const;
 
+	/**
+	 * @brief Return time as seconds since 1970-01-01 00:00:00 UTC
+	 *
+	 * Empty time returns the smallest possible value of time_t.
+	 */
+
+	time_t ToEpoch() const;
+
    private:
 	std::string FormatTime(const std::string& theTimeMask) const;
 	std::string ToDatabaseTime() const;
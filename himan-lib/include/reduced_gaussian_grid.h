@@ -35,12 +35,12 @@ class reduced_gaussian_grid : public irregular_grid
 
 	size_t Size() const override;
 
-	std::vector<int> NumberOfPointsAlongParallels() const;
+	const std::vector<int>& NumberOfPointsAlongParallels() const;
 	void NumberOfPointsAlongParallels(const std::vector<int>& theNumberOfPointsAlongParallels);
 
 	std::vector<size_t> AccumulatedPointsAlongParallels() const;
 
-	std::vector<double> Latitudes() const;
+	const std::vector<double>& Latitudes() const;
 
 	point FirstPoint() const override;
 	point LastPoint() const override;
@@ -1,12 +1,102 @@
 #pragma once
 #include "buffer.h"
 #include "file_information.h"
+#include "statistics.h"
+#include <memory>
+#include <vector>
 
 namespace himan
 {
 namespace s3
 {
-buffer ReadFile(const file_information& fileInformation);
+/**
+ * @brief Read a range of an S3 object
+ *
+ * Range is first searched from a process-wide block cache of recently read
+ * ranges. Otherwise the read is extended with a read-ahead, so that the
+ * following messages of the same object are usually found from the block
+ * cache. Throws if data cannot be read.
+ */
+
+buffer ReadFile(const file_information& fileInformation, const std::shared_ptr<statistics>& stats = nullptr);
+
+/**
+ * @brief Read several ranges of S3 objects
+ *
+ * Adjacent or overlapping ranges of the same object are combined to a single
+ * request, and the requests are executed concurrently. Read ranges are stored
+ * to the block cache. Returned buffers are in the same order as the ranges;
+ * a buffer is empty if its range could not be read.
+ */
+
+std::vector<buffer> ReadFiles(const std::vector<file_information>& fileInformations,
+                              const std::shared_ptr<statistics>& stats = nullptr);
+
+/**
+ * @brief Read several ranges of S3 objects to the block cache
+ *
+ * Like ReadFiles(), but data is not returned. At most half of the block cache
+ * size is read, so that the ranges are still found from the cache when they
+ * are read with ReadFile().
+ */
+
+void Prefetch(const std::vector<file_information>& fileInformations,
+              const std::shared_ptr<statistics>& stats = nullptr);
+
+/**
+ * @brief Write a whole object with a single request
+ *
+ * Throws if data cannot be written.
+ */
+
 void WriteObject(const std::string& objectName, const himan::buffer& buff);
+
+/**
+ * @brief Append data to an object that is written in parts
+ *
+ * Data is collected to parts of a multipart upload, and full parts are
+ * uploaded by background threads while the caller continues. The object
+ * becomes visible only after Flush(); an object that existed before is
+ * replaced, not appended to. An object cannot be appended to after it has
+ * been finished.
+ *
+ * Throws if an earlier part of the object could not be uploaded.
+ *
+ * @param writerName Name of the plugin that writes the object, see Flush(writerName)
+ */
+
+void AppendToObject(const std::string& objectName, const himan::buffer& buff, const std::string& writerName = "");
+
+/**
+ * @brief Return the amount of data appended to an object so far
+ */
+
+unsigned long AppendedObjectSize(const std::string& objectName);
+
+/**
+ * @brief Check if an object written with AppendToObject() is not readable:
+ * it has not been finished yet, or its upload failed
+ */
+
+bool IsIncompleteObject(const std::string& objectName);
+
+/**
+ * @brief Finish objects written by the given plugin with AppendToObject()
+ *
+ * Remaining data is uploaded and the multipart uploads are completed, so that
+ * the objects can be read before the process exits. Throws if any object
+ * could not be written.
+ */
+
+void Flush(const std::string& writerName);
+
+/**
+ * @brief Finish all objects written with AppendToObject()
+ *
+ * Remaining data is uploaded and the multipart uploads are completed. Throws
+ * if any object could not be written.
+ */
+
+void Flush();
 }  // namespace s3
 }  // namespace himan
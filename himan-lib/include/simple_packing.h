@@ -0,0 +1,68 @@
+/**
+ * @file simple_packing.h
+ *
+ * @brief CPU implementation of grib simple packing (grid_simple) decoding.
+ *
+ * Packed values are decoded straight to the data array of a matrix, without
+ * going through grib_api and temporary double arrays. Hot loops have AVX2 and
+ * AVX-512 versions that are selected at run time based on the cpu, with a
+ * scalar fallback.
+ *
+ * Value is decoded as Y = (R + X * 2^E) * 10^-D, where X is the packed integer.
+ *
+ * Only decoding is implemented. Written grib messages are packed by grib_api,
+ * as NFmiGribMessage has no interface for setting packed data directly.
+ */
+
+#ifndef SIMPLE_PACKING_H
+#define SIMPLE_PACKING_H
+
+#include <cstddef>
+
+namespace himan
+{
+namespace simple_packing
+{
+struct coefficients
+{
+	int bitsPerValue;
+	double binaryScaleFactor;   // 2^E
+	double decimalScaleFactor;  // 10^-D
+	double referenceValue;      // R
+};
+
+/**
+ * @brief Check if data packed with given number of bits per value can be decoded
+ */
+
+bool IsSupported(int bitsPerValue);
+
+/**
+ * @brief Decode packed values.
+ *
+ * @param packed Packed data, ie. the data section of the message
+ * @param packedLength Length of packed data in bytes
+ * @param bitmap Bitmap as it is stored in the message (one bit per grid point, most
+ * significant bit first), or nullptr if message does not have a bitmap
+ * @param values Output array, grid points not present in bitmap are set to missing value
+ * @param valuesLength Number of grid points
+ * @throws std::runtime_error if packed data is too short
+ */
+
+template <typename T>
+void Unpack(const unsigned char* packed, size_t packedLength, const unsigned char* bitmap, T* values,
+            size_t valuesLength, const coefficients& coeffs);
+
+/**
+ * @brief Find minimum and maximum of data, ignoring missing values.
+ *
+ * If all values are missing, both min and max are set to missing value.
+ */
+
+template <typename T>
+void MinMax(const T* values, size_t valuesLength, T& min, T& max);
+
+}  // namespace simple_packing
+}  // namespace himan
+
+#endif /* SIMPLE_PACKING_H */
@@ -39,6 +39,40 @@ class statistics
 	void AddToCacheMissCount(size_t theCacheMissCount);
 	void AddToCacheHitCount(size_t theCacheHitCount);
 
+	/**
+	 * @brief Time that calculating threads have waited for space in the write queue
+	 */
+
+	void AddToWriteQueueWaitTime(int64_t theWriteQueueWaitTime);
+
+	/**
+	 * @brief Time spent waiting for queued writes to finish after all calculations are done
+	 */
+
+	void AddToWriteDrainTime(int64_t theWriteDrainTime);
+
+	/**
+	 * @brief Number of dimensions whose input data was read ahead while the
+	 * calculation was running, and the time those reads took
+	 */
+
+	void AddToPrefetchCount(size_t thePrefetchCount);
+	void AddToPrefetchTime(int64_t thePrefetchTime);
+
+	/**
+	 * @brief Number of GET requests made to S3, and the bytes and time they took
+	 */
+
+	void AddToS3ReadCount(size_t theS3ReadCount);
+	void AddToS3ReadBytes(size_t theS3ReadBytes);
+	void AddToS3ReadTime(int64_t theS3ReadTime);
+
+	/**
+	 * @brief Number of S3 reads that were served from the block cache
+	 */
+
+	void AddToS3BlockCacheHitCount(size_t theS3BlockCacheHitCount);
+
 	std::string Label() const;
 	void Label(const std::string& theLabel);
 
@@ -61,6 +95,14 @@ class statistics
 	std::atomic<int64_t> itsInitTime;
 	std::atomic<size_t> itsCacheMissCount;
 	std::atomic<size_t> itsCacheHitCount;
+	std::atomic<int64_t> itsWriteQueueWaitTime;
+	std::atomic<int64_t> itsWriteDrainTime;
+	std::atomic<size_t> itsPrefetchCount;
+	std::atomic<int64_t> itsPrefetchTime;
+	std::atomic<size_t> itsS3ReadCount;
+	std::atomic<size_t> itsS3ReadBytes;
+	std::atomic<int64_t> itsS3ReadTime;
+	std::atomic<size_t> itsS3BlockCacheHitCount;
 
 	short itsUsedThreadCount;
 };
@@ -0,0 +1,122 @@
+/**
+ * @file thread_pool.h
+ *
+ * @brief Process-wide work-stealing thread pool.
+ *
+ * All calculations share one set of worker threads that is sized to the
+ * machine. Each worker has its own task queue: tasks submitted from a worker
+ * are placed to its own queue and idle workers steal tasks from the others.
+ *
+ * Nested parallelism is done with ParallelFor(): when it is called from a
+ * worker thread, the calling thread executes part of the work itself and never
+ * waits for a task that has not been started yet. Nested calls therefore
+ * compose instead of multiplying the number of threads.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace himan
+{
+class thread_pool
+{
+   public:
+	static thread_pool* Instance();
+
+	std::string ClassName() const
+	{
+		return "himan::thread_pool";
+	}
+
+	/**
+	 * @brief Set number of worker threads. Has effect only if called before
+	 * the first task is submitted. Default is the number of cores the process
+	 * is allowed to use, taking into account CPU affinity and cgroup CPU quota.
+	 */
+
+	void Size(size_t theSize);
+	size_t Size() const;
+
+	/**
+	 * @brief Pin each worker thread to one core. Cores are taken from NUMA
+	 * nodes in turns, and idle workers steal tasks from workers of their own
+	 * node first. Memory that a worker touches first is then allocated from
+	 * its local node. Has effect only if called before the first task is
+	 * submitted.
+	 */
+
+	void NumaPlacement(bool theNumaPlacement);
+	bool NumaPlacement() const;
+
+	/**
+	 * @brief Queue a task for execution. Task must not throw.
+	 */
+
+	void Submit(std::function<void()> task);
+
+	/**
+	 * @brief Call fn(first, last) for consecutive ranges of at most 'grain'
+	 * elements between [begin, end) in parallel, and wait for all of them to finish.
+	 *
+	 * First exception thrown by fn is rethrown to the caller.
+	 */
+
+	void ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+	/**
+	 * @brief Execute given functions in parallel and wait for them to finish
+	 */
+
+	void Invoke(const std::vector<std::function<void()>>& fns);
+
+	/**
+	 * @brief Check if calling thread is one of the workers of this pool
+	 */
+
+	bool IsWorkerThread() const;
+
+   private:
+	thread_pool();
+	~thread_pool() = delete;
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	struct task_queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void Start();
+	void WorkerLoop(size_t index);
+	bool TryPop(size_t index, std::function<void()>& task);
+
+	// One queue for each worker, the last one holds tasks submitted
+	// from outside the pool
+	std::vector<std::unique_ptr<task_queue>> itsQueues;
+	std::vector<std::thread> itsWorkers;
+
+	// With NUMA placement, the core and node of each worker
+	std::vector<int> itsWorkerCpus;
+	std::vector<int> itsWorkerNodes;
+	bool itsNumaPlacement;
+
+	mutable std::mutex itsMutex;
+	std::condition_variable itsTaskAvailable;
+	size_t itsPendingCount;
+	size_t itsSize;
+	std::once_flag itsStartFlag;
+};
+
+}  // namespace himan
+
+#endif /* THREAD_POOL_H */
@@ -0,0 +1,124 @@
+/**
+ * @file   unique_key.h
+ *
+ * @brief Key that identifies a single grid in cache and in fetcher.
+ *
+ * The key is a plain structure of numbers and the parameter name, and its
+ * hash is calculated once when the key is created. Comparing or hashing a key
+ * does not involve any string formatting; string presentation is created only
+ * when it is needed for logging.
+ */
+
+#ifndef UNIQUE_KEY_H
+#define UNIQUE_KEY_H
+
+#include "himan_common.h"
+#include <ctime>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace himan
+{
+class unique_key
+{
+   public:
+	unique_key() = delete;
+	unique_key(long theProducerId, time_t theOriginTime, time_t theValidTime, const std::string& theParamName,
+	           HPLevelType theLevelType, double theLevelValue, double theLevelValue2, HPForecastType theForecastType,
+	           double theForecastTypeValue);
+
+	bool operator==(const unique_key& other) const;
+	bool operator!=(const unique_key& other) const;
+
+	/**
+	 * @brief String presentation of the key, only meant for logging
+	 */
+
+	operator std::string() const;
+
+	std::string ClassName() const
+	{
+		return "himan::unique_key";
+	}
+
+	size_t Hash() const
+	{
+		return itsHash;
+	}
+
+	long ProducerId() const
+	{
+		return itsProducerId;
+	}
+	time_t OriginTime() const
+	{
+		return itsOriginTime;
+	}
+	time_t ValidTime() const
+	{
+		return itsValidTime;
+	}
+	const std::string& ParamName() const
+	{
+		return itsParamName;
+	}
+	HPLevelType LevelType() const
+	{
+		return itsLevelType;
+	}
+	double LevelValue() const
+	{
+		return itsLevelValue;
+	}
+	double LevelValue2() const
+	{
+		return itsLevelValue2;
+	}
+	HPForecastType ForecastType() const
+	{
+		return itsForecastType;
+	}
+	double ForecastTypeValue() const
+	{
+		return itsForecastTypeValue;
+	}
+
+   private:
+	long itsProducerId;
+	time_t itsOriginTime;
+	time_t itsValidTime;
+
+	// Parameter name is used instead of id, because id is not always
+	// set when database is not used
+	std::string itsParamName;
+
+	HPLevelType itsLevelType;
+	double itsLevelValue;
+	double itsLevelValue2;
+	HPForecastType itsForecastType;
+	double itsForecastTypeValue;
+
+	size_t itsHash;
+};
+
+inline std::ostream& operator<<(std::ostream& file, const unique_key& ob)
+{
+	return file << static_cast<std::string>(ob);
+}
+
+}  // namespace himan
+
+namespace std
+{
+template <>
+struct hash<himan::unique_key>
+{
+	size_t operator()(const himan::unique_key& key) const
+	{
+		return key.Hash();
+	}
+};
+}  // namespace std
+
+#endif /* UNIQUE_KEY_H */
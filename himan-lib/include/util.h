@@ -13,7 +13,9 @@
 #include "himan_common.h"
 #include "info.h"
 #include "search_options.h"
+#include "unique_key.h"
 #include <boost/iterator/zip_iterator.hpp>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <tuple>
@@ -73,8 +75,10 @@ double ToPower(double value, double power);
 /**
  * @brief Unpack grib simple_packing
  *
- * This function can be called on CPU to unpack the data on CUDA and return
- * the results to CPU memory.
+ * With CUDA, this function can be called on CPU to unpack the data on CUDA and
+ * return the results to CPU memory. Without CUDA data is unpacked on CPU, grids
+ * in parallel. Unpacked data is placed to a new data backend, so that infos
+ * sharing the packed data are not modified.
  *
  * @param grids List of infos that are unpacked.
  */
@@ -184,6 +188,27 @@ double MissingPercent(const himan::info<double>& info);
 
 bool ParseBoolean(const std::string& val);
 
+/**
+ * @brief Parse size in bytes from string
+ *
+ * Value can have an optional suffix K, M, G or T (powers of 1024), for example
+ * 512M or 16G. Throws invalid_argument if value cannot be parsed, is negative or
+ * does not fit in size_t.
+ */
+
+size_t ParseByteSize(const std::string& val);
+
+/**
+ * @brief Write a file through a temporary file and rename it into place
+ *
+ * Readers never see a partially written file. If several processes write the
+ * same file at the same time, whichever finishes last wins. Returns false if
+ * writing or renaming fails; the temporary file is removed in that case.
+ */
+
+bool WriteFileAtomically(const std::string& fileName, const std::function<void(std::ostream&)>& writer,
+                         bool binary = false);
+
 /**
  * @brief create an empty grid for a given geom_name from db
  */
@@ -201,14 +226,16 @@ void Flip(matrix<T>& mat);
 
 /**
  *
- * @brief Create unique string identifier from search_options or info
+ * @brief Create unique identifier from search_options or info
  *
+ * Identifier is used as a key in cache and fetcher. It can be converted
+ * to a string for logging.
  */
 
-std::string UniqueName(const plugin::search_options& options);
+unique_key UniqueKey(const plugin::search_options& options);
 
 template <typename T>
-std::string UniqueName(const info<T>& info);
+unique_key UniqueKey(const info<T>& info);
 
 /**
  * @brief Convert vector from float to double or vice versa, retaining correct
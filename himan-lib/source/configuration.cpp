@@ -19,6 +19,10 @@ configuration::configuration()
       itsOriginTime(),
       itsReadFromDatabase(true),
       itsThreadCount(-1),
+      itsWriteThreadCount(0),
+      itsPrefetchDistance(1),
+      itsThreadPoolSize(-1),
+      itsNumaPlacement(false),
       itsTargetGeomName(),
       itsSourceGeomNames(),
       itsStatisticsLabel(),
@@ -28,12 +32,16 @@ configuration::configuration()
       itsUseCudaForUnpacking(true),
       itsUseCacheForReads(true),
       itsUseCacheForWrites(true),
+      itsUsePackedCache(false),
       itsUseDynamicMemoryAllocation(false),
       itsReadAllAuxiliaryFilesToCache(true),
+      itsStoreAuxiliaryFileIndex(false),
       itsCudaDeviceCount(-1),
       itsCudaDeviceId(0),
       itsForecastStep(),
       itsCacheLimit(-1),
+      itsCacheLimitBytes(0),
+      itsInterpolationCacheDirectory(),
       itsParamFile(),
       itsAsyncExecution(false),
       itsUpdateSSStateTable(true),
@@ -57,6 +65,10 @@ std::ostream& configuration::Write(std::ostream& file) const
 	file << "__itsReadFromDatabase__ " << itsReadFromDatabase << std::endl;
 
 	file << "__itsThreadCount__ " << itsThreadCount << std::endl;
+	file << "__itsWriteThreadCount__ " << itsWriteThreadCount << std::endl;
+	file << "__itsPrefetchDistance__ " << itsPrefetchDistance << std::endl;
+	file << "__itsThreadPoolSize__ " << itsThreadPoolSize << std::endl;
+	file << "__itsNumaPlacement__ " << itsNumaPlacement << std::endl;
 
 	file << "__itsTargetGeomName__ " << itsTargetGeomName << std::endl;
 
@@ -75,11 +87,15 @@ std::ostream& configuration::Write(std::ostream& file) const
 
 	file << "__itsUseCacheForReads__ " << itsUseCacheForReads << std::endl;
 	file << "__itsUseCacheForWrites__ " << itsUseCacheForWrites << std::endl;
+	file << "__itsUsePackedCache__ " << itsUsePackedCache << std::endl;
 
 	file << "__itsForecastStep__ " << itsForecastStep << std::endl;
 	file << "__itsCacheLimit__ " << itsCacheLimit << std::endl;
+	file << "__itsCacheLimitBytes__ " << itsCacheLimitBytes << std::endl;
+	file << "__itsInterpolationCacheDirectory__ " << itsInterpolationCacheDirectory << std::endl;
 	file << "__itsUseDynamicMemoryAllocation__ " << itsUseDynamicMemoryAllocation << std::endl;
 	file << "__itsReadAllAuxiliaryFilesToCache__" << itsReadAllAuxiliaryFilesToCache << std::endl;
+	file << "__itsStoreAuxiliaryFileIndex__ " << itsStoreAuxiliaryFileIndex << std::endl;
 
 	for (size_t i = 0; i < itsAuxiliaryFiles.size(); i++)
 	{
@@ -155,6 +171,38 @@ void configuration::ThreadCount(short theThreadCount)
 {
 	itsThreadCount = theThreadCount;
 }
+short configuration::WriteThreadCount() const
+{
+	return itsWriteThreadCount;
+}
+void configuration::WriteThreadCount(short theWriteThreadCount)
+{
+	itsWriteThreadCount = theWriteThreadCount;
+}
+short configuration::PrefetchDistance() const
+{
+	return itsPrefetchDistance;
+}
+void configuration::PrefetchDistance(short thePrefetchDistance)
+{
+	itsPrefetchDistance = thePrefetchDistance;
+}
+short configuration::ThreadPoolSize() const
+{
+	return itsThreadPoolSize;
+}
+void configuration::ThreadPoolSize(short theThreadPoolSize)
+{
+	itsThreadPoolSize = theThreadPoolSize;
+}
+bool configuration::NumaPlacement() const
+{
+	return itsNumaPlacement;
+}
+void configuration::NumaPlacement(bool theNumaPlacement)
+{
+	itsNumaPlacement = theNumaPlacement;
+}
 std::string configuration::ConfigurationFile() const
 {
 	return itsConfigurationFile;
@@ -224,6 +272,14 @@ void configuration::UseCacheForWrites(bool theUseCacheForWrites)
 {
 	itsUseCacheForWrites = theUseCacheForWrites;
 }
+bool configuration::UsePackedCache() const
+{
+	return itsUsePackedCache;
+}
+void configuration::UsePackedCache(bool theUsePackedCache)
+{
+	itsUsePackedCache = theUsePackedCache;
+}
 
 void configuration::SourceGeomNames(const std::vector<std::string>& theNames)
 {
@@ -285,6 +341,22 @@ void configuration::CacheLimit(int theCacheLimit)
 {
 	itsCacheLimit = theCacheLimit;
 }
+size_t configuration::CacheLimitBytes() const
+{
+	return itsCacheLimitBytes;
+}
+void configuration::CacheLimitBytes(size_t theCacheLimitBytes)
+{
+	itsCacheLimitBytes = theCacheLimitBytes;
+}
+std::string configuration::InterpolationCacheDirectory() const
+{
+	return itsInterpolationCacheDirectory;
+}
+void configuration::InterpolationCacheDirectory(const std::string& theInterpolationCacheDirectory)
+{
+	itsInterpolationCacheDirectory = theInterpolationCacheDirectory;
+}
 bool configuration::UseDynamicMemoryAllocation() const
 {
 	return itsUseDynamicMemoryAllocation;
@@ -302,6 +374,14 @@ void configuration::ReadAllAuxiliaryFilesToCache(bool theReadAllAuxiliaryFilesTo
 {
 	itsReadAllAuxiliaryFilesToCache = theReadAllAuxiliaryFilesToCache;
 }
+bool configuration::StoreAuxiliaryFileIndex() const
+{
+	return itsStoreAuxiliaryFileIndex;
+}
+void configuration::StoreAuxiliaryFileIndex(bool theStoreAuxiliaryFileIndex)
+{
+	itsStoreAuxiliaryFileIndex = theStoreAuxiliaryFileIndex;
+}
 std::string configuration::ParamFile() const
 {
 	return itsParamFile;
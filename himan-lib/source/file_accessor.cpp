@@ -1,46 +1,336 @@
 #include "file_accessor.h"
 #include "s3.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
 
 using namespace himan;
 
+namespace
+{
+struct mapping_entry
+{
+	std::shared_ptr<const mapped_file> file;
+
+	// Generation when file was last checked to be unchanged on disk
+	unsigned long generation;
+
+	// For evicting the least recently used mappings
+	unsigned long lastUse;
+};
+
+// Maximum number of mappings that are kept in the table when nobody is using them
+const size_t kMaxMappedFiles = 1024;
+
+std::mutex mappedFileMutex;
+std::unordered_map<std::string, mapping_entry> mappedFiles;
+unsigned long mappingGeneration = 0;
+unsigned long mappingUseCount = 0;
+
+// Remove least recently used mappings that are not in use elsewhere until
+// table is within limits. Called with mappedFileMutex held.
+
+void EvictMappedFiles()
+{
+	if (mappedFiles.size() <= kMaxMappedFiles)
+	{
+		return;
+	}
+
+	std::vector<std::pair<unsigned long, std::string>> unused;
+
+	for (const auto& m : mappedFiles)
+	{
+		if (m.second.file.use_count() == 1)
+		{
+			unused.emplace_back(m.second.lastUse, m.first);
+		}
+	}
+
+	std::sort(unused.begin(), unused.end());
+
+	for (size_t i = 0; i < unused.size() && mappedFiles.size() > kMaxMappedFiles; i++)
+	{
+		mappedFiles.erase(unused[i].second);
+	}
+}
+
+unsigned long ReadUnsigned(const unsigned char* p, int bytes)
+{
+	unsigned long ret = 0;
+
+	for (int i = 0; i < bytes; i++)
+	{
+		ret = (ret << 8) | p[i];
+	}
+
+	return ret;
+}
+
+bool HasEndSection(const unsigned char* data, size_t size, size_t offset, size_t length)
+{
+	return (length >= 8 && offset + length <= size && memcmp(data + offset + length - 4, "7777", 4) == 0);
+}
+
+// Return the length of the GRIB message that starts from given offset, or zero
+// if the message is invalid or truncated.
+
+size_t MessageLength(const unsigned char* data, size_t size, size_t offset)
+{
+	if (offset + 16 > size)
+	{
+		return 0;
+	}
+
+	const unsigned char* msg = data + offset;
+	const int edition = msg[7];
+
+	if (edition == 2)
+	{
+		const size_t length = ReadUnsigned(msg + 8, 8);
+		return HasEndSection(data, size, offset, length) ? length : 0;
+	}
+	else if (edition == 1)
+	{
+		const size_t length = ReadUnsigned(msg + 4, 3);
+
+		if ((length & 0x800000) == 0)
+		{
+			return HasEndSection(data, size, offset, length) ? length : 0;
+		}
+
+		// Large grib1 message: length is given in units of 120 bytes, and the
+		// actual end of the message is within the last unit
+
+		const size_t upper = std::min((length & 0x7fffff) * 120, size - offset);
+
+		for (size_t candidate = upper; candidate >= 8 && candidate + 120 > upper; candidate--)
+		{
+			if (HasEndSection(data, size, offset, candidate))
+			{
+				return candidate;
+			}
+		}
+	}
+
+	return 0;
+}
+
 buffer ReadFromLocalFile(const file_information& finfo)
 {
-	FILE* fp = fopen(finfo.file_location.c_str(), "rb");
+	const auto file = file_accessor::Map(finfo.file_location);
 
-	long offset = 0, length = 0;
+	unsigned long offset = 0, length = file->Size();
 
 	if (finfo.offset && finfo.length)
 	{
 		offset = finfo.offset.get();
 		length = finfo.length.get();
-		fseek(fp, offset, SEEK_SET);
+
+		if (offset + length > file->Size())
+		{
+			throw std::runtime_error("Message at position " + std::to_string(offset) + ":" + std::to_string(length) +
+			                         " is outside of file '" + finfo.file_location + "'");
+		}
 	}
-	else
+
+	buffer buf;
+	buf.data = static_cast<unsigned char*>(malloc(length));
+
+	if (buf.data == nullptr && length > 0)
 	{
-		// read whole file
-		fseek(fp, 0, SEEK_END);
-		length = ftell(fp);
-		rewind(fp);
+		throw std::bad_alloc();
 	}
 
-	buffer buf;
-	buf.data = new unsigned char[length];
 	buf.length = length;
-
-	fread(buf.data, buf.length, 1, fp);
-	fclose(fp);
+	memcpy(buf.data, file->Data() + offset, length);
 
 	return buf;
 }
+}  // namespace
+
+mapped_file::mapped_file(const std::string& fileName)
+    : itsFileName(fileName), itsData(nullptr), itsSize(0), itsModificationTime(0)
+{
+	const int fd = open(fileName.c_str(), O_RDONLY);
+
+	if (fd == -1)
+	{
+		throw std::runtime_error("Unable to open file '" + fileName + "': " + strerror(errno));
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) == -1)
+	{
+		close(fd);
+		throw std::runtime_error("Unable to stat file '" + fileName + "': " + strerror(errno));
+	}
+
+	itsSize = static_cast<size_t>(st.st_size);
+	itsModificationTime = st.st_mtime;
+
+	if (itsSize > 0)
+	{
+		// Mapping is read-only: grib library only reads keys and values of the
+		// messages it parses in place
+
+		void* address = mmap(nullptr, itsSize, PROT_READ, MAP_SHARED, fd, 0);
+
+		if (address == MAP_FAILED)
+		{
+			const int err = errno;
+			close(fd);
+			throw std::runtime_error("Unable to map file '" + fileName + "': " + strerror(err));
+		}
+
+		itsData = static_cast<unsigned char*>(address);
+	}
+
+	// mapping stays valid after file descriptor is closed
+	close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+	if (itsData)
+	{
+		munmap(itsData, itsSize);
+	}
+}
+
+const std::string& mapped_file::FileName() const
+{
+	return itsFileName;
+}
+unsigned char* mapped_file::Data() const
+{
+	return itsData;
+}
+size_t mapped_file::Size() const
+{
+	return itsSize;
+}
+time_t mapped_file::ModificationTime() const
+{
+	return itsModificationTime;
+}
+
+const std::vector<message_location>& mapped_file::Messages() const
+{
+	std::call_once(itsIndexFlag, [this]() {
+		size_t offset = 0;
+
+		while (offset + 4 <= itsSize)
+		{
+			const void* found = memmem(itsData + offset, itsSize - offset, "GRIB", 4);
+
+			if (found == nullptr)
+			{
+				break;
+			}
+
+			offset = static_cast<const unsigned char*>(found) - itsData;
+
+			const size_t length = MessageLength(itsData, itsSize, offset);
+
+			if (length == 0)
+			{
+				// Not a valid message, continue searching after the marker
+				offset += 4;
+				continue;
+			}
+
+			itsMessages.push_back({offset, length});
+			offset += length;
+		}
+	});
+
+	return itsMessages;
+}
+
+std::shared_ptr<const mapped_file> file_accessor::Map(const std::string& fileName, bool checkForChanges)
+{
+	unsigned long generation;
+
+	{
+		std::lock_guard<std::mutex> lock(mappedFileMutex);
+
+		generation = mappingGeneration;
+
+		auto it = mappedFiles.find(fileName);
+
+		if (it != mappedFiles.end() && it->second.generation == generation && !checkForChanges)
+		{
+			it->second.lastUse = ++mappingUseCount;
+			return it->second.file;
+		}
+	}
+
+	struct stat st;
+
+	if (stat(fileName.c_str(), &st) == -1)
+	{
+		throw std::runtime_error("Unable to stat file '" + fileName + "': " + strerror(errno));
+	}
+
+	std::lock_guard<std::mutex> lock(mappedFileMutex);
+
+	auto& entry = mappedFiles[fileName];
+
+	if (!entry.file || entry.file->Size() != static_cast<size_t>(st.st_size) ||
+	    entry.file->ModificationTime() != st.st_mtime)
+	{
+		// File is mapped for the first time or it has changed; old mapping stays valid
+		// as long as someone is still using it
+
+		try
+		{
+			entry.file = std::make_shared<const mapped_file>(fileName);
+		}
+		catch (...)
+		{
+			mappedFiles.erase(fileName);
+			throw;
+		}
+	}
+
+	entry.generation = generation;
+	entry.lastUse = ++mappingUseCount;
+
+	auto file = entry.file;
+
+	EvictMappedFiles();
+
+	return file;
+}
+
+void file_accessor::NewMappingGeneration()
+{
+	std::lock_guard<std::mutex> lock(mappedFileMutex);
+	mappingGeneration++;
+}
+
+void file_accessor::Unmap(const std::string& fileName)
+{
+	std::lock_guard<std::mutex> lock(mappedFileMutex);
+	mappedFiles.erase(fileName);
+}
 
-buffer file_accessor::Read(const file_information& finfo) const
+buffer file_accessor::Read(const file_information& finfo, const std::shared_ptr<statistics>& stats) const
 {
 	switch (finfo.storage_type)
 	{
 		case kLocalFileSystem:
 			return ReadFromLocalFile(finfo);
 		case kS3ObjectStorageSystem:
-			return s3::ReadFile(finfo);
+			return s3::ReadFile(finfo, stats);
 		default:
 			throw std::runtime_error("Unsupported storage system");
 	}
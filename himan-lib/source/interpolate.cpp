@@ -6,10 +6,18 @@
 #include "point_list.h"
 #include "reduced_gaussian_grid.h"
 #include "stereographic_grid.h"
+#include "thread_pool.h"
 #include "util.h"
 
 #include "plugin_factory.h"
 #include <Eigen/Dense>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define HIMAN_AUXILIARY_INCLUDE
 
@@ -43,6 +51,21 @@ int DataTypeId<double>()
 	return 2;
 }
 
+// Directory for persistent interpolation weights. Set once at startup
+// before any threads are started.
+
+static std::string interpolationCacheDirectory;
+
+void InterpolationCacheDirectory(const std::string& theDirectory)
+{
+	interpolationCacheDirectory = theDirectory;
+}
+
+std::string InterpolationCacheDirectory()
+{
+	return interpolationCacheDirectory;
+}
+
 bool IsSupportedGridForRotation(HPGridType type)
 {
 	switch (type)
@@ -64,12 +87,10 @@ bool InterpolateArea(const grid* baseGrid, std::shared_ptr<info<T>> source)
 		return false;
 	}
 
-#ifdef HAVE_CUDA
 	if (source->PackedData()->HasData())
 	{
 		util::Unpack<T>({source});
 	}
-#endif
 
 	base<T> target;
 	target.grid = std::shared_ptr<himan::grid>(baseGrid->Clone());
@@ -166,8 +187,11 @@ template bool ReorderPoints<float>(const grid*, std::shared_ptr<info<float>>);
 template <typename T>
 bool Interpolate(const grid* baseGrid, std::vector<std::shared_ptr<info<T>>>& infos)
 {
-	for (const auto& info : infos)
-	{
+	// Each info is handled in its own task in the thread pool
+
+	std::atomic<bool> ret(true);
+
+	auto interpolateOne = [&](const std::shared_ptr<info<T>>& info) {
 		bool needInterpolation = false;
 		bool needPointReordering = false;
 
@@ -193,13 +217,11 @@ bool Interpolate(const grid* baseGrid, std::vector<std::shared_ptr<info<T>>>& in
 			else if (dynamic_cast<const regular_grid*>(baseGrid)->ScanningMode() !=
 			         std::dynamic_pointer_cast<regular_grid>(info->Grid())->ScanningMode())
 			{
-#ifdef HAVE_CUDA
 				if (info->PackedData()->HasData())
 				{
 					// must unpack before swapping
 					util::Unpack<T>({info});
 				}
-#endif
 				util::Flip<T>(info->Data());
 				std::dynamic_pointer_cast<regular_grid>(info->Grid())
 				    ->ScanningMode(dynamic_cast<const regular_grid*>(baseGrid)->ScanningMode());
@@ -239,15 +261,22 @@ bool Interpolate(const grid* baseGrid, std::vector<std::shared_ptr<info<T>>>& in
 
 		if (needInterpolation && InterpolateArea<T>(baseGrid, info) == false)
 		{
-			return false;
+			ret = false;
 		}
 		else if (needPointReordering && ReorderPoints<T>(baseGrid, info) == false)
 		{
-			return false;
+			ret = false;
 		}
-	}
+	};
 
-	return true;
+	thread_pool::Instance()->ParallelFor(0, infos.size(), 1, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+		{
+			interpolateOne(infos[i]);
+		}
+	});
+
+	return ret;
 }
 
 template bool Interpolate<double>(const grid*, std::vector<std::shared_ptr<info<double>>>&);
@@ -579,7 +608,7 @@ std::pair<std::vector<size_t>, std::vector<T>> InterpolationWeights(reduced_gaus
 	else if (target.X() >= 360.0)
 		target.X(target.X() - 360.0);
 
-	const auto lats = source.Latitudes();
+	const auto& lats = source.Latitudes();
 
 	// check if point is inside domain
 	if (target.Y() >= lats.front())
@@ -603,14 +632,14 @@ std::pair<std::vector<size_t>, std::vector<T>> InterpolationWeights(reduced_gaus
 	size_t y_south = static_cast<size_t>(std::distance(lats.begin(), south));
 
 	// find x-indices
-	size_t x_north_west = static_cast<size_t>(
-	    std::floor(static_cast<double>(source.NumberOfPointsAlongParallels()[y_north]) * target.X() / 360.));
-	size_t x_north_east =
-	    x_north_west < static_cast<size_t>(source.NumberOfPointsAlongParallels()[y_north] - 1) ? x_north_west + 1 : 0;
-	size_t x_south_west = static_cast<size_t>(
-	    std::floor(static_cast<double>(source.NumberOfPointsAlongParallels()[y_south]) * target.X() / 360.));
-	size_t x_south_east =
-	    x_south_west < static_cast<size_t>(source.NumberOfPointsAlongParallels()[y_south] - 1) ? x_south_west + 1 : 0;
+	const auto& numPoints = source.NumberOfPointsAlongParallels();
+
+	size_t x_north_west =
+	    static_cast<size_t>(std::floor(static_cast<double>(numPoints[y_north]) * target.X() / 360.));
+	size_t x_north_east = x_north_west < static_cast<size_t>(numPoints[y_north] - 1) ? x_north_west + 1 : 0;
+	size_t x_south_west =
+	    static_cast<size_t>(std::floor(static_cast<double>(numPoints[y_south]) * target.X() / 360.));
+	size_t x_south_east = x_south_west < static_cast<size_t>(numPoints[y_south] - 1) ? x_south_west + 1 : 0;
 
 	/*
 	 *
@@ -737,7 +766,7 @@ std::pair<size_t, T> NearestPoint(reduced_gaussian_grid& source, point target)
 	else if (target.X() >= 360.0)
 		target.X(target.X() - 360.0);
 
-	const auto lats = source.Latitudes();
+	const auto& lats = source.Latitudes();
 
 	// find y-indices
 	auto south = std::lower_bound(lats.begin(), lats.end(), target.Y(), std::greater_equal<double>());
@@ -748,14 +777,14 @@ std::pair<size_t, T> NearestPoint(reduced_gaussian_grid& source, point target)
 	size_t y_south = std::distance(lats.begin(), south);
 
 	// find x-indices
-	size_t x_north_west = static_cast<size_t>(
-	    std::floor(static_cast<double>(source.NumberOfPointsAlongParallels()[y_north]) * target.X() / 360.));
-	size_t x_north_east =
-	    x_north_west < static_cast<size_t>(source.NumberOfPointsAlongParallels()[y_north] - 1) ? x_north_west + 1 : 0;
-	size_t x_south_west = static_cast<size_t>(
-	    std::floor(static_cast<double>(source.NumberOfPointsAlongParallels()[y_south]) * target.X() / 360.));
-	size_t x_south_east =
-	    x_south_west < static_cast<size_t>(source.NumberOfPointsAlongParallels()[y_south] - 1) ? x_south_west + 1 : 0;
+	const auto& numPoints = source.NumberOfPointsAlongParallels();
+
+	size_t x_north_west =
+	    static_cast<size_t>(std::floor(static_cast<double>(numPoints[y_north]) * target.X() / 360.));
+	size_t x_north_east = x_north_west < static_cast<size_t>(numPoints[y_north] - 1) ? x_north_west + 1 : 0;
+	size_t x_south_west =
+	    static_cast<size_t>(std::floor(static_cast<double>(numPoints[y_south]) * target.X() / 360.));
+	size_t x_south_east = x_south_west < static_cast<size_t>(numPoints[y_south] - 1) ? x_south_west + 1 : 0;
 
 	size_t nearest = x_north_west;
 	for (auto p : {x_north_east, x_south_west, x_south_east})
@@ -782,150 +811,465 @@ std::pair<size_t, T> NearestPoint(regular_grid& source, point target)
 	    static_cast<size_t>(std::round(xy.X())) + source.Ni() * static_cast<size_t>(std::round(xy.Y())), 1.0);
 }
 
+namespace
+{
+// Return the non-zero weights and corresponding source grid indices for
+// a single target point
+
+template <typename T>
+std::pair<std::vector<size_t>, std::vector<T>> PointWeights(grid& source, const point& target,
+                                                            HPInterpolationMethod method)
+{
+	std::pair<std::vector<size_t>, std::vector<T>> w;
+
+	switch (source.Type())
+	{
+		case kLatitudeLongitude:
+		case kRotatedLatitudeLongitude:
+		case kStereographic:
+		case kLambertConformalConic:
+			if (method == kBiLinear)
+			{
+				w = InterpolationWeights<T>(dynamic_cast<regular_grid&>(source), target);
+			}
+			else if (method == kNearestPoint)
+			{
+				auto np = NearestPoint<T>(dynamic_cast<regular_grid&>(source), target);
+				w.first.push_back(np.first);
+				w.second.push_back(np.second);
+			}
+			else
+			{
+				throw std::bad_typeid();
+			}
+			break;
+		case kReducedGaussian:
+			if (method == kBiLinear)
+			{
+				w = InterpolationWeights<T>(dynamic_cast<reduced_gaussian_grid&>(source), target);
+			}
+			else if (method == kNearestPoint)
+			{
+				auto np = NearestPoint<T>(dynamic_cast<reduced_gaussian_grid&>(source), target);
+				w.first.push_back(np.first);
+				w.second.push_back(np.second);
+			}
+			else
+			{
+				throw std::bad_typeid();
+			}
+			break;
+		default:
+			// what to throw?
+			throw std::bad_typeid();
+			break;
+	}
+
+	return w;
+}
+
+// Stereographic and lambert grids transform coordinates with gdal,
+// which cannot be used from multiple threads at the same time
+
+bool IsThreadSafeSource(HPGridType type)
+{
+	switch (type)
+	{
+		case kLatitudeLongitude:
+		case kRotatedLatitudeLongitude:
+		case kReducedGaussian:
+			return true;
+		default:
+			return false;
+	}
+}
+}  // namespace
+
 // area_interpolation class member functions definitions
 template <typename T>
 area_interpolation<T>::area_interpolation(grid& source, grid& target, HPInterpolationMethod method)
     : itsInterpolation(target.Size(), source.Size())
 {
-	std::vector<Triplet<T>> coefficients;
+	const size_t targetSize = target.Size();
+
+	// Target coordinates are resolved in this thread, target grid might
+	// be using gdal as well
+
+	std::vector<point> targetPoints(targetSize);
+
+	for (size_t i = 0; i < targetSize; ++i)
+	{
+		targetPoints[i] = target.LatLon(i);
+	}
+
 	// compute weights in the interpolation matrix line by line, i.e. point by point on target grid
-	for (size_t i = 0; i < target.Size(); ++i)
+	auto computeRows = [&](size_t first, size_t last) {
+		std::vector<Triplet<T>> coefficients;
+		coefficients.reserve(4 * (last - first));
+
+		for (size_t i = first; i < last; ++i)
+		{
+			const auto w = PointWeights<T>(source, targetPoints[i], method);
+
+			for (size_t j = 0; j < w.first.size(); ++j)
+			{
+				coefficients.push_back(Triplet<T>(static_cast<int>(i), static_cast<int>(w.first[j]), w.second[j]));
+			}
+		}
+
+		return coefficients;
+	};
+
+	// First row is computed before starting other threads: grids initialize
+	// some of their members lazily on first use
+
+	std::vector<Triplet<T>> coefficients = computeRows(0, std::min<size_t>(1, targetSize));
+
+	if (targetSize > 1)
 	{
-		std::pair<std::vector<size_t>, std::vector<T>> w;
-		switch (source.Type())
+		// Rows are computed in the thread pool, unless the source grid is not
+		// safe to use from multiple threads
+
+		const size_t taskCount = IsThreadSafeSource(source.Type()) ? thread_pool::Instance()->Size() : 1;
+		const size_t chunkSize = std::max<size_t>(1, (targetSize - 1 + taskCount - 1) / taskCount);
+
+		std::vector<std::vector<Triplet<T>>> parts((targetSize - 1 + chunkSize - 1) / chunkSize);
+
+		const auto computeChunk = [&](size_t first, size_t last) {
+			parts[(first - 1) / chunkSize] = computeRows(first, last);
+		};
+
+		if (taskCount == 1)
 		{
-			case kLatitudeLongitude:
-			case kRotatedLatitudeLongitude:
-			case kStereographic:
-			case kLambertConformalConic:
-				if (method == kBiLinear)
-				{
-					w = InterpolationWeights<T>(dynamic_cast<regular_grid&>(source), target.LatLon(i));
-				}
-				else if (method == kNearestPoint)
-				{
-					auto np = NearestPoint<T>(dynamic_cast<regular_grid&>(source), target.LatLon(i));
-					w.first.push_back(np.first);
-					w.second.push_back(np.second);
-				}
-				else
-				{
-					throw std::bad_typeid();
-				}
-				break;
-			case kReducedGaussian:
-				if (method == kBiLinear)
-				{
-					w = InterpolationWeights<T>(dynamic_cast<reduced_gaussian_grid&>(source), target.LatLon(i));
-				}
-				else if (method == kNearestPoint)
-				{
-					auto np = NearestPoint<T>(dynamic_cast<reduced_gaussian_grid&>(source), target.LatLon(i));
-					w.first.push_back(np.first);
-					w.second.push_back(np.second);
-				}
-				else
-				{
-					throw std::bad_typeid();
-				}
-				break;
-			default:
-				// what to throw?
-				throw std::bad_typeid();
-				break;
+			computeChunk(1, targetSize);
+		}
+		else
+		{
+			thread_pool::Instance()->ParallelFor(1, targetSize, chunkSize, computeChunk);
 		}
 
-		for (size_t j = 0; j < w.first.size(); ++j)
+		for (const auto& part : parts)
 		{
-			coefficients.push_back(Triplet<T>(static_cast<int>(i), static_cast<int>(w.first[j]), w.second[j]));
+			coefficients.insert(coefficients.end(), part.begin(), part.end());
 		}
 	}
 
 	itsInterpolation.setFromTriplets(coefficients.begin(), coefficients.end());
 }
 
+/*
+ * Weight file layout (native byte order):
+ *
+ *   weight_file_header
+ *   outer index:  int32 * (rows + 1)
+ *   inner index:  int32 * nonZeros
+ *   padding to 8 bytes
+ *   values:       T * nonZeros
+ *
+ * This is the compressed row storage of Eigen::SparseMatrix as is, so that
+ * the file can be used without copying after it has been memory mapped.
+ */
+
+struct weight_file_header
+{
+	char magic[8];
+	uint32_t dataType;
+	uint32_t indexSize;
+	uint64_t rows;
+	uint64_t cols;
+	uint64_t nonZeros;
+};
+
+namespace
+{
+const char kWeightFileMagic[8] = {'H', 'I', 'M', 'A', 'N', 'I', 'W', '1'};
+
+size_t ValuesOffset(uint64_t rows, uint64_t nonZeros)
+{
+	const size_t offset = sizeof(weight_file_header) + sizeof(int) * (rows + 1 + nonZeros);
+	return (offset + 7) & ~static_cast<size_t>(7);
+}
+}  // namespace
+
+struct weight_file
+{
+	weight_file(void* theAddress, size_t theLength) : address(theAddress), length(theLength)
+	{
+	}
+	~weight_file()
+	{
+		munmap(address, length);
+	}
+	weight_file(const weight_file&) = delete;
+	weight_file& operator=(const weight_file&) = delete;
+
+	const weight_file_header& Header() const
+	{
+		return *static_cast<const weight_file_header*>(address);
+	}
+	const int* OuterIndex() const
+	{
+		return reinterpret_cast<const int*>(static_cast<const char*>(address) + sizeof(weight_file_header));
+	}
+	const int* InnerIndex() const
+	{
+		return OuterIndex() + Header().rows + 1;
+	}
+	template <typename T>
+	const T* Values() const
+	{
+		return reinterpret_cast<const T*>(static_cast<const char*>(address) +
+		                                  ValuesOffset(Header().rows, Header().nonZeros));
+	}
+
+	void* address;
+	size_t length;
+};
+
 template <typename T>
 void area_interpolation<T>::Interpolate(base<T>& source, base<T>& target)
 {
 	Map<Matrix<T, Dynamic, Dynamic>> srcValues(source.data.ValuesAsPOD(), source.data.Size(), 1);
 	Map<Matrix<T, Dynamic, Dynamic>> trgValues(target.data.ValuesAsPOD(), target.data.Size(), 1);
 
+	if (itsWeightFile)
+	{
+		const auto& header = itsWeightFile->Header();
+		Map<const SparseMatrix<T, RowMajor>> weights(header.rows, header.cols, header.nonZeros,
+		                                             itsWeightFile->OuterIndex(), itsWeightFile->InnerIndex(),
+		                                             itsWeightFile->Values<T>());
+		trgValues = weights * srcValues;
+		return;
+	}
+
 	trgValues = itsInterpolation * srcValues;
 }
 
 template <typename T>
 size_t area_interpolation<T>::SourceSize() const
 {
-	return itsInterpolation.cols();
+	return (itsWeightFile) ? itsWeightFile->Header().cols : itsInterpolation.cols();
 }
 
 template <typename T>
 size_t area_interpolation<T>::TargetSize() const
 {
-	return itsInterpolation.rows();
+	return (itsWeightFile) ? itsWeightFile->Header().rows : itsInterpolation.rows();
 }
 
-// Interpolator member functions
 template <typename T>
-std::map<size_t, area_interpolation<T>> interpolator<T>::cache;
+bool area_interpolation<T>::Read(const std::string& fileName, size_t sourceSize, size_t targetSize)
+{
+	const int fd = open(fileName.c_str(), O_RDONLY);
 
-template <typename T>
-std::mutex interpolator<T>::interpolatorAccessMutex;
+	if (fd == -1)
+	{
+		return false;
+	}
 
-template <typename T>
-bool interpolator<T>::Insert(const base<T>& source, const base<T>& target, HPInterpolationMethod method)
-{
-	std::lock_guard<std::mutex> guard(interpolatorAccessMutex);
+	struct stat st;
+
+	if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(weight_file_header))
+	{
+		close(fd);
+		return false;
+	}
+
+	const size_t length = static_cast<size_t>(st.st_size);
+	void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
 
-	std::pair<size_t, himan::interpolate::area_interpolation<T>> insertValue;
+	// mapping stays valid after file descriptor is closed
+	close(fd);
 
-	try
+	if (address == MAP_FAILED)
 	{
-		std::vector<size_t> hashes{method, source.grid->Hash(), target.grid->Hash()};
-		insertValue.first = boost::hash_range(hashes.begin(), hashes.end());
+		return false;
+	}
 
-		// area_interpolation is already present in cache
-		if (cache.count(insertValue.first) > 0)
-			return true;
+	auto file = std::make_shared<const weight_file>(address, length);
+	const auto& header = file->Header();
 
-		insertValue.second = himan::interpolate::area_interpolation<T>(*source.grid, *target.grid, method);
+	if (memcmp(header.magic, kWeightFileMagic, sizeof(kWeightFileMagic)) != 0 ||
+	    header.dataType != static_cast<uint32_t>(DataTypeId<T>()) || header.indexSize != sizeof(int) ||
+	    header.rows != targetSize || header.cols != sourceSize ||
+	    length != ValuesOffset(header.rows, header.nonZeros) + sizeof(T) * header.nonZeros)
+	{
+		logger log("interpolate");
+		log.Warning("Ignoring invalid interpolation weight file " + fileName);
+		return false;
 	}
-	catch (const std::exception& e)
+
+	// Index arrays are used without bounds checks in the sparse matrix product,
+	// so a truncated or otherwise corrupted file must be caught here
+
+	const int* outer = file->OuterIndex();
+	const int* inner = file->InnerIndex();
+	const int cols = static_cast<int>(header.cols);
+
+	bool valid = (outer[0] == 0 && static_cast<uint64_t>(outer[header.rows]) == header.nonZeros);
+
+	for (size_t i = 0; valid && i < header.rows; i++)
 	{
+		valid = (outer[i] <= outer[i + 1]);
+	}
+
+	for (size_t i = 0; valid && i < header.nonZeros; i++)
+	{
+		valid = (inner[i] >= 0 && inner[i] < cols);
+	}
+
+	if (!valid)
+	{
+		logger log("interpolate");
+		log.Warning("Ignoring interpolation weight file with invalid indices " + fileName);
 		return false;
 	}
 
-	return cache.insert(std::move(insertValue)).second;
+	itsInterpolation = SparseMatrix<T, RowMajor>();
+	itsWeightFile = file;
+
+	return true;
 }
 
-// template bool interpolator::Insert<double>(const base<double>&, const base<double>&, HPInterpolationMethod);
-// template bool interpolator::Insert<float>(const base<float>&, const base<float>&, HPInterpolationMethod);
+template <typename T>
+void area_interpolation<T>::Write(const std::string& fileName) const
+{
+	ASSERT(!itsWeightFile);
+	ASSERT(itsInterpolation.isCompressed());
+
+	logger log("interpolate");
+
+	weight_file_header header;
+	memcpy(header.magic, kWeightFileMagic, sizeof(kWeightFileMagic));
+	header.dataType = static_cast<uint32_t>(DataTypeId<T>());
+	header.indexSize = sizeof(int);
+	header.rows = itsInterpolation.rows();
+	header.cols = itsInterpolation.cols();
+	header.nonZeros = itsInterpolation.nonZeros();
+
+	const size_t padding = ValuesOffset(header.rows, header.nonZeros) - sizeof(weight_file_header) -
+	                       sizeof(int) * (header.rows + 1 + header.nonZeros);
+	const char zeros[8] = {0};
+
+	const bool written = util::WriteFileAtomically(
+	    fileName,
+	    [&](std::ostream& out) {
+		    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		    out.write(reinterpret_cast<const char*>(itsInterpolation.outerIndexPtr()),
+		              sizeof(int) * (header.rows + 1));
+		    out.write(reinterpret_cast<const char*>(itsInterpolation.innerIndexPtr()), sizeof(int) * header.nonZeros);
+		    out.write(zeros, padding);
+		    out.write(reinterpret_cast<const char*>(itsInterpolation.valuePtr()), sizeof(T) * header.nonZeros);
+	    },
+	    true);
+
+	if (!written)
+	{
+		log.Warning("Unable to write interpolation weight file " + fileName);
+		return;
+	}
+
+	log.Debug("Wrote interpolation weights to " + fileName);
+}
+
+// Interpolator member functions
 
 template <typename T>
-bool interpolator<T>::Interpolate(base<T>& source, base<T>& target, HPInterpolationMethod method)
+std::string WeightFileName(size_t hash)
+{
+	if (interpolationCacheDirectory.empty())
+	{
+		return "";
+	}
+
+	std::stringstream ss;
+	ss << interpolationCacheDirectory << "/" << std::hex << hash << "_" << DataTypeId<T>() << ".weights";
+
+	return ss.str();
+}
+
+template <typename T>
+std::map<size_t, std::shared_ptr<typename interpolator<T>::cache_entry>> interpolator<T>::cache;
+
+template <typename T>
+std::mutex interpolator<T>::interpolatorAccessMutex;
+
+template <typename T>
+std::shared_ptr<typename interpolator<T>::cache_entry> interpolator<T>::Entry(const base<T>& source,
+                                                                                const base<T>& target,
+                                                                                HPInterpolationMethod method)
 {
 	std::vector<size_t> hashes{method, source.grid->Hash(), target.grid->Hash()};
-	auto it = cache.find(boost::hash_range(hashes.begin(), hashes.end()));
+	const size_t hash = boost::hash_range(hashes.begin(), hashes.end());
+
+	std::shared_ptr<cache_entry> entry;
 
-	if (it != cache.end())
 	{
+		// Global lock is only held while looking up the entry
+		std::lock_guard<std::mutex> guard(interpolatorAccessMutex);
+
+		auto& ref = cache[hash];
+
+		if (!ref)
+		{
+			ref = std::make_shared<cache_entry>();
+		}
+
+		entry = ref;
+	}
+
+	std::call_once(entry->flag, [&]() {
 		try
 		{
-			it->second.Interpolate(source, target);
-			return true;
+			// Weights might have been created by an earlier himan process
+
+			const std::string fileName = WeightFileName<T>(hash);
+
+			if (fileName.empty() ||
+			    !entry->interpolation.Read(fileName, source.grid->Size(), target.grid->Size()))
+			{
+				entry->interpolation = area_interpolation<T>(*source.grid, *target.grid, method);
+
+				if (!fileName.empty())
+				{
+					entry->interpolation.Write(fileName);
+				}
+			}
+
+			entry->valid = true;
 		}
-		catch (const boost::bad_get& e)
+		catch (const std::exception& e)
 		{
-			std::cout << e.what() << std::endl;
-			return false;
+			// Failure is remembered so that it is not retried for every grid
+			logger log("interpolate");
+			log.Error("Unable to create interpolation: " + std::string(e.what()));
 		}
-	}
+	});
 
-	else
+	return entry;
+}
+
+template <typename T>
+bool interpolator<T>::Insert(const base<T>& source, const base<T>& target, HPInterpolationMethod method)
+{
+	return Entry(source, target, method)->valid;
+}
+
+// template bool interpolator::Insert<double>(const base<double>&, const base<double>&, HPInterpolationMethod);
+// template bool interpolator::Insert<float>(const base<float>&, const base<float>&, HPInterpolationMethod);
+
+template <typename T>
+bool interpolator<T>::Interpolate(base<T>& source, base<T>& target, HPInterpolationMethod method)
+{
+	auto entry = Entry(source, target, method);
+
+	if (!entry->valid)
 	{
-		Insert(source, target, method);
-		return Interpolate(source, target, method);
+		return false;
 	}
+
+	entry->interpolation.Interpolate(source, target);
+	return true;
 }
 
 // template bool interpolator::Interpolate<double>(base<double>&, base<double>&, HPInterpolationMethod);
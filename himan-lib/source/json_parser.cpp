@@ -283,6 +283,49 @@ vector<shared_ptr<plugin_configuration>> json_parser::ParseConfigurationFile(sha
 		throw runtime_error(string("Error parsing key cache_limit: ") + e.what());
 	}
 
+	// Check global cache_limit_bytes option; command line option has precedence
+
+	try
+	{
+		if (conf->CacheLimitBytes() == 0)
+		{
+			conf->CacheLimitBytes(util::ParseByteSize(pt.get<string>("cache_limit_bytes")));
+		}
+	}
+	catch (boost::property_tree::ptree_bad_path& e)
+	{
+		// Something was not found; do nothing
+	}
+	catch (exception& e)
+	{
+		throw runtime_error(string("Error parsing key cache_limit_bytes: ") + e.what());
+	}
+
+	if (conf->CacheLimitBytes() > 0)
+	{
+		plugin::cache_pool::Instance()->CacheLimitBytes(conf->CacheLimitBytes());
+	}
+
+	// Check global interpolation_cache_dir option; command line option has precedence
+
+	try
+	{
+		if (conf->InterpolationCacheDirectory().empty())
+		{
+			conf->InterpolationCacheDirectory(pt.get<string>("interpolation_cache_dir"));
+		}
+	}
+	catch (boost::property_tree::ptree_bad_path& e)
+	{
+		// Something was not found; do nothing
+	}
+	catch (exception& e)
+	{
+		throw runtime_error(string("Error parsing key interpolation_cache_dir: ") + e.what());
+	}
+
+	interpolate::InterpolationCacheDirectory(conf->InterpolationCacheDirectory());
+
 	// Check global file_type option
 
 	try
@@ -349,6 +392,13 @@ vector<shared_ptr<plugin_configuration>> json_parser::ParseConfigurationFile(sha
 		throw runtime_error(string("Error parsing key dynamic_memory_allocation: ") + e.what());
 	}
 
+	if (conf->NumaPlacement())
+	{
+		// Target grids are allocated by the worker threads that calculate them,
+		// so that the memory is on their NUMA node
+		conf->UseDynamicMemoryAllocation(true);
+	}
+
 	/* Check storage_type */
 
 	try
@@ -665,6 +715,30 @@ vector<shared_ptr<plugin_configuration>> json_parser::ParseConfigurationFile(sha
 				{
 					pc->AsyncExecution(util::ParseBoolean(value));
 				}
+				else if (key == "id")
+				{
+					pc->Id(value);
+				}
+				else if (key == "depends_on")
+				{
+					// Empty list means that plugin has no dependencies
+
+					vector<string> dependencies;
+
+					if (value.empty())
+					{
+						for (const auto& dep : kv.second)
+						{
+							dependencies.push_back(dep.second.get<string>(""));
+						}
+					}
+					else
+					{
+						dependencies = util::Split(value, ",", false);
+					}
+
+					pc->DependsOn(dependencies);
+				}
 				else
 				{
 					if (value.empty())
@@ -689,6 +763,19 @@ vector<shared_ptr<plugin_configuration>> json_parser::ParseConfigurationFile(sha
 
 			ASSERT(pc.unique());
 
+			for (const auto& dep : pc->DependsOn())
+			{
+				// Only plugins listed earlier can be depended on: this also
+				// guarantees that there are no cyclic dependencies
+
+				if (none_of(pluginContainer.begin(), pluginContainer.end(),
+				            [&dep](const shared_ptr<plugin_configuration>& c) { return c->Id() == dep; }))
+				{
+					throw runtime_error(ClassName() + ": plugin '" + pc->Id() + "' depends on '" + dep +
+					                    "' which is not listed before it");
+				}
+			}
+
 			pc->OrdinalNumber(static_cast<unsigned int>(pluginContainer.size()));
 			pc->RelativeOrdinalNumber(static_cast<unsigned int>(
 			    count_if(pluginContainer.begin(), pluginContainer.end(),
@@ -279,6 +279,49 @@ void modifier::Process(const std::vector<double>& theData, const std::vector<dou
 	itsGridsProcessed++;
 }
 
+template <typename M>
+void modifier::ProcessGrid(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	Init(theData, theHeights);
+
+	M* self = static_cast<M*>(this);
+
+	const size_t N = theData.size();
+	const double* __restrict data = theData.data();
+	const double* __restrict heights = theHeights.data();
+	double* previousValues = itsPreviousValue.data();
+	double* previousHeights = itsPreviousHeight.data();
+
+	for (size_t i = 0; i < N; i++)
+	{
+		const double theValue = data[i];
+		const double theHeight = heights[i];
+
+		const double thePreviousValue = previousValues[i];
+		const double thePreviousHeight = previousHeights[i];
+
+		if (!IsMissing(theValue) && !IsMissing(theHeight))
+		{
+			previousValues[i] = theValue;
+			previousHeights[i] = theHeight;
+		}
+
+		// Calculate() and Evaluate() read the current grid point from itsIndex
+
+		itsIndex = i;
+
+		if (!modifier::Evaluate(theValue, theHeight, thePreviousValue, thePreviousHeight))
+		{
+			continue;
+		}
+
+		self->M::Calculate(theValue, theHeight, thePreviousValue, thePreviousHeight);
+	}
+
+	itsIndex = N;
+	itsGridsProcessed++;
+}
+
 size_t modifier::HeightsCrossed() const
 {
 	return static_cast<size_t>(count(itsOutOfBoundHeights.begin(), itsOutOfBoundHeights.end(), true));
@@ -1284,3 +1327,67 @@ const std::vector<double>& modifier_plusminusarea::Result() const
 	                   itsMinusArea.end());  // append MinusArea at the end of PlusArea
 	return itsPlusArea;                      // return PlusMinusArea
 }
+
+// Process() of concrete modifiers: the loop over grid points is instantiated
+// separately for each modifier, so that Calculate() is not called through the
+// virtual table for every grid point.
+
+void modifier_max::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_max>(theData, theHeights);
+}
+
+void modifier_min::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_min>(theData, theHeights);
+}
+
+void modifier_maxmin::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_maxmin>(theData, theHeights);
+}
+
+void modifier_sum::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_sum>(theData, theHeights);
+}
+
+void modifier_integral::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_integral>(theData, theHeights);
+}
+
+void modifier_mean::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_mean>(theData, theHeights);
+}
+
+void modifier_count::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_count>(theData, theHeights);
+}
+
+void modifier_findheight::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_findheight>(theData, theHeights);
+}
+
+void modifier_findheight_gt::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_findheight_gt>(theData, theHeights);
+}
+
+void modifier_findheight_lt::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_findheight_lt>(theData, theHeights);
+}
+
+void modifier_findvalue::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_findvalue>(theData, theHeights);
+}
+
+void modifier_plusminusarea::Process(const std::vector<double>& theData, const std::vector<double>& theHeights)
+{
+	ProcessGrid<modifier_plusminusarea>(theData, theHeights);
+}
@@ -21,7 +21,10 @@ plugin_configuration::plugin_configuration()
       itsPreconfiguredParams(),
       itsStatistics(new statistics),
       itsOrdinalNumber(0),
-      itsRelativeOrdinalNumber(0)
+      itsRelativeOrdinalNumber(0),
+      itsId(),
+      itsDependsOn(),
+      itsDependenciesDeclared(false)
 {
 }
 
@@ -32,7 +35,10 @@ plugin_configuration::plugin_configuration(const configuration& theConfiguration
       itsPreconfiguredParams(),
       itsStatistics(new statistics),
       itsOrdinalNumber(0),
-      itsRelativeOrdinalNumber(0)
+      itsRelativeOrdinalNumber(0),
+      itsId(),
+      itsDependsOn(),
+      itsDependenciesDeclared(false)
 {
 }
 
@@ -44,7 +50,10 @@ plugin_configuration::plugin_configuration(const plugin_configuration& other)
       itsStatistics(new statistics(*other.itsStatistics)),
       itsBaseGrid(other.itsBaseGrid->Clone()),
       itsOrdinalNumber(other.itsOrdinalNumber),
-      itsRelativeOrdinalNumber(other.itsRelativeOrdinalNumber)
+      itsRelativeOrdinalNumber(other.itsRelativeOrdinalNumber),
+      itsId(other.itsId),
+      itsDependsOn(other.itsDependsOn),
+      itsDependenciesDeclared(other.itsDependenciesDeclared)
 {
 }
 
@@ -54,7 +63,10 @@ plugin_configuration::plugin_configuration(const string& theName, const map<stri
       itsPreconfiguredParams(),
       itsStatistics(new statistics),
       itsOrdinalNumber(0),
-      itsRelativeOrdinalNumber(0)
+      itsRelativeOrdinalNumber(0),
+      itsId(),
+      itsDependsOn(),
+      itsDependenciesDeclared(false)
 {
 }
 
@@ -157,6 +169,7 @@ void plugin_configuration::WriteStatistics()
 	cout << setw(30) << left << "Plugin:" << itsName << endl
 	     << setw(30) << left << "Use cache for reads:" << (itsUseCacheForReads ? "true" : "false") << endl
 	     << setw(30) << left << "Use cache for writes:" << (itsUseCacheForWrites ? "true" : "false") << endl
+	     << setw(30) << left << "Use packed cache:" << (itsUsePackedCache ? "true" : "false") << endl
 	     << setw(30) << left << "Use cuda:" << (itsUseCuda ? "true" : "false") << endl
 	     << setw(30) << left << "Use cuda unpacking:" << (itsUseCudaForUnpacking ? "true" : "false") << endl
 	     << setw(30) << left << "Target geom_name:" << itsTargetGeomName << endl
@@ -204,6 +217,24 @@ void plugin_configuration::WriteStatistics()
 	     << setw(2) << procP << "%)" << endl
 	     << setw(30) << left << "Writing time:" << setw(7) << right << itsStatistics->itsWritingTime << " ms ("
 	     << setw(2) << writeP << "%)" << endl
+	     << setw(30) << left << "Writer thread count:" << WriteThreadCount() << endl
+	     << setw(30) << left << "Write queue wait time:" << setw(7) << right << itsStatistics->itsWriteQueueWaitTime
+	     << " ms" << endl
+	     << setw(30) << left << "Write drain time:" << setw(7) << right << itsStatistics->itsWriteDrainTime << " ms"
+	     << endl
+	     << setw(30) << left << "Prefetched grids:" << itsStatistics->itsPrefetchCount << endl
+	     << setw(30) << left << "Prefetch overlap time:" << setw(7) << right << itsStatistics->itsPrefetchTime << " ms"
+	     << endl
+	     << setw(30) << left << "S3 read requests:" << itsStatistics->itsS3ReadCount << endl
+	     << setw(30) << left << "S3 read bytes:" << itsStatistics->itsS3ReadBytes << endl
+	     << setw(30) << left << "S3 read time:" << setw(7) << right << itsStatistics->itsS3ReadTime << " ms" << endl
+	     << setw(30) << left << "S3 read speed:"
+	     << ((itsStatistics->itsS3ReadTime > 0)
+	             ? static_cast<int>(static_cast<double>(itsStatistics->itsS3ReadBytes) / 1024. / 1024. /
+	                                (static_cast<double>(itsStatistics->itsS3ReadTime) / 1000.))
+	             : 0)
+	     << " MB/s" << endl
+	     << setw(30) << left << "S3 block cache hits:" << itsStatistics->itsS3BlockCacheHitCount << endl
 	     << setw(30) << left << "Values:" << itsStatistics->itsValueCount << endl
 	     << setw(30) << left << "Missing values:" << itsStatistics->itsMissingValueCount << " ("
 	     << static_cast<int>(100 * static_cast<double>(itsStatistics->itsMissingValueCount) /
@@ -260,3 +291,29 @@ void plugin_configuration::RelativeOrdinalNumber(unsigned int theRelativeOrdinal
 {
 	itsRelativeOrdinalNumber = theRelativeOrdinalNumber;
 }
+
+string plugin_configuration::Id() const
+{
+	return itsId.empty() ? itsName : itsId;
+}
+
+void plugin_configuration::Id(const string& theId)
+{
+	itsId = theId;
+}
+
+const vector<string>& plugin_configuration::DependsOn() const
+{
+	return itsDependsOn;
+}
+
+void plugin_configuration::DependsOn(const vector<string>& theDependencies)
+{
+	itsDependsOn = theDependencies;
+	itsDependenciesDeclared = true;
+}
+
+bool plugin_configuration::DependenciesDeclared() const
+{
+	return itsDependenciesDeclared;
+}
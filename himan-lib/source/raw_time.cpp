@@ -4,6 +4,7 @@
  */
 
 #include "raw_time.h"
+#include <limits>
 #include <mutex>
 
 static std::mutex formatMutex;
@@ -196,6 +197,18 @@ bool raw_time::IsLeapYear() const
 	return boost::gregorian::gregorian_calendar::is_leap_year(itsDateTime.date().year());
 }
 
+time_t raw_time::ToEpoch() const
+{
+	if (itsDateTime.is_special())
+	{
+		return std::numeric_limits<time_t>::min();
+	}
+
+	static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+
+	return static_cast<time_t>((itsDateTime - epoch).total_seconds());
+}
+
 std::ostream& raw_time::Write(std::ostream& file) const
 {
 	file << "<" << ClassName() << ">" << std::endl;
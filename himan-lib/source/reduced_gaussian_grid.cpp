@@ -46,7 +46,7 @@ size_t reduced_gaussian_grid::Size() const
 	return itsAccumulatedPointsAlongParallels.back();
 }
 
-std::vector<int> reduced_gaussian_grid::NumberOfPointsAlongParallels() const
+const std::vector<int>& reduced_gaussian_grid::NumberOfPointsAlongParallels() const
 {
 	return itsNumberOfPointsAlongParallels;
 }
@@ -81,7 +81,7 @@ std::vector<size_t> reduced_gaussian_grid::AccumulatedPointsAlongParallels() con
 	return itsAccumulatedPointsAlongParallels;
 }
 
-std::vector<double> reduced_gaussian_grid::Latitudes() const
+const std::vector<double>& reduced_gaussian_grid::Latitudes() const
 {
 	return itsLatitudes;
 }
@@ -1,13 +1,22 @@
-#ifdef HAVE_S3
 #include "s3.h"
+using namespace himan;
+
+#ifdef HAVE_S3
 #include "debug.h"
+#include "timer.h"
 #include "util.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <libs3.h>
+#include <list>
+#include <map>
 #include <mutex>
 #include <string.h>  // memcpy
-
-using namespace himan;
+#include <thread>
 
 static std::once_flag oflag;
 
@@ -15,6 +24,19 @@ const char* access_key = 0;
 const char* secret_key = 0;
 const char* security_token = 0;
 
+// Reads are extended by this many bytes, and ranges of the same object that
+// are closer than this to each other are combined to one request
+size_t readAhead = 1024 * 1024;
+
+// Maximum size of the block cache holding recently read ranges
+size_t blockCacheSize = 64 * 1024 * 1024;
+
+// Number of threads uploading parts of objects in the background, and the size
+// of the parts. S3 requires that all but the last part are at least 5MB.
+size_t uploadThreadCount = 4;
+const size_t minimumPartSize = 5 * 1024 * 1024;
+size_t partSize = 8 * 1024 * 1024;
+
 thread_local S3Status statusG = S3StatusOK;
 
 void CheckS3Error(S3Status errarg, const char* file, const int line);
@@ -82,17 +104,6 @@ static void responseCompleteCallback(S3Status status, const S3ErrorDetails* erro
 
 thread_local S3ResponseHandler responseHandler = {&responsePropertiesCallback, &responseCompleteCallback};
 
-static S3Status getObjectDataCallback(int bufferSize, const char* buffer, void* callbackData)
-{
-	himan::buffer* ret = static_cast<himan::buffer*>(callbackData);
-
-	ret->data = static_cast<unsigned char*>(realloc(ret->data, ret->length + bufferSize));
-	memcpy(ret->data + ret->length, buffer, bufferSize);
-	ret->length += bufferSize;
-
-	return S3StatusOK;
-}
-
 void Initialize()
 {
 	call_once(oflag, [&]() {
@@ -115,28 +126,263 @@ void Initialize()
 			himan::Abort();
 		}
 
+		try
+		{
+			if (getenv("S3_READ_AHEAD"))
+			{
+				readAhead = util::ParseByteSize(getenv("S3_READ_AHEAD"));
+			}
+
+			if (getenv("S3_BLOCK_CACHE_SIZE"))
+			{
+				blockCacheSize = util::ParseByteSize(getenv("S3_BLOCK_CACHE_SIZE"));
+			}
+
+			if (getenv("S3_UPLOAD_THREADS"))
+			{
+				uploadThreadCount = std::max(1, std::stoi(getenv("S3_UPLOAD_THREADS")));
+			}
+
+			if (getenv("S3_PART_SIZE"))
+			{
+				partSize = std::max(minimumPartSize, util::ParseByteSize(getenv("S3_PART_SIZE")));
+			}
+		}
+		catch (const std::exception& e)
+		{
+			logr.Fatal("Invalid value for S3_READ_AHEAD, S3_BLOCK_CACHE_SIZE, S3_UPLOAD_THREADS or S3_PART_SIZE");
+			himan::Abort();
+		}
+
 		S3_CHECK(S3_initialize("s3", S3_INIT_ALL, NULL));
 	});
 }
 
-buffer s3::ReadFile(const file_information& fileInformation)
+void LogStatus(S3Status status)
 {
-	Initialize();
+	logger logr("s3");
+
+	switch (status)
+	{
+		case S3StatusOK:
+			break;
+		case S3StatusInternalError:
+			logr.Error(std::string(S3_get_status_name(status)) + ": is there a proxy blocking the connection?");
+			break;
+		case S3StatusFailedToConnect:
+			logr.Error(std::string(S3_get_status_name(status)) + ": is proxy required but not set?");
+			break;
+		case S3StatusErrorInvalidAccessKeyId:
+			logr.Error(std::string(S3_get_status_name(status)) +
+			           ": are Temporary Security Credentials used without security token (env: S3_SESSION_TOKEN)?");
+			break;
+		default:
+			logr.Error(S3_get_status_name(status));
+			break;
+	}
+}
 
-	S3GetObjectHandler getObjectHandler = {responseHandler, &getObjectDataCallback};
+namespace
+{
+std::string ObjectName(const file_information& finfo)
+{
+	return finfo.file_server + "/" + finfo.file_location;
+}
 
-	const auto bucketAndFileName = GetBucketAndFileName(fileInformation.file_location);
-	const auto bucket = bucketAndFileName[0];
-	const auto key = bucketAndFileName[1];
+bool HasRange(const file_information& finfo)
+{
+	return finfo.offset && finfo.length;
+}
+
+// Block cache: recently read ranges of objects, least recently used first out
+
+struct cached_block
+{
+	std::string objectName;
+	unsigned long offset;
+	std::shared_ptr<const std::vector<unsigned char>> data;
+};
+
+std::mutex blockCacheMutex;
+std::list<cached_block> blockCache;
+size_t blockCacheBytes = 0;
+
+bool FromBlockCache(const file_information& finfo, buffer& ret)
+{
+	if (!HasRange(finfo))
+	{
+		return false;
+	}
+
+	const std::string objectName = ObjectName(finfo);
+	const unsigned long offset = finfo.offset.get();
+	const unsigned long length = finfo.length.get();
+
+	std::shared_ptr<const std::vector<unsigned char>> data;
+	unsigned long start = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(blockCacheMutex);
+
+		for (auto it = blockCache.begin(); it != blockCache.end(); ++it)
+		{
+			if (it->objectName == objectName && it->offset <= offset &&
+			    it->offset + it->data->size() >= offset + length)
+			{
+				data = it->data;
+				start = offset - it->offset;
+				blockCache.splice(blockCache.begin(), blockCache, it);
+				break;
+			}
+		}
+	}
+
+	if (!data)
+	{
+		return false;
+	}
+
+	ret.data = static_cast<unsigned char*>(malloc(length));
+	ret.length = length;
+	memcpy(ret.data, data->data() + start, length);
+
+	return true;
+}
+
+void ToBlockCache(const std::string& objectName, unsigned long offset,
+                  const std::shared_ptr<const std::vector<unsigned char>>& data)
+{
+	if (data->size() > blockCacheSize)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(blockCacheMutex);
+
+	blockCache.push_front({objectName, offset, data});
+	blockCacheBytes += data->size();
+
+	while (blockCacheBytes > blockCacheSize)
+	{
+		blockCacheBytes -= blockCache.back().data->size();
+		blockCache.pop_back();
+	}
+}
+
+// One GET request, possibly covering the ranges of several file informations
+
+struct get_request
+{
+	std::string server;
+	std::string bucket;
+	std::string key;
+	unsigned long offset;
+	unsigned long length;
+
+	std::vector<size_t> members;
+
+	std::vector<unsigned char> data;
+	S3Status status;
+	bool completed;
+};
+
+S3Status getRequestPropertiesCallback(const S3ResponseProperties* properties, void* callbackData)
+{
+	return S3StatusOK;
+}
+
+void getRequestCompleteCallback(S3Status status, const S3ErrorDetails* error, void* callbackData)
+{
+	auto req = static_cast<get_request*>(callbackData);
+	req->status = status;
+	req->completed = true;
+}
+
+S3Status getRequestDataCallback(int bufferSize, const char* buffer, void* callbackData)
+{
+	auto& data = static_cast<get_request*>(callbackData)->data;
+	data.insert(data.end(), buffer, buffer + bufferSize);
+
+	return S3StatusOK;
+}
+
+// Combine ranges of the same object that overlap or are close to each other
+
+std::vector<get_request> CreateRequests(const std::vector<file_information>& files, const std::vector<size_t>& indexes)
+{
+	std::map<std::string, std::vector<size_t>> objects;
+
+	for (size_t i : indexes)
+	{
+		objects[ObjectName(files[i])].push_back(i);
+	}
+
+	std::vector<get_request> requests;
+
+	for (auto& object : objects)
+	{
+		auto& members = object.second;
+
+		std::sort(members.begin(), members.end(), [&](size_t a, size_t b) {
+			return (HasRange(files[a]) ? files[a].offset.get() : 0) < (HasRange(files[b]) ? files[b].offset.get() : 0);
+		});
+
+		for (size_t i : members)
+		{
+			const auto& finfo = files[i];
 
-	buffer ret;
+			if (!HasRange(finfo))
+			{
+				// Whole object is read, without read-ahead or caching
+				const auto bucketAndFileName = GetBucketAndFileName(finfo.file_location);
+				requests.push_back({finfo.file_server, bucketAndFileName[0], bucketAndFileName[1], 0, 0, {i}, {},
+				                    S3StatusOK, false});
+				continue;
+			}
 
+			const unsigned long offset = finfo.offset.get();
+			const unsigned long end = offset + finfo.length.get();
+
+			if (!requests.empty())
+			{
+				auto& prev = requests.back();
+
+				if (prev.length > 0 && ObjectName(files[prev.members[0]]) == object.first &&
+				    offset <= prev.offset + prev.length + readAhead)
+				{
+					prev.length = std::max(prev.offset + prev.length, end) - prev.offset;
+					prev.members.push_back(i);
+					continue;
+				}
+			}
+
+			const auto bucketAndFileName = GetBucketAndFileName(finfo.file_location);
+			requests.push_back({finfo.file_server, bucketAndFileName[0], bucketAndFileName[1], offset, end - offset,
+			                    {i}, {}, S3StatusOK, false});
+		}
+	}
+
+	// Read-ahead: if the object ends before, S3 returns only the data that exists
+
+	for (auto& req : requests)
+	{
+		if (req.length > 0)
+		{
+			req.length += readAhead;
+		}
+	}
+
+	return requests;
+}
+
+S3BucketContext BucketContext(const get_request& req)
+{
 	// clang-format off
 
-	S3BucketContext bucketContext = 
+	S3BucketContext bucketContext =
 	{
-		fileInformation.file_server.c_str(),
-		bucket.c_str(),
+		req.server.c_str(),
+		req.bucket.c_str(),
 		S3ProtocolHTTP,
 		S3UriStylePath,
 		access_key,
@@ -146,82 +392,263 @@ buffer s3::ReadFile(const file_information& fileInformation)
 
 	// clang-format on
 
+	return bucketContext;
+}
+
+// Execute requests concurrently in one request context. Requests that fail
+// with a retryable error are retried one by one.
+
+void ExecuteRequests(std::vector<get_request>& requests, const std::shared_ptr<statistics>& stats)
+{
+	if (requests.empty())
+	{
+		return;
+	}
+
 	logger logr("s3");
 
-	int count = 0;
-	do
+	S3GetObjectHandler getObjectHandler = {{&getRequestPropertiesCallback, &getRequestCompleteCallback},
+	                                       &getRequestDataCallback};
+
+	// Bucket contexts point to the strings of requests, and they must be valid
+	// until the requests have finished
+
+	std::vector<S3BucketContext> bucketContexts;
+	bucketContexts.reserve(requests.size());
+
+	for (const auto& req : requests)
 	{
-		if (count > 0)
+		bucketContexts.push_back(BucketContext(req));
+	}
+
+	timer t(true);
+
+	S3RequestContext* requestContext = nullptr;
+	S3_CHECK(S3_create_request_context(&requestContext));
+
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		auto& req = requests[i];
+		S3_get_object(&bucketContexts[i], req.key.c_str(), NULL, req.offset, req.length, requestContext,
+		              &getObjectHandler, &req);
+	}
+
+	const S3Status status = S3_runall_request_context(requestContext);
+	S3_destroy_request_context(requestContext);
+
+	if (status != S3StatusOK)
+	{
+		logr.Warning(std::string("Running S3 requests failed: ") + S3_get_status_name(status));
+	}
+
+	size_t requestCount = requests.size();
+
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		auto& req = requests[i];
+
+		// Request might not have been completed at all if running the context failed
+
+		for (int count = 1; (!req.completed || S3_status_is_retryable(req.status)) && count < 3; count++)
 		{
 			sleep(2 * count);
+
+			req.data.clear();
+			req.completed = false;
+			S3_get_object(&bucketContexts[i], req.key.c_str(), NULL, req.offset, req.length, NULL, &getObjectHandler,
+			              &req);
+			requestCount++;
 		}
-		const unsigned long offset = fileInformation.offset.get();
-		const unsigned long length = fileInformation.length.get();
 
-		S3_get_object(&bucketContext, key.c_str(), NULL, offset, length, NULL, &getObjectHandler, &ret);
-		logr.Debug("Reading from host=" + fileInformation.file_server + " bucket=" + bucket + " key=" + key + " " +
-		           std::to_string(offset) + ":" + std::to_string(length) + " (" + S3_get_status_name(statusG) + ")");
-		count++;
-	} while (S3_status_is_retryable(statusG) && count < 3);
+		logr.Debug("Reading from host=" + req.server + " bucket=" + req.bucket + " key=" + req.key + " " +
+		           std::to_string(req.offset) + ":" + std::to_string(req.length) + " (" +
+		           S3_get_status_name(req.status) + ")");
+	}
+
+	t.Stop();
 
-	switch (statusG)
+	if (stats)
 	{
-		case S3StatusOK:
-			break;
-		case S3StatusInternalError:
-			logr.Error(std::string(S3_get_status_name(statusG)) + ": is there a proxy blocking the connection?");
-			throw himan::kFileDataNotFound;
-		case S3StatusFailedToConnect:
-			logr.Error(std::string(S3_get_status_name(statusG)) + ": is proxy required but not set?");
-			throw himan::kFileDataNotFound;
-		case S3StatusErrorInvalidAccessKeyId:
-			logr.Error(std::string(S3_get_status_name(statusG)) +
-			           ": are Temporary Security Credentials used without security token (env: S3_SESSION_TOKEN)?");
-			throw himan::kFileDataNotFound;
-		default:
-			logr.Error(S3_get_status_name(statusG));
-			throw himan::kFileDataNotFound;
+		size_t bytes = 0;
+
+		for (const auto& req : requests)
+		{
+			bytes += req.data.size();
+		}
+
+		stats->AddToS3ReadCount(requestCount);
+		stats->AddToS3ReadBytes(bytes);
+		stats->AddToS3ReadTime(t.GetTime());
+	}
+}
+
+// Read ranges that are not in block cache. Returns the status of each range.
+
+std::vector<S3Status> ReadRanges(const std::vector<file_information>& files, std::vector<buffer>* ret,
+                                 const std::shared_ptr<statistics>& stats)
+{
+	Initialize();
+
+	std::vector<S3Status> statuses(files.size(), S3StatusOK);
+	std::vector<size_t> missing;
+
+	size_t cacheHits = 0;
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		buffer tmp;
+
+		if (FromBlockCache(files[i], ret ? (*ret)[i] : tmp))
+		{
+			cacheHits++;
+			continue;
+		}
+
+		missing.push_back(i);
 	}
 
-	if (ret.length == 0)
+	if (stats)
 	{
-		throw himan::kFileDataNotFound;
+		stats->AddToS3BlockCacheHitCount(cacheHits);
 	}
 
-	return ret;
+	auto requests = CreateRequests(files, missing);
+
+	ExecuteRequests(requests, stats);
+
+	for (auto& req : requests)
+	{
+		if (req.status != S3StatusOK)
+		{
+			for (size_t i : req.members)
+			{
+				statuses[i] = req.status;
+			}
+			continue;
+		}
+
+		if (!req.completed)
+		{
+			// Buffers of members stay empty
+			continue;
+		}
+
+		if (req.length == 0)
+		{
+			// Whole object
+			ASSERT(req.members.size() == 1);
+
+			if (ret)
+			{
+				auto& buf = (*ret)[req.members[0]];
+				buf.data = static_cast<unsigned char*>(malloc(req.data.size()));
+				buf.length = req.data.size();
+				memcpy(buf.data, req.data.data(), req.data.size());
+			}
+			continue;
+		}
+
+		const auto data = std::make_shared<const std::vector<unsigned char>>(std::move(req.data));
+
+		ToBlockCache(ObjectName(files[req.members[0]]), req.offset, data);
+
+		if (!ret)
+		{
+			continue;
+		}
+
+		for (size_t i : req.members)
+		{
+			const unsigned long start = files[i].offset.get() - req.offset;
+			const unsigned long length = files[i].length.get();
+
+			if (start + length > data->size())
+			{
+				// Object is shorter than what was requested
+				continue;
+			}
+
+			auto& buf = (*ret)[i];
+			buf.data = static_cast<unsigned char*>(malloc(length));
+			buf.length = length;
+			memcpy(buf.data, data->data() + start, length);
+		}
+	}
+
+	return statuses;
 }
+}  // namespace
 
-struct write_data
+buffer s3::ReadFile(const file_information& fileInformation, const std::shared_ptr<statistics>& stats)
 {
-	himan::buffer buffer;
-	size_t write_ptr;
-};
+	std::vector<buffer> ret(1);
+
+	const auto statuses = ReadRanges({fileInformation}, &ret, stats);
+
+	if (statuses[0] != S3StatusOK)
+	{
+		LogStatus(statuses[0]);
+		throw himan::kFileDataNotFound;
+	}
+
+	if (ret[0].length == 0)
+	{
+		throw himan::kFileDataNotFound;
+	}
+
+	return std::move(ret[0]);
+}
 
-static int putObjectDataCallback(int bufferSize, char* buffer, void* callbackData)
+std::vector<buffer> s3::ReadFiles(const std::vector<file_information>& fileInformations,
+                                  const std::shared_ptr<statistics>& stats)
 {
-	write_data* data = static_cast<write_data*>(callbackData);
-	int bytesWritten = 0;
+	std::vector<buffer> ret(fileInformations.size());
+
+	const auto statuses = ReadRanges(fileInformations, &ret, stats);
 
-	if (data->buffer.length)
+	for (const auto status : statuses)
 	{
-		bytesWritten =
-		    static_cast<int>((static_cast<int>(data->buffer.length) > bufferSize) ? bufferSize : data->buffer.length);
-		memcpy(buffer, data->buffer.data + data->write_ptr, bytesWritten);
-		data->write_ptr += bytesWritten;
-		data->buffer.length -= bytesWritten;
+		LogStatus(status);
 	}
 
-	return bytesWritten;
+	return ret;
 }
 
-void s3::WriteObject(const std::string& objectName, const himan::buffer& buff)
+void s3::Prefetch(const std::vector<file_information>& fileInformations, const std::shared_ptr<statistics>& stats)
 {
 	Initialize();
 
-	const auto bucketAndFileName = GetBucketAndFileName(objectName);
-	const auto bucket = bucketAndFileName[0];
-	const auto key = bucketAndFileName[1];
+	std::vector<file_information> files;
+	size_t bytes = 0;
+
+	for (const auto& finfo : fileInformations)
+	{
+		if (!HasRange(finfo))
+		{
+			continue;
+		}
+
+		bytes += finfo.length.get() + readAhead;
+
+		if (bytes > blockCacheSize / 2)
+		{
+			break;
+		}
 
+		files.push_back(finfo);
+	}
+
+	ReadRanges(files, nullptr, stats);
+}
+
+// Writes: messages written with write_mode 'few' or 'all' are collected to
+// parts of a multipart upload, and the parts are uploaded concurrently by a
+// pool of background threads
+
+namespace
+{
+const char* WriteHost()
+{
 	const char* host = getenv("S3_HOSTNAME");
 
 	if (!host)
@@ -229,11 +656,16 @@ void s3::WriteObject(const std::string& objectName, const himan::buffer& buff)
 		throw std::runtime_error("Environment variable S3_HOSTNAME not defined");
 	}
 
+	return host;
+}
+
+S3BucketContext WriteBucketContext(const std::string& bucket)
+{
 	// clang-format off
 
 	S3BucketContext bucketContext =
 	{
-		host,
+		WriteHost(),
 		bucket.c_str(),
 		S3ProtocolHTTP,
 		S3UriStylePath,
@@ -244,60 +676,651 @@ void s3::WriteObject(const std::string& objectName, const himan::buffer& buff)
 
 	// clang-format on
 
-	S3PutObjectHandler putObjectHandler = {responseHandler, &putObjectDataCallback};
+	return bucketContext;
+}
 
-	write_data data;
-	data.buffer.data = buff.data;
-	data.buffer.length = buff.length;
-	data.write_ptr = 0;
+// State of one PUT request: data to send and the response
 
-	logger logr("s3");
+struct put_data
+{
+	const unsigned char* data;
+	size_t length;
+	size_t written;
+	std::string eTag;
+	S3Status status;
+};
 
-	int count = 0;
-	do
+S3Status putPropertiesCallback(const S3ResponseProperties* properties, void* callbackData)
+{
+	if (properties->eTag)
+	{
+		static_cast<put_data*>(callbackData)->eTag = properties->eTag;
+	}
+
+	return S3StatusOK;
+}
+
+void putCompleteCallback(S3Status status, const S3ErrorDetails* error, void* callbackData)
+{
+	static_cast<put_data*>(callbackData)->status = status;
+}
+
+int putDataCallback(int bufferSize, char* buffer, void* callbackData)
+{
+	auto data = static_cast<put_data*>(callbackData);
+	const size_t bytes = std::min(static_cast<size_t>(bufferSize), data->length - data->written);
+
+	memcpy(buffer, data->data + data->written, bytes);
+	data->written += bytes;
+
+	return static_cast<int>(bytes);
+}
+
+S3Status multipartInitialCallback(const char* uploadId, void* callbackData)
+{
+	*static_cast<std::string*>(callbackData) = uploadId;
+	return S3StatusOK;
+}
+
+S3Status multipartCommitCallback(const char* location, const char* eTag, void* callbackData)
+{
+	return S3StatusOK;
+}
+
+// Run a PUT request, retrying if the error is transient. 'request' is called
+// with the put data, whose write position is reset before each try.
+
+template <typename T>
+S3Status Put(put_data& data, T request)
+{
+	int count = 0;
+
+	do
 	{
 		if (count > 0)
 		{
 			sleep(2 * count);
 		}
 
-		S3_put_object(&bucketContext, key.c_str(), buff.length, NULL, NULL, &putObjectHandler, &data);
-		logr.Debug("Writing to host=" + std::string(host) + " bucket=" + bucket + " key=" + key + " (" +
-		           S3_get_status_name(statusG) + ")");
+		data.written = 0;
+		data.eTag.clear();
+		data.status = S3StatusOK;
+
+		request();
 
+		count++;
+	} while (S3_status_is_retryable(data.status) && count < 3);
+
+	return data.status;
+}
+
+S3Status PutObject(const std::string& bucket, const std::string& key, const unsigned char* buff, size_t length)
+{
+	S3BucketContext bucketContext = WriteBucketContext(bucket);
+	S3PutObjectHandler handler = {{&putPropertiesCallback, &putCompleteCallback}, &putDataCallback};
+
+	put_data data{buff, length, 0, "", S3StatusOK};
+
+	return Put(data, [&]() {
+		S3_put_object(&bucketContext, key.c_str(), length, NULL, NULL, &handler, &data);
+	});
+}
+
+// Object that is written in parts
+
+struct multipart_object
+{
+	std::string bucket;
+	std::string key;
+	std::string uploadId;
+
+	// data that is not yet given to upload threads
+	std::vector<unsigned char> part;
+
+	unsigned long size;
+	int partCount;
+	std::map<int, std::string> eTags;
+	bool failed;
+
+	// Name of the plugin that writes the object
+	std::string writerName;
+
+	// Multipart upload is being initiated by one of the writing threads
+	bool initiating;
+
+	// Number of parts that are queued or being uploaded
+	int inFlight;
+};
+
+std::mutex uploadMutex;
+std::condition_variable uploadQueueCondition;
+std::condition_variable uploadDoneCondition;
+
+std::map<std::string, multipart_object> uploads;
+
+// Objects that have been finished, value is true if the upload failed
+std::map<std::string, bool> finishedUploads;
+std::deque<std::function<void()>> uploadQueue;
+std::vector<std::thread> uploadThreads;
+size_t activeUploads = 0;
+bool stopUploads = false;
+
+void UploadThread()
+{
+	while (true)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(uploadMutex);
+			uploadQueueCondition.wait(lock, []() { return stopUploads || !uploadQueue.empty(); });
+
+			if (uploadQueue.empty())
+			{
+				return;
+			}
+
+			task = std::move(uploadQueue.front());
+			uploadQueue.pop_front();
+			activeUploads++;
+		}
+
+		uploadDoneCondition.notify_all();
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(uploadMutex);
+			activeUploads--;
+		}
+
+		uploadDoneCondition.notify_all();
+	}
+}
+
+void StopUploadThreads();
+
+void Enqueue(std::function<void()> task)
+{
+	std::unique_lock<std::mutex> lock(uploadMutex);
+
+	if (uploadThreads.empty())
+	{
+		// Threads must be joined before they are destroyed at exit, even if
+		// Flush() is never called
+
+		static std::once_flag exitFlag;
+		std::call_once(exitFlag, []() { atexit(&StopUploadThreads); });
+
+		stopUploads = false;
+
+		for (size_t i = 0; i < uploadThreadCount; i++)
+		{
+			uploadThreads.emplace_back(&UploadThread);
+		}
+	}
+
+	// Limit the amount of data waiting for upload: writer blocks until
+	// upload threads catch up
+
+	uploadDoneCondition.wait(lock, []() { return uploadQueue.size() < 2 * uploadThreads.size(); });
+
+	uploadQueue.push_back(std::move(task));
+	uploadQueueCondition.notify_one();
+}
+
+void StopUploadThreads()
+{
+	{
+		std::lock_guard<std::mutex> lock(uploadMutex);
+		stopUploads = true;
+	}
+
+	uploadQueueCondition.notify_all();
+
+	for (auto& thread : uploadThreads)
+	{
+		thread.join();
+	}
+
+	uploadThreads.clear();
+}
+
+void UploadPart(multipart_object* object, int partNumber, std::shared_ptr<std::vector<unsigned char>> part)
+{
+	S3BucketContext bucketContext = WriteBucketContext(object->bucket);
+	S3PutObjectHandler handler = {{&putPropertiesCallback, &putCompleteCallback}, &putDataCallback};
+
+	put_data data{part->data(), part->size(), 0, "", S3StatusOK};
+
+	const S3Status status = Put(data, [&]() {
+		S3_upload_part(&bucketContext, object->key.c_str(), NULL, &handler, partNumber, object->uploadId.c_str(),
+		               static_cast<int>(part->size()), NULL, &data);
+	});
+
+	logger logr("s3");
+	logr.Debug("Uploaded part " + std::to_string(partNumber) + " of bucket=" + object->bucket +
+	           " key=" + object->key + " (" + S3_get_status_name(status) + ")");
+
+	{
+		std::lock_guard<std::mutex> lock(uploadMutex);
+
+		if (status == S3StatusOK)
+		{
+			object->eTags[partNumber] = data.eTag;
+		}
+		else
+		{
+			LogStatus(status);
+			object->failed = true;
+		}
+
+		object->inFlight--;
+	}
+
+	uploadDoneCondition.notify_all();
+}
+
+void UploadWholeObject(multipart_object* object, std::shared_ptr<std::vector<unsigned char>> data)
+{
+	const S3Status status = PutObject(object->bucket, object->key, data->data(), data->size());
+
+	logger logr("s3");
+	logr.Debug("Writing to host=" + std::string(WriteHost()) + " bucket=" + object->bucket + " key=" + object->key +
+	           " (" + S3_get_status_name(status) + ")");
+
+	{
+		std::lock_guard<std::mutex> lock(uploadMutex);
+
+		if (status != S3StatusOK)
+		{
+			LogStatus(status);
+			object->failed = true;
+		}
+
+		object->inFlight--;
+	}
+
+	uploadDoneCondition.notify_all();
+}
+
+std::string InitiateMultipartUpload(const std::string& bucket, const std::string& key)
+{
+	S3BucketContext bucketContext = WriteBucketContext(bucket);
+	S3MultipartInitialHandler handler = {responseHandler, &multipartInitialCallback};
+
+	std::string uploadId;
+
+	int count = 0;
+	do
+	{
+		if (count > 0)
+		{
+			sleep(2 * count);
+		}
+
+		S3_initiate_multipart(&bucketContext, key.c_str(), NULL, &handler, NULL, &uploadId);
 		count++;
 	} while (S3_status_is_retryable(statusG) && count < 3);
 
-	// remove pointer to original buff so that double free doesn't occur
-	data.buffer.data = 0;
+	if (statusG != S3StatusOK)
+	{
+		LogStatus(statusG);
+		return "";
+	}
+
+	return uploadId;
+}
+
+bool CompleteMultipartUpload(const multipart_object& object)
+{
+	std::string xml = "<CompleteMultipartUpload>";
 
-	switch (statusG)
+	for (const auto& eTag : object.eTags)
 	{
-		case S3StatusOK:
-			break;
-		case S3StatusInternalError:
-			logr.Error(std::string(S3_get_status_name(statusG)) + ": is there a proxy blocking the connection?");
-			throw himan::kFileDataNotFound;
-		case S3StatusFailedToConnect:
-			logr.Error(std::string(S3_get_status_name(statusG)) + ": is proxy required but not set?");
-			throw himan::kFileDataNotFound;
-		case S3StatusErrorInvalidAccessKeyId:
-			logr.Error(std::string(S3_get_status_name(statusG)) +
-			           ": are Temporary Security Credentials used without security token (env: S3_SESSION_TOKEN)?");
-			throw himan::kFileDataNotFound;
-		default:
-			logr.Error(S3_get_status_name(statusG));
-			throw himan::kFileDataNotFound;
+		xml += "<Part><PartNumber>" + std::to_string(eTag.first) + "</PartNumber><ETag>" + eTag.second +
+		       "</ETag></Part>";
+	}
+
+	xml += "</CompleteMultipartUpload>";
+
+	S3BucketContext bucketContext = WriteBucketContext(object.bucket);
+	S3MultipartCommitHandler handler = {
+	    {&putPropertiesCallback, &putCompleteCallback}, &putDataCallback, &multipartCommitCallback};
+
+	put_data data{reinterpret_cast<const unsigned char*>(xml.data()), xml.size(), 0, "", S3StatusOK};
+
+	const S3Status status = Put(data, [&]() {
+		S3_complete_multipart_upload(&bucketContext, object.key.c_str(), &handler, object.uploadId.c_str(),
+		                             static_cast<int>(xml.size()), NULL, &data);
+	});
+
+	if (status != S3StatusOK)
+	{
+		LogStatus(status);
+		return false;
+	}
+
+	return true;
+}
+
+void AbortMultipartUpload(const multipart_object& object)
+{
+	S3BucketContext bucketContext = WriteBucketContext(object.bucket);
+	S3AbortMultipartUploadHandler handler = {responseHandler};
+
+	S3_abort_multipart_upload(&bucketContext, object.key.c_str(), object.uploadId.c_str(), &handler);
+
+	if (statusG != S3StatusOK)
+	{
+		LogStatus(statusG);
+	}
+}
+}  // namespace
+
+void s3::WriteObject(const std::string& objectName, const himan::buffer& buff)
+{
+	Initialize();
+
+	const auto bucketAndFileName = GetBucketAndFileName(objectName);
+	const auto bucket = bucketAndFileName[0];
+	const auto key = bucketAndFileName[1];
+
+	const S3Status status = PutObject(bucket, key, buff.data, buff.length);
+
+	logger logr("s3");
+	logr.Debug("Writing to host=" + std::string(WriteHost()) + " bucket=" + bucket + " key=" + key + " (" +
+	           S3_get_status_name(status) + ")");
+
+	if (status != S3StatusOK)
+	{
+		LogStatus(status);
+		throw himan::kFileDataNotFound;
+	}
+}
+
+void s3::AppendToObject(const std::string& objectName, const himan::buffer& buff, const std::string& writerName)
+{
+	Initialize();
+
+	std::unique_lock<std::mutex> lock(uploadMutex);
+
+	auto it = uploads.find(objectName);
+
+	if (it == uploads.end())
+	{
+		if (finishedUploads.count(objectName))
+		{
+			throw std::runtime_error("Object '" + objectName + "' has already been finished, unable to append to it");
+		}
+
+		const auto bucketAndFileName = GetBucketAndFileName(objectName);
+		it = uploads
+		         .emplace(objectName, multipart_object{bucketAndFileName[0], bucketAndFileName[1], "", {}, 0, 0, {},
+		                                               false, writerName, false, 0})
+		         .first;
+	}
+
+	multipart_object* object = &it->second;
+
+	if (object->failed)
+	{
+		throw std::runtime_error("Upload of object '" + objectName + "' has failed");
+	}
+
+	object->size += buff.length;
+	object->part.insert(object->part.end(), buff.data, buff.data + buff.length);
+
+	if (object->part.size() < partSize || object->initiating)
+	{
+		// Thread that is initiating the upload takes also the data that is
+		// appended meanwhile
+		return;
+	}
+
+	if (object->uploadId.empty())
+	{
+		// Initiating is a network request: other writers are not blocked
+		// while it is in progress
+
+		object->initiating = true;
+		lock.unlock();
+
+		const std::string uploadId = InitiateMultipartUpload(object->bucket, object->key);
+
+		lock.lock();
+		object->initiating = false;
+		uploadDoneCondition.notify_all();
+
+		if (uploadId.empty())
+		{
+			object->failed = true;
+			object->part.clear();
+			throw std::runtime_error("Unable to initiate upload of object '" + objectName + "'");
+		}
+
+		object->uploadId = uploadId;
+	}
+
+	auto part = std::make_shared<std::vector<unsigned char>>(std::move(object->part));
+	object->part.clear();
+
+	const int partNumber = ++object->partCount;
+	object->inFlight++;
+
+	lock.unlock();
+
+	Enqueue([=]() { UploadPart(object, partNumber, part); });
+}
+
+unsigned long s3::AppendedObjectSize(const std::string& objectName)
+{
+	std::lock_guard<std::mutex> lock(uploadMutex);
+
+	const auto it = uploads.find(objectName);
+	return (it == uploads.end()) ? 0 : it->second.size;
+}
+
+bool s3::IsIncompleteObject(const std::string& objectName)
+{
+	std::lock_guard<std::mutex> lock(uploadMutex);
+
+	if (uploads.count(objectName))
+	{
+		return true;
+	}
+
+	const auto it = finishedUploads.find(objectName);
+	return (it != finishedUploads.end() && it->second);
+}
+
+namespace
+{
+// Upload remaining data of the objects of given writer (or all objects if
+// writerName is empty) and complete them. Returns the number of objects that
+// could not be written.
+
+size_t FinishObjects(const std::string& writerName)
+{
+	logger logr("s3");
+
+	std::vector<std::string> names;
+	std::vector<std::function<void()>> tasks;
+
+	{
+		std::unique_lock<std::mutex> lock(uploadMutex);
+
+		for (const auto& upload : uploads)
+		{
+			if (writerName.empty() || upload.second.writerName == writerName)
+			{
+				names.push_back(upload.first);
+			}
+		}
+
+		uploadDoneCondition.wait(lock, [&]() {
+			return std::none_of(names.begin(), names.end(),
+			                    [](const std::string& name) { return uploads.at(name).initiating; });
+		});
+
+		// Upload remaining data: objects smaller than part size are written with
+		// a single request, others get their last (possibly smaller) part
+
+		for (const auto& name : names)
+		{
+			auto object = &uploads.at(name);
+
+			if (object->failed || (object->part.empty() && !object->uploadId.empty()))
+			{
+				continue;
+			}
+
+			auto part = std::make_shared<std::vector<unsigned char>>(std::move(object->part));
+			object->part.clear();
+			object->inFlight++;
+
+			if (object->uploadId.empty())
+			{
+				tasks.push_back([=]() { UploadWholeObject(object, part); });
+			}
+			else
+			{
+				const int partNumber = ++object->partCount;
+				tasks.push_back([=]() { UploadPart(object, partNumber, part); });
+			}
+		}
+	}
+
+	for (auto& task : tasks)
+	{
+		Enqueue(std::move(task));
+	}
+
+	std::vector<multipart_object> objects;
+
+	{
+		std::unique_lock<std::mutex> lock(uploadMutex);
+
+		uploadDoneCondition.wait(lock, [&]() {
+			return std::none_of(names.begin(), names.end(),
+			                    [](const std::string& name) { return uploads.at(name).inFlight > 0; });
+		});
+
+		for (const auto& name : names)
+		{
+			objects.push_back(std::move(uploads.at(name)));
+			uploads.erase(name);
+		}
+	}
+
+	size_t failed = 0;
+	std::vector<bool> ok(objects.size(), true);
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const auto& object = objects[i];
+
+		if (!object.uploadId.empty())
+		{
+			if (object.failed || static_cast<int>(object.eTags.size()) != object.partCount ||
+			    !CompleteMultipartUpload(object))
+			{
+				AbortMultipartUpload(object);
+				ok[i] = false;
+			}
+			else
+			{
+				logr.Debug("Completed upload of bucket=" + object.bucket + " key=" + object.key + " (" +
+				           std::to_string(object.partCount) + " parts, " + std::to_string(object.size) + " bytes)");
+			}
+		}
+		else if (object.failed)
+		{
+			ok[i] = false;
+		}
+
+		if (!ok[i])
+		{
+			failed++;
+			logr.Error("Failed to upload bucket=" + object.bucket + " key=" + object.key);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(uploadMutex);
+
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			finishedUploads[names[i]] = !ok[i];
+		}
+	}
+
+	return failed;
+}
+}  // namespace
+
+void s3::Flush(const std::string& writerName)
+{
+	const size_t failed = FinishObjects(writerName);
+
+	if (failed > 0)
+	{
+		throw std::runtime_error("Failed to upload " + std::to_string(failed) + " objects of " + writerName +
+		                         " to S3");
+	}
+}
+
+void s3::Flush()
+{
+	// Objects of plugins have usually been finished already, but upload
+	// threads are stopped in any case
+
+	const size_t failed = FinishObjects("");
+
+	StopUploadThreads();
+
+	if (failed > 0)
+	{
+		throw std::runtime_error("Failed to upload " + std::to_string(failed) + " objects to S3");
 	}
 }
 
 #else
-buffer s3::ReadFile(const file_information& fileInformation)
+#include <stdexcept>
+
+buffer s3::ReadFile(const file_information& fileInformation, const std::shared_ptr<statistics>& stats)
+{
+	throw std::runtime_error("S3 support not compiled");
+}
+std::vector<buffer> s3::ReadFiles(const std::vector<file_information>& fileInformations,
+                                  const std::shared_ptr<statistics>& stats)
+{
+	throw std::runtime_error("S3 support not compiled");
+}
+void s3::Prefetch(const std::vector<file_information>& fileInformations, const std::shared_ptr<statistics>& stats)
 {
 	throw std::runtime_error("S3 support not compiled");
 }
-void s3::WriteObject()
+void s3::WriteObject(const std::string& objectName, const himan::buffer& buff)
 {
 	throw std::runtime_error("S3 support not compiled");
 }
+void s3::AppendToObject(const std::string& objectName, const himan::buffer& buff, const std::string& writerName)
+{
+	throw std::runtime_error("S3 support not compiled");
+}
+unsigned long s3::AppendedObjectSize(const std::string& objectName)
+{
+	return 0;
+}
+bool s3::IsIncompleteObject(const std::string& objectName)
+{
+	return false;
+}
+void s3::Flush(const std::string& writerName)
+{
+}
+void s3::Flush()
+{
+}
 #endif
@@ -0,0 +1,482 @@
+/**
+ * @file simple_packing.cpp
+ *
+ */
+
+#include "simple_packing.h"
+#include "himan_common.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if defined __x86_64__ && defined __GNUC__
+#define HIMAN_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace himan;
+
+namespace
+{
+enum class instruction_set
+{
+	kScalar,
+	kAVX2,
+	kAVX512
+};
+
+instruction_set SupportedInstructionSet()
+{
+#ifdef HIMAN_SIMD_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f"))
+	{
+		return instruction_set::kAVX512;
+	}
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return instruction_set::kAVX2;
+	}
+#endif
+	return instruction_set::kScalar;
+}
+
+instruction_set InstructionSet()
+{
+	static const instruction_set isa = SupportedInstructionSet();
+	return isa;
+}
+
+// Largest number of bits per value that vectorized versions can handle: a
+// value must fit to a single 32 bit word read from any bit offset
+const int kMaxVectorBitsPerValue = 25;
+
+inline uint32_t ExtractValue(const unsigned char* packed, size_t bitPosition, int bitsPerValue)
+{
+	const size_t byte = bitPosition >> 3;
+	const int shift = static_cast<int>(bitPosition & 7);
+	const int byteCount = (shift + bitsPerValue + 7) >> 3;
+
+	uint64_t acc = 0;
+
+	for (int i = 0; i < byteCount; i++)
+	{
+		acc = (acc << 8) | packed[byte + static_cast<size_t>(i)];
+	}
+
+	const uint64_t mask = (uint64_t(1) << bitsPerValue) - 1;
+
+	return static_cast<uint32_t>((acc >> (byteCount * 8 - shift - bitsPerValue)) & mask);
+}
+
+// Value is calculated in the same order as in grib_api, so that results
+// are identical
+
+inline double Scale(uint32_t x, const simple_packing::coefficients& c)
+{
+	return (static_cast<double>(x) * c.binaryScaleFactor + c.referenceValue) * c.decimalScaleFactor;
+}
+
+template <typename T>
+void DecodeScalar(const unsigned char* packed, size_t first, size_t last, T* out,
+                  const simple_packing::coefficients& c)
+{
+	const size_t bpv = static_cast<size_t>(c.bitsPerValue);
+
+	for (size_t i = first; i < last; i++)
+	{
+		out[i] = static_cast<T>(Scale(ExtractValue(packed, i * bpv, c.bitsPerValue), c));
+	}
+}
+
+#ifdef HIMAN_SIMD_X86
+
+// Vectorized decoders process values starting from 'first' as long as full
+// 32 bit words can be read from packed data, and return the index of the
+// first value that was not decoded.
+
+__attribute__((target("avx2"))) inline void Store8(double* out, __m256d lo, __m256d hi)
+{
+	_mm256_storeu_pd(out, lo);
+	_mm256_storeu_pd(out + 4, hi);
+}
+
+__attribute__((target("avx2"))) inline void Store8(float* out, __m256d lo, __m256d hi)
+{
+	_mm_storeu_ps(out, _mm256_cvtpd_ps(lo));
+	_mm_storeu_ps(out + 4, _mm256_cvtpd_ps(hi));
+}
+
+template <typename T>
+__attribute__((target("avx2"))) size_t DecodeAVX2(const unsigned char* packed, size_t packedLength, size_t first,
+                                                    size_t last, T* out, const simple_packing::coefficients& c)
+{
+	const size_t bpv = static_cast<size_t>(c.bitsPerValue);
+
+	// Reverse byte order of each 32 bit word: packed data is big endian
+	const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6,
+	                                       5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	const __m256i laneBits = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+	                                            _mm256_set1_epi32(c.bitsPerValue));
+	const __m128i rightShift = _mm_cvtsi32_si128(32 - c.bitsPerValue);
+	const __m256i seven = _mm256_set1_epi32(7);
+	const __m256d bs = _mm256_set1_pd(c.binaryScaleFactor);
+	const __m256d rv = _mm256_set1_pd(c.referenceValue);
+	const __m256d ds = _mm256_set1_pd(c.decimalScaleFactor);
+
+	size_t i = first;
+
+	for (; i + 8 <= last; i += 8)
+	{
+		const size_t bitPosition = i * bpv;
+		const size_t byte = bitPosition >> 3;
+
+		// Last lane reads four bytes starting from this offset
+		if (byte + ((7 + 7 * bpv) >> 3) + 4 > packedLength)
+		{
+			break;
+		}
+
+		const __m256i bits = _mm256_add_epi32(laneBits, _mm256_set1_epi32(static_cast<int>(bitPosition & 7)));
+		const __m256i offsets = _mm256_srli_epi32(bits, 3);
+		const __m256i shifts = _mm256_and_si256(bits, seven);
+
+		__m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(packed + byte), offsets, 1);
+		words = _mm256_shuffle_epi8(words, bswap);
+		words = _mm256_srl_epi32(_mm256_sllv_epi32(words, shifts), rightShift);
+
+		const __m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(words));
+		const __m256d hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(words, 1));
+
+		Store8(out + i, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(lo, bs), rv), ds),
+		       _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(hi, bs), rv), ds));
+	}
+
+	return i;
+}
+
+__attribute__((target("avx512f"))) inline void Store16(double* out, __m512d lo, __m512d hi)
+{
+	_mm512_storeu_pd(out, lo);
+	_mm512_storeu_pd(out + 8, hi);
+}
+
+__attribute__((target("avx512f"))) inline void Store16(float* out, __m512d lo, __m512d hi)
+{
+	_mm256_storeu_ps(out, _mm512_cvtpd_ps(lo));
+	_mm256_storeu_ps(out + 8, _mm512_cvtpd_ps(hi));
+}
+
+template <typename T>
+__attribute__((target("avx512f"))) size_t DecodeAVX512(const unsigned char* packed, size_t packedLength,
+                                                         size_t first, size_t last, T* out,
+                                                         const simple_packing::coefficients& c)
+{
+	const size_t bpv = static_cast<size_t>(c.bitsPerValue);
+
+	const __m512i laneBits =
+	    _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+	                       _mm512_set1_epi32(c.bitsPerValue));
+	const __m128i rightShift = _mm_cvtsi32_si128(32 - c.bitsPerValue);
+	const __m512i seven = _mm512_set1_epi32(7);
+	const __m512i byteMask = _mm512_set1_epi32(0xff00);
+	const __m512d bs = _mm512_set1_pd(c.binaryScaleFactor);
+	const __m512d rv = _mm512_set1_pd(c.referenceValue);
+	const __m512d ds = _mm512_set1_pd(c.decimalScaleFactor);
+
+	size_t i = first;
+
+	for (; i + 16 <= last; i += 16)
+	{
+		const size_t bitPosition = i * bpv;
+		const size_t byte = bitPosition >> 3;
+
+		if (byte + ((7 + 15 * bpv) >> 3) + 4 > packedLength)
+		{
+			break;
+		}
+
+		const __m512i bits = _mm512_add_epi32(laneBits, _mm512_set1_epi32(static_cast<int>(bitPosition & 7)));
+		const __m512i offsets = _mm512_srli_epi32(bits, 3);
+		const __m512i shifts = _mm512_and_si512(bits, seven);
+
+		__m512i words = _mm512_i32gather_epi32(offsets, packed + byte, 1);
+
+		// Byte swap with AVX-512F instructions only
+		words = _mm512_or_si512(
+		    _mm512_or_si512(_mm512_slli_epi32(words, 24), _mm512_srli_epi32(words, 24)),
+		    _mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(words, 8), byteMask),
+		                    _mm512_and_si512(_mm512_slli_epi32(words, 8), _mm512_slli_epi32(byteMask, 8))));
+		words = _mm512_srl_epi32(_mm512_sllv_epi32(words, shifts), rightShift);
+
+		const __m512d lo = _mm512_cvtepi32_pd(_mm512_castsi512_si256(words));
+		const __m512d hi = _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(words, 1));
+
+		Store16(out + i, _mm512_mul_pd(_mm512_add_pd(_mm512_mul_pd(lo, bs), rv), ds),
+		        _mm512_mul_pd(_mm512_add_pd(_mm512_mul_pd(hi, bs), rv), ds));
+	}
+
+	return i;
+}
+
+// Minimum and maximum: vector min/max instructions return the second operand
+// if either one is nan, so accumulator is given as the second operand
+
+__attribute__((target("avx2"))) size_t MinMaxAVX2(const double* values, size_t length, double& min, double& max)
+{
+	__m256d vmin = _mm256_set1_pd(min), vmax = _mm256_set1_pd(max);
+	size_t i = 0;
+
+	for (; i + 4 <= length; i += 4)
+	{
+		const __m256d v = _mm256_loadu_pd(values + i);
+		vmin = _mm256_min_pd(v, vmin);
+		vmax = _mm256_max_pd(v, vmax);
+	}
+
+	double mins[4], maxs[4];
+	_mm256_storeu_pd(mins, vmin);
+	_mm256_storeu_pd(maxs, vmax);
+
+	for (int j = 0; j < 4; j++)
+	{
+		min = fmin(min, mins[j]);
+		max = fmax(max, maxs[j]);
+	}
+
+	return i;
+}
+
+__attribute__((target("avx2"))) size_t MinMaxAVX2(const float* values, size_t length, float& min, float& max)
+{
+	__m256 vmin = _mm256_set1_ps(min), vmax = _mm256_set1_ps(max);
+	size_t i = 0;
+
+	for (; i + 8 <= length; i += 8)
+	{
+		const __m256 v = _mm256_loadu_ps(values + i);
+		vmin = _mm256_min_ps(v, vmin);
+		vmax = _mm256_max_ps(v, vmax);
+	}
+
+	float mins[8], maxs[8];
+	_mm256_storeu_ps(mins, vmin);
+	_mm256_storeu_ps(maxs, vmax);
+
+	for (int j = 0; j < 8; j++)
+	{
+		min = fminf(min, mins[j]);
+		max = fmaxf(max, maxs[j]);
+	}
+
+	return i;
+}
+
+__attribute__((target("avx512f"))) size_t MinMaxAVX512(const double* values, size_t length, double& min,
+                                                         double& max)
+{
+	__m512d vmin = _mm512_set1_pd(min), vmax = _mm512_set1_pd(max);
+	size_t i = 0;
+
+	for (; i + 8 <= length; i += 8)
+	{
+		const __m512d v = _mm512_loadu_pd(values + i);
+		vmin = _mm512_min_pd(v, vmin);
+		vmax = _mm512_max_pd(v, vmax);
+	}
+
+	double mins[8], maxs[8];
+	_mm512_storeu_pd(mins, vmin);
+	_mm512_storeu_pd(maxs, vmax);
+
+	for (int j = 0; j < 8; j++)
+	{
+		min = fmin(min, mins[j]);
+		max = fmax(max, maxs[j]);
+	}
+
+	return i;
+}
+
+__attribute__((target("avx512f"))) size_t MinMaxAVX512(const float* values, size_t length, float& min, float& max)
+{
+	__m512 vmin = _mm512_set1_ps(min), vmax = _mm512_set1_ps(max);
+	size_t i = 0;
+
+	for (; i + 16 <= length; i += 16)
+	{
+		const __m512 v = _mm512_loadu_ps(values + i);
+		vmin = _mm512_min_ps(v, vmin);
+		vmax = _mm512_max_ps(v, vmax);
+	}
+
+	float mins[16], maxs[16];
+	_mm512_storeu_ps(mins, vmin);
+	_mm512_storeu_ps(maxs, vmax);
+
+	for (int j = 0; j < 16; j++)
+	{
+		min = fminf(min, mins[j]);
+		max = fmaxf(max, maxs[j]);
+	}
+
+	return i;
+}
+
+#endif
+
+template <typename T>
+void Decode(const unsigned char* packed, size_t packedLength, size_t count, T* out,
+            const simple_packing::coefficients& c)
+{
+	if (c.bitsPerValue == 0)
+	{
+		// Constant field: like grib_api, use reference value as is
+		const T value = static_cast<T>(c.referenceValue);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = value;
+		}
+
+		return;
+	}
+
+	size_t first = 0;
+
+#ifdef HIMAN_SIMD_X86
+	if (c.bitsPerValue <= kMaxVectorBitsPerValue)
+	{
+		switch (InstructionSet())
+		{
+			case instruction_set::kAVX512:
+				first = DecodeAVX512<T>(packed, packedLength, first, count, out, c);
+				break;
+			case instruction_set::kAVX2:
+				first = DecodeAVX2<T>(packed, packedLength, first, count, out, c);
+				break;
+			default:
+				break;
+		}
+	}
+#endif
+
+	DecodeScalar<T>(packed, first, count, out, c);
+}
+
+inline bool BitSet(const unsigned char* bitmap, size_t i)
+{
+	return (bitmap[i >> 3] & (0x80 >> (i & 7))) != 0;
+}
+
+size_t BitCount(const unsigned char* bitmap, size_t length)
+{
+	size_t count = 0;
+	const size_t fullBytes = length >> 3;
+
+	for (size_t i = 0; i < fullBytes; i++)
+	{
+		count += static_cast<size_t>(__builtin_popcount(bitmap[i]));
+	}
+
+	for (size_t i = fullBytes << 3; i < length; i++)
+	{
+		count += BitSet(bitmap, i) ? 1 : 0;
+	}
+
+	return count;
+}
+}  // namespace
+
+bool simple_packing::IsSupported(int bitsPerValue)
+{
+	return bitsPerValue >= 0 && bitsPerValue <= 32;
+}
+
+template <typename T>
+void simple_packing::Unpack(const unsigned char* packed, size_t packedLength, const unsigned char* bitmap, T* values,
+                            size_t valuesLength, const coefficients& coeffs)
+{
+	if (!IsSupported(coeffs.bitsPerValue))
+	{
+		throw std::runtime_error("simple_packing: unsupported bits per value: " + std::to_string(coeffs.bitsPerValue));
+	}
+
+	const size_t count = (bitmap) ? BitCount(bitmap, valuesLength) : valuesLength;
+	const size_t required = (count * static_cast<size_t>(coeffs.bitsPerValue) + 7) / 8;
+
+	if (required > packedLength)
+	{
+		throw std::runtime_error("simple_packing: packed data is too short: " + std::to_string(packedLength) +
+		                         " bytes, " + std::to_string(required) + " required");
+	}
+
+	// Packed values are decoded to the beginning of the output array
+
+	Decode<T>(packed, packedLength, count, values, coeffs);
+
+	if (!bitmap)
+	{
+		return;
+	}
+
+	// Spread values to their final positions. This is done from the end
+	// backwards, so that no value is overwritten before it is moved.
+
+	const T missing = MissingValue<T>();
+	size_t k = count;
+
+	for (size_t i = valuesLength; i-- > 0;)
+	{
+		values[i] = BitSet(bitmap, i) ? values[--k] : missing;
+	}
+}
+
+template void simple_packing::Unpack<double>(const unsigned char*, size_t, const unsigned char*, double*, size_t,
+                                             const coefficients&);
+template void simple_packing::Unpack<float>(const unsigned char*, size_t, const unsigned char*, float*, size_t,
+                                            const coefficients&);
+
+template <typename T>
+void simple_packing::MinMax(const T* values, size_t valuesLength, T& min, T& max)
+{
+	min = std::numeric_limits<T>::infinity();
+	max = -std::numeric_limits<T>::infinity();
+
+	size_t first = 0;
+
+#ifdef HIMAN_SIMD_X86
+	switch (InstructionSet())
+	{
+		case instruction_set::kAVX512:
+			first = MinMaxAVX512(values, valuesLength, min, max);
+			break;
+		case instruction_set::kAVX2:
+			first = MinMaxAVX2(values, valuesLength, min, max);
+			break;
+		default:
+			break;
+	}
+#endif
+
+	for (size_t i = first; i < valuesLength; i++)
+	{
+		// man fmin:
+		// "If one argument is a NaN, the other argument is returned."
+		min = std::fmin(min, values[i]);
+		max = std::fmax(max, values[i]);
+	}
+
+	if (min > max)
+	{
+		// All values are missing
+		min = MissingValue<T>();
+		max = MissingValue<T>();
+	}
+}
+
+template void simple_packing::MinMax<double>(const double*, size_t, double&, double&);
+template void simple_packing::MinMax<float>(const float*, size_t, float&, float&);
@@ -19,6 +19,14 @@ statistics::statistics()
 	itsInitTime = 0;
 	itsCacheHitCount = 0;
 	itsCacheMissCount = 0;
+	itsWriteQueueWaitTime = 0;
+	itsWriteDrainTime = 0;
+	itsPrefetchCount = 0;
+	itsPrefetchTime = 0;
+	itsS3ReadCount = 0;
+	itsS3ReadBytes = 0;
+	itsS3ReadTime = 0;
+	itsS3BlockCacheHitCount = 0;
 }
 statistics::statistics(const statistics& other) : itsUsedThreadCount(other.itsUsedThreadCount)
 
@@ -32,6 +40,14 @@ statistics::statistics(const statistics& other) : itsUsedThreadCount(other.itsUs
 	itsInitTime.store(other.itsInitTime, std::memory_order_relaxed);
 	itsCacheMissCount.store(other.itsCacheMissCount, std::memory_order_relaxed);
 	itsCacheHitCount.store(other.itsCacheHitCount, std::memory_order_relaxed);
+	itsWriteQueueWaitTime.store(other.itsWriteQueueWaitTime, std::memory_order_relaxed);
+	itsWriteDrainTime.store(other.itsWriteDrainTime, std::memory_order_relaxed);
+	itsPrefetchCount.store(other.itsPrefetchCount, std::memory_order_relaxed);
+	itsPrefetchTime.store(other.itsPrefetchTime, std::memory_order_relaxed);
+	itsS3ReadCount.store(other.itsS3ReadCount, std::memory_order_relaxed);
+	itsS3ReadBytes.store(other.itsS3ReadBytes, std::memory_order_relaxed);
+	itsS3ReadTime.store(other.itsS3ReadTime, std::memory_order_relaxed);
+	itsS3BlockCacheHitCount.store(other.itsS3BlockCacheHitCount, std::memory_order_relaxed);
 }
 
 void statistics::AddToMissingCount(size_t theMissingCount)
@@ -70,6 +86,38 @@ void statistics::AddToCacheHitCount(size_t theCacheHitCount)
 {
 	itsCacheHitCount += theCacheHitCount;
 }
+void statistics::AddToWriteQueueWaitTime(int64_t theWriteQueueWaitTime)
+{
+	itsWriteQueueWaitTime += theWriteQueueWaitTime;
+}
+void statistics::AddToWriteDrainTime(int64_t theWriteDrainTime)
+{
+	itsWriteDrainTime += theWriteDrainTime;
+}
+void statistics::AddToPrefetchCount(size_t thePrefetchCount)
+{
+	itsPrefetchCount += thePrefetchCount;
+}
+void statistics::AddToPrefetchTime(int64_t thePrefetchTime)
+{
+	itsPrefetchTime += thePrefetchTime;
+}
+void statistics::AddToS3ReadCount(size_t theS3ReadCount)
+{
+	itsS3ReadCount += theS3ReadCount;
+}
+void statistics::AddToS3ReadBytes(size_t theS3ReadBytes)
+{
+	itsS3ReadBytes += theS3ReadBytes;
+}
+void statistics::AddToS3ReadTime(int64_t theS3ReadTime)
+{
+	itsS3ReadTime += theS3ReadTime;
+}
+void statistics::AddToS3BlockCacheHitCount(size_t theS3BlockCacheHitCount)
+{
+	itsS3BlockCacheHitCount += theS3BlockCacheHitCount;
+}
 void statistics::UsedThreadCount(short theUsedThreadCount)
 {
 	itsUsedThreadCount = theUsedThreadCount;
@@ -0,0 +1,539 @@
+/**
+ * @file thread_pool.cpp
+ *
+ */
+
+#include "thread_pool.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <dirent.h>
+#include <exception>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+
+using namespace himan;
+
+namespace
+{
+// Identifies the worker that is running in the current thread
+thread_local const thread_pool* tlsPool = nullptr;
+thread_local size_t tlsWorkerIndex = 0;
+
+struct parallel_for_state
+{
+	parallel_for_state(size_t theBegin, size_t theEnd, size_t theGrain, size_t theChunks,
+	                   const std::function<void(size_t, size_t)>* theFunction)
+	    : next(theBegin), remaining(theChunks), end(theEnd), grain(theGrain), fn(theFunction)
+	{
+	}
+
+	std::atomic<size_t> next;
+	std::atomic<size_t> remaining;
+	const size_t end;
+	const size_t grain;
+
+	// Only dereferenced when a range has been claimed: caller does
+	// not return before all ranges are done
+	const std::function<void(size_t, size_t)>* fn;
+
+	std::mutex mutex;
+	std::condition_variable done;
+	std::exception_ptr error;
+};
+
+void ExecuteRanges(const std::shared_ptr<parallel_for_state>& st)
+{
+	while (true)
+	{
+		const size_t first = st->next.fetch_add(st->grain);
+
+		if (first >= st->end)
+		{
+			return;
+		}
+
+		try
+		{
+			(*st->fn)(first, std::min(first + st->grain, st->end));
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(st->mutex);
+
+			if (!st->error)
+			{
+				st->error = std::current_exception();
+			}
+		}
+
+		if (st->remaining.fetch_sub(1) == 1)
+		{
+			std::lock_guard<std::mutex> lock(st->mutex);
+			st->done.notify_all();
+		}
+	}
+}
+
+// Parse a list of cpus in kernel format, for example "0-15,32-47"
+
+std::vector<int> ParseCpuList(const std::string& str)
+{
+	std::vector<int> cpus;
+	std::stringstream ss(str);
+	std::string range;
+
+	while (std::getline(ss, range, ','))
+	{
+		const auto dash = range.find('-');
+
+		try
+		{
+			const int first = std::stoi(range.substr(0, dash));
+			const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+
+			for (int cpu = first; cpu <= last; cpu++)
+			{
+				cpus.push_back(cpu);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			// empty or malformed range
+		}
+	}
+
+	return cpus;
+}
+
+// Cpus the process is allowed to run on
+
+std::vector<int> AllowedCpus()
+{
+	std::vector<int> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	if (sched_getaffinity(0, sizeof(set), &set) == 0)
+	{
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (CPU_ISSET(cpu, &set))
+			{
+				cpus.push_back(cpu);
+			}
+		}
+	}
+
+	return cpus;
+}
+
+// Number of cpus allowed by cgroup cpu quota (v2 or v1), or zero if there is
+// no quota
+
+size_t CgroupCpuLimit()
+{
+	double quota = -1, period = -1;
+
+	std::ifstream v2("/sys/fs/cgroup/cpu.max");
+
+	if (v2)
+	{
+		std::string q;
+		v2 >> q >> period;
+
+		if (q != "max")
+		{
+			try
+			{
+				quota = std::stod(q);
+			}
+			catch (const std::exception& e)
+			{
+			}
+		}
+	}
+	else
+	{
+		std::ifstream q("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+		std::ifstream p("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+
+		if (q && p)
+		{
+			q >> quota;
+			p >> period;
+		}
+	}
+
+	if (quota <= 0 || period <= 0)
+	{
+		return 0;
+	}
+
+	return std::max<size_t>(1, static_cast<size_t>(std::ceil(quota / period)));
+}
+
+size_t DefaultSize()
+{
+	size_t size = static_cast<size_t>(std::thread::hardware_concurrency());
+
+	const size_t allowed = AllowedCpus().size();
+
+	if (allowed > 0 && (size == 0 || allowed < size))
+	{
+		size = allowed;
+	}
+
+	const size_t limit = CgroupCpuLimit();
+
+	if (limit > 0 && (size == 0 || limit < size))
+	{
+		size = limit;
+	}
+
+	return std::max<size_t>(1, size);
+}
+
+// Allowed cpus of each NUMA node. If topology is not available, all cpus
+// are in one node.
+
+std::vector<std::vector<int>> NodeCpus()
+{
+	const auto allowed = AllowedCpus();
+	std::vector<std::vector<int>> nodes;
+
+	DIR* dir = opendir("/sys/devices/system/node");
+
+	if (dir)
+	{
+		std::vector<int> nodeIds;
+
+		while (const dirent* entry = readdir(dir))
+		{
+			const std::string name(entry->d_name);
+
+			if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+			    name.find_first_not_of("0123456789", 4) == std::string::npos)
+			{
+				nodeIds.push_back(std::stoi(name.substr(4)));
+			}
+		}
+
+		closedir(dir);
+
+		std::sort(nodeIds.begin(), nodeIds.end());
+
+		for (int id : nodeIds)
+		{
+			std::ifstream in("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+			std::string list;
+			std::getline(in, list);
+
+			std::vector<int> cpus;
+
+			for (int cpu : ParseCpuList(list))
+			{
+				if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+				{
+					cpus.push_back(cpu);
+				}
+			}
+
+			if (!cpus.empty())
+			{
+				nodes.push_back(cpus);
+			}
+		}
+	}
+
+	if (nodes.empty() && !allowed.empty())
+	{
+		nodes.push_back(allowed);
+	}
+
+	return nodes;
+}
+}  // namespace
+
+thread_pool* thread_pool::Instance()
+{
+	// Pool is never destroyed: worker threads may still be running
+	// when exit() is called
+
+	static thread_pool* itsInstance = new thread_pool();
+	return itsInstance;
+}
+
+thread_pool::thread_pool() : itsNumaPlacement(false), itsPendingCount(0), itsSize(DefaultSize())
+{
+}
+
+void thread_pool::Size(size_t theSize)
+{
+	std::lock_guard<std::mutex> lock(itsMutex);
+
+	if (!itsWorkers.empty())
+	{
+		logger("thread_pool").Warning("Pool is already running, size cannot be changed");
+		return;
+	}
+
+	itsSize = std::max<size_t>(1, theSize);
+}
+
+size_t thread_pool::Size() const
+{
+	std::lock_guard<std::mutex> lock(itsMutex);
+	return itsSize;
+}
+
+void thread_pool::NumaPlacement(bool theNumaPlacement)
+{
+	std::lock_guard<std::mutex> lock(itsMutex);
+
+	if (!itsWorkers.empty())
+	{
+		logger("thread_pool").Warning("Pool is already running, NUMA placement cannot be changed");
+		return;
+	}
+
+	itsNumaPlacement = theNumaPlacement;
+}
+
+bool thread_pool::NumaPlacement() const
+{
+	std::lock_guard<std::mutex> lock(itsMutex);
+	return itsNumaPlacement;
+}
+
+bool thread_pool::IsWorkerThread() const
+{
+	return tlsPool == this;
+}
+
+void thread_pool::Start()
+{
+	std::lock_guard<std::mutex> lock(itsMutex);
+
+	for (size_t i = 0; i <= itsSize; i++)
+	{
+		itsQueues.push_back(std::unique_ptr<task_queue>(new task_queue()));
+	}
+
+	if (itsNumaPlacement)
+	{
+		// Take cores from nodes in turns, so that a pool smaller than the
+		// machine is still spread over all nodes
+
+		const auto nodes = NodeCpus();
+
+		std::vector<std::pair<int, int>> cores;  // cpu, node
+
+		for (size_t i = 0, added = 1; added > 0; i++)
+		{
+			added = 0;
+
+			for (size_t node = 0; node < nodes.size(); node++)
+			{
+				if (i < nodes[node].size())
+				{
+					cores.push_back(std::make_pair(nodes[node][i], static_cast<int>(node)));
+					added++;
+				}
+			}
+		}
+
+		// If there are more workers than cores, cores are shared
+
+		for (size_t i = 0; !cores.empty() && i < itsSize; i++)
+		{
+			itsWorkerCpus.push_back(cores[i % cores.size()].first);
+			itsWorkerNodes.push_back(cores[i % cores.size()].second);
+		}
+
+		logger("thread_pool").Info("Pinning " + std::to_string(itsSize) + " worker threads to cores of " +
+		                           std::to_string(nodes.size()) + " NUMA nodes");
+	}
+
+	for (size_t i = 0; i < itsSize; i++)
+	{
+		itsWorkers.push_back(std::thread(&thread_pool::WorkerLoop, this, i));
+	}
+
+	logger("thread_pool").Debug("Started " + std::to_string(itsSize) + " worker threads");
+}
+
+void thread_pool::Submit(std::function<void()> task)
+{
+	std::call_once(itsStartFlag, &thread_pool::Start, this);
+
+	// Pending count is incremented before the task is visible to the
+	// workers, so that it is never smaller than the number of queued tasks
+
+	{
+		std::lock_guard<std::mutex> lock(itsMutex);
+		itsPendingCount++;
+	}
+
+	auto& queue = IsWorkerThread() ? itsQueues[tlsWorkerIndex] : itsQueues.back();
+
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->tasks.push_back(std::move(task));
+	}
+
+	itsTaskAvailable.notify_one();
+}
+
+bool thread_pool::TryPop(size_t index, std::function<void()>& task)
+{
+	bool found = false;
+
+	// Own queue is processed in LIFO order, as the most recent tasks are
+	// most likely to have their data in cache
+
+	{
+		auto& own = itsQueues[index];
+		std::lock_guard<std::mutex> lock(own->mutex);
+
+		if (!own->tasks.empty())
+		{
+			task = std::move(own->tasks.back());
+			own->tasks.pop_back();
+			found = true;
+		}
+	}
+
+	// Otherwise take the oldest task from the queue of outside tasks or
+	// steal one from the other workers. With NUMA placement workers of the
+	// same node are tried first.
+
+	const size_t queueCount = itsQueues.size();
+	const bool numa = !itsWorkerNodes.empty();
+
+	for (int pass = (numa ? 0 : 1); !found && pass < 2; pass++)
+	{
+		for (size_t i = 1; !found && i <= queueCount; i++)
+		{
+			const size_t victim = (index + queueCount - i) % queueCount;
+
+			if (pass == 0 && victim < itsWorkerNodes.size() && itsWorkerNodes[victim] != itsWorkerNodes[index])
+			{
+				continue;
+			}
+
+			auto& other = itsQueues[victim];
+			std::lock_guard<std::mutex> lock(other->mutex);
+
+			if (!other->tasks.empty())
+			{
+				task = std::move(other->tasks.front());
+				other->tasks.pop_front();
+				found = true;
+			}
+		}
+	}
+
+	if (found)
+	{
+		std::lock_guard<std::mutex> lock(itsMutex);
+		itsPendingCount--;
+	}
+
+	return found;
+}
+
+void thread_pool::WorkerLoop(size_t index)
+{
+	tlsPool = this;
+	tlsWorkerIndex = index;
+
+	if (index < itsWorkerCpus.size())
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(itsWorkerCpus[index], &set);
+
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+		{
+			logger("thread_pool").Warning("Unable to pin worker thread to core " +
+			                              std::to_string(itsWorkerCpus[index]));
+		}
+	}
+
+	std::function<void()> task;
+
+	while (true)
+	{
+		if (TryPop(index, task))
+		{
+			task();
+			task = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(itsMutex);
+		itsTaskAvailable.wait(lock, [this]() { return itsPendingCount > 0; });
+	}
+}
+
+void thread_pool::ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	grain = std::max<size_t>(1, grain);
+
+	const size_t chunks = (end - begin + grain - 1) / grain;
+	const bool isWorker = IsWorkerThread();
+
+	if (chunks == 1 && isWorker)
+	{
+		fn(begin, end);
+		return;
+	}
+
+	auto st = std::make_shared<parallel_for_state>(begin, end, grain, chunks, &fn);
+
+	// A worker thread takes part in the work itself: it must not block
+	// waiting for tasks that might be queued behind it
+
+	const size_t helpers = std::min(chunks, Size()) - (isWorker ? 1 : 0);
+
+	for (size_t i = 0; i < helpers; i++)
+	{
+		Submit([st]() { ExecuteRanges(st); });
+	}
+
+	if (isWorker)
+	{
+		ExecuteRanges(st);
+	}
+
+	// Remaining ranges have been claimed by running threads
+
+	{
+		std::unique_lock<std::mutex> lock(st->mutex);
+		st->done.wait(lock, [&st]() { return st->remaining == 0; });
+	}
+
+	if (st->error)
+	{
+		std::rethrow_exception(st->error);
+	}
+}
+
+void thread_pool::Invoke(const std::vector<std::function<void()>>& fns)
+{
+	ParallelFor(0, fns.size(), 1, [&fns](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+		{
+			fns[i]();
+		}
+	});
+}
@@ -0,0 +1,99 @@
+#include "unique_key.h"
+#include <boost/functional/hash.hpp>
+#include <cmath>
+#include <sstream>
+
+using namespace himan;
+
+namespace
+{
+// Missing values might be NaN: make them compare equal and produce
+// equal hashes
+
+bool Equal(double a, double b)
+{
+	return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+size_t HashValue(double a)
+{
+	return std::isnan(a) ? 0 : std::hash<double>{}(a);
+}
+
+std::string FormatTime(time_t t)
+{
+	struct tm tm;
+	gmtime_r(&t, &tm);
+
+	char fmt[20];
+	strftime(fmt, 20, "%Y-%m-%d %H:%M:%S", &tm);
+
+	return std::string(fmt);
+}
+}  // namespace
+
+unique_key::unique_key(long theProducerId, time_t theOriginTime, time_t theValidTime, const std::string& theParamName,
+                       HPLevelType theLevelType, double theLevelValue, double theLevelValue2,
+                       HPForecastType theForecastType, double theForecastTypeValue)
+    : itsProducerId(theProducerId),
+      itsOriginTime(theOriginTime),
+      itsValidTime(theValidTime),
+      itsParamName(theParamName),
+      itsLevelType(theLevelType),
+      itsLevelValue(theLevelValue),
+      itsLevelValue2(theLevelValue2),
+      itsForecastType(theForecastType),
+      itsForecastTypeValue(theForecastTypeValue),
+      itsHash(0)
+{
+	boost::hash_combine(itsHash, itsProducerId);
+	boost::hash_combine(itsHash, itsOriginTime);
+	boost::hash_combine(itsHash, itsValidTime);
+	boost::hash_combine(itsHash, std::hash<std::string>{}(itsParamName));
+	boost::hash_combine(itsHash, static_cast<int>(itsLevelType));
+	boost::hash_combine(itsHash, HashValue(itsLevelValue));
+	boost::hash_combine(itsHash, HashValue(itsLevelValue2));
+	boost::hash_combine(itsHash, static_cast<int>(itsForecastType));
+	boost::hash_combine(itsHash, HashValue(itsForecastTypeValue));
+}
+
+bool unique_key::operator==(const unique_key& other) const
+{
+	// Hash is compared first as it is the cheapest way to find out
+	// that keys differ
+
+	return (itsHash == other.itsHash && itsProducerId == other.itsProducerId &&
+	        itsOriginTime == other.itsOriginTime && itsValidTime == other.itsValidTime &&
+	        itsLevelType == other.itsLevelType && Equal(itsLevelValue, other.itsLevelValue) &&
+	        Equal(itsLevelValue2, other.itsLevelValue2) && itsForecastType == other.itsForecastType &&
+	        Equal(itsForecastTypeValue, other.itsForecastTypeValue) && itsParamName == other.itsParamName);
+}
+
+bool unique_key::operator!=(const unique_key& other) const
+{
+	return !(*this == other);
+}
+
+unique_key::operator std::string() const
+{
+	std::stringstream ss;
+
+	// clang-format off
+
+	ss << itsProducerId << "_"
+	   << FormatTime(itsOriginTime) << "_"
+	   << FormatTime(itsValidTime) << "_"
+	   << itsParamName << "_"
+	   << HPLevelTypeToString.at(itsLevelType) << "/" << std::to_string(itsLevelValue);
+
+	if (!IsKHPMissingValue(itsLevelValue2))
+	{
+		ss << "/" << std::to_string(itsLevelValue2);
+	}
+
+	ss << "_" << itsForecastType << "_" << itsForecastTypeValue;
+
+	// clang-format on
+
+	return ss.str();
+}
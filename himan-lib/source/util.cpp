@@ -14,12 +14,17 @@
 #include "plugin_factory.h"
 #include "point_list.h"
 #include "reduced_gaussian_grid.h"
+#include "simple_packing.h"
 #include "stereographic_grid.h"
+#include "thread_pool.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/math/constants/constants.hpp>
+#include <cstdint>
+#include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <unistd.h>
 #include <wordexp.h>
 
 #define HIMAN_AUXILIARY_INCLUDE
@@ -835,6 +840,91 @@ bool util::ParseBoolean(const string& val)
 	}
 }
 
+size_t util::ParseByteSize(const string& val)
+{
+	// stoull() accepts a minus sign and negates the value
+
+	const auto first = val.find_first_not_of(" \t\n\v\f\r");
+
+	if (first == string::npos || val[first] == '-')
+	{
+		throw invalid_argument("Invalid byte size: " + val);
+	}
+
+	size_t pos = 0;
+	unsigned long long number;
+
+	try
+	{
+		number = stoull(val, &pos);
+	}
+	catch (const invalid_argument&)
+	{
+		throw invalid_argument("Invalid byte size: " + val);
+	}
+	catch (const out_of_range&)
+	{
+		throw invalid_argument("Byte size is too large: " + val);
+	}
+
+	const string suffix = boost::algorithm::to_upper_copy(val.substr(pos));
+
+	int shift;
+
+	if (suffix.empty() || suffix == "B")
+	{
+		shift = 0;
+	}
+	else if (suffix == "K" || suffix == "KB")
+	{
+		shift = 10;
+	}
+	else if (suffix == "M" || suffix == "MB")
+	{
+		shift = 20;
+	}
+	else if (suffix == "G" || suffix == "GB")
+	{
+		shift = 30;
+	}
+	else if (suffix == "T" || suffix == "TB")
+	{
+		shift = 40;
+	}
+	else
+	{
+		throw invalid_argument("Invalid byte size: " + val);
+	}
+
+	if (number > (SIZE_MAX >> shift))
+	{
+		throw invalid_argument("Byte size is too large: " + val);
+	}
+
+	return static_cast<size_t>(number) << shift;
+}
+
+bool util::WriteFileAtomically(const string& fileName, const function<void(ostream&)>& writer, bool binary)
+{
+	const string tmpName = fileName + "." + to_string(getpid()) + ".tmp";
+
+	ofstream out(tmpName, binary ? ios::binary : ios::out);
+
+	if (out)
+	{
+		writer(out);
+		out.close();
+	}
+
+	if (!out || rename(tmpName.c_str(), fileName.c_str()) != 0)
+	{
+		unlink(tmpName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
 #ifdef HAVE_CUDA
 template <typename T>
 void util::Unpack(vector<shared_ptr<info<T>>> infos, bool addToCache)
@@ -889,6 +979,94 @@ void util::Unpack(vector<shared_ptr<info<T>>> infos, bool addToCache)
 template void util::Unpack<double>(vector<shared_ptr<info<double>>>, bool);
 template void util::Unpack<float>(vector<shared_ptr<info<float>>>, bool);
 
+#else
+
+namespace
+{
+template <typename T>
+void UnpackOnCPU(shared_ptr<info<T>>& info)
+{
+	const auto pdata = info->PackedData();
+
+	if (pdata == nullptr || pdata->HasData() == false)
+	{
+		return;
+	}
+
+	const auto pck = dynamic_pointer_cast<simple_packed>(pdata);
+
+	if (!pck)
+	{
+		throw runtime_error("Unpack: only simple packing is supported");
+	}
+
+	const auto g = info->Grid();
+
+	matrix<T> data;
+
+	if (g->Class() == kRegularGrid)
+	{
+		const auto rg = dynamic_pointer_cast<regular_grid>(g);
+		data = matrix<T>(rg->Ni(), rg->Nj(), 1, MissingValue<T>());
+	}
+	else
+	{
+		data = matrix<T>(g->Size(), 1, 1, MissingValue<T>());
+	}
+
+	if (data.Size() != pck->unpackedLength)
+	{
+		throw runtime_error("Unpack: grid size " + to_string(data.Size()) + " does not match packed data size " +
+		                    to_string(pck->unpackedLength));
+	}
+
+	simple_packing::Unpack<T>(pck->data.data(), pck->packedLength, pck->HasBitmap() ? pck->bitmap.data() : nullptr,
+	                          data.Values().data(), data.Size(), pck->coefficients);
+
+	// Unpacked data is placed to a new data backend: packed data might be shared
+	// with other infos (for example the one in cache) and it must stay intact
+
+	info->Base(make_shared<base<T>>(g, move(data)));
+}
+}  // namespace
+
+template <typename T>
+void util::Unpack(vector<shared_ptr<info<T>>> infos, bool addToCache)
+{
+	if (thread_pool::Instance()->NumaPlacement())
+	{
+		// Grids are unpacked by the calling thread, so that their memory is
+		// allocated from the NUMA node of the thread that uses them
+
+		for (auto& info : infos)
+		{
+			UnpackOnCPU<T>(info);
+		}
+	}
+	else
+	{
+		thread_pool::Instance()->ParallelFor(0, infos.size(), 1, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++)
+			{
+				UnpackOnCPU<T>(infos[i]);
+			}
+		});
+	}
+
+	if (addToCache)
+	{
+		auto c = GET_PLUGIN(cache);
+
+		for (const auto& info : infos)
+		{
+			c->Insert(info);
+		}
+	}
+}
+
+template void util::Unpack<double>(vector<shared_ptr<info<double>>>, bool);
+template void util::Unpack<float>(vector<shared_ptr<info<float>>>, bool);
+
 #endif
 
 unique_ptr<grid> util::GridFromDatabase(const string& geom_name)
@@ -1114,45 +1292,23 @@ void util::Flip(matrix<T>& mat)
 template void util::Flip<double>(matrix<double>&);
 template void util::Flip<float>(matrix<float>&);
 
-string util::UniqueName(const plugin::search_options& options)
+himan::unique_key util::UniqueKey(const plugin::search_options& options)
 {
 	ASSERT(options.configuration->DatabaseType() == kNoDatabase || options.prod.Id() != kHPMissingInt);
-	stringstream ss;
-
-	// clang-format off
 
-        ss << options.prod.Id() << "_"
-           << options.time.OriginDateTime().String("%Y-%m-%d %H:%M:%S") << "_"
-           << options.time.ValidDateTime().String("%Y-%m-%d %H:%M:%S") << "_"
-           << options.param.Name() << "_"
-           << static_cast<string>(options.level) << "_"
-           << options.ftype.Type() << "_"
-           << options.ftype.Value();
-
-	// clang-format on
-
-	return ss.str();
+	return unique_key(options.prod.Id(), options.time.OriginDateTime().ToEpoch(),
+	                  options.time.ValidDateTime().ToEpoch(), options.param.Name(), options.level.Type(),
+	                  options.level.Value(), options.level.Value2(), options.ftype.Type(), options.ftype.Value());
 }
 
 template <typename T>
-string util::UniqueName(const info<T>& info)
+himan::unique_key util::UniqueKey(const info<T>& info)
 {
-	stringstream ss;
-
-	// clang-format off
-
-        ss << info.Producer().Id() << "_"
-           << info.Time().OriginDateTime().String("%Y-%m-%d %H:%M:%S") << "_"
-           << info.Time().ValidDateTime().String("%Y-%m-%d %H:%M:%S") << "_"
-           << info.Param().Name() << "_"
-           << static_cast<string>(info.Level()) << "_"
-           << info.ForecastType().Type() << "_"
-           << info.ForecastType().Value();
-
-	// clang-format on
-
-	return ss.str();
+	return unique_key(info.Producer().Id(), info.Time().OriginDateTime().ToEpoch(),
+	                  info.Time().ValidDateTime().ToEpoch(), info.Param().Name(), info.Level().Type(),
+	                  info.Level().Value(), info.Level().Value2(), info.ForecastType().Type(),
+	                  info.ForecastType().Value());
 }
 
-template string util::UniqueName(const info<double>&);
-template string util::UniqueName(const info<float>&);
+template himan::unique_key util::UniqueKey(const info<double>&);
+template himan::unique_key util::UniqueKey(const info<float>&);
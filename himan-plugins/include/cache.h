@@ -9,8 +9,12 @@
 #include "auxiliary_plugin.h"
 #include "info.h"
 #include "search_options.h"
-#include <boost/variant.hpp>
-#include <mutex>
+#include "unique_key.h"
+#include <array>
+#include <atomic>
+#include <boost/thread/shared_mutex.hpp>
+#include <list>
+#include <unordered_map>
 
 namespace himan
 {
@@ -18,13 +22,71 @@ namespace plugin
 {
 struct cache_item
 {
-	boost::variant<std::shared_ptr<himan::info<double>>, std::shared_ptr<himan::info<float>>> info;
-	time_t access_time;
+	// Cached data is shared with the callers, a cache hit does not copy the grid.
+	// Data is stored in the type it was inserted with. When it is requested
+	// in the other type, the converted data is stored alongside so that the
+	// conversion is done only once.
+	std::shared_ptr<himan::info<double>> infoDouble;
+	std::shared_ptr<himan::info<float>> infoFloat;
+	himan::unique_key key;
+	size_t size;  // size of data in bytes, both types included
 	bool pinned;
 
-	cache_item() : access_time(0), pinned(false)
+	// Set when element is read. Readers only hold a shared lock and therefore
+	// cannot reorder the LRU list; eviction gives referenced elements a second
+	// chance instead.
+	std::atomic<bool> referenced;
+
+#ifdef DEBUG
+	// Checksums of the data when it was stored to cache. Used to catch callers
+	// that modify cached data in place instead of detaching it first.
+	size_t checksumDouble = 0;
+	size_t checksumFloat = 0;
+
+	size_t& Checksum(type2type<double>)
+	{
+		return checksumDouble;
+	}
+	size_t& Checksum(type2type<float>)
+	{
+		return checksumFloat;
+	}
+#endif
+
+	explicit cache_item(const himan::unique_key& theKey)
+	    : infoDouble(), infoFloat(), key(theKey), size(0), pinned(false), referenced(false)
+	{
+	}
+
+	std::shared_ptr<himan::info<double>>& Info(type2type<double>)
+	{
+		return infoDouble;
+	}
+	std::shared_ptr<himan::info<float>>& Info(type2type<float>)
 	{
+		return infoFloat;
 	}
+	cache_item(const cache_item& other) = delete;
+	cache_item& operator=(const cache_item& other) = delete;
+};
+
+typedef std::list<cache_item> cache_list;
+
+/**
+ * @brief One independently locked part of the cache
+ *
+ * Elements are kept in two lists: pinned elements are never evicted, all
+ * others are ordered so that the most recently inserted (or re-promoted)
+ * element is at front. Index points to the element in either list, so that
+ * lookup, touch and eviction are all constant time operations.
+ */
+
+struct cache_shard
+{
+	cache_list lruList;
+	cache_list pinnedList;
+	std::unordered_map<himan::unique_key, cache_list::iterator> index;
+	mutable boost::shared_mutex mutex;
 };
 
 class cache : public auxiliary_plugin
@@ -88,20 +150,20 @@ class cache_pool : public auxiliary_plugin
 	cache_pool& operator=(const cache_pool& other) = delete;
 
 	static cache_pool* Instance();
-	bool Exists(const std::string& uniqueName);
+	bool Exists(const unique_key& uniqueName);
 
 	template <typename T>
-	void Insert(const std::string& uniqueName, std::shared_ptr<info<T>> info, bool pin);
+	void Insert(const unique_key& uniqueName, std::shared_ptr<info<T>> info, bool pin);
 
 	/**
 	 * @brief Get info from cache
 	 *
-	 * @param uniqueName unique label that identifies a cache element
+	 * @param uniqueName unique key that identifies a cache element
 	 * @param strict define whether cache is allowed to do data type conversion (--> strict=false)
 	 */
 
 	template <typename T>
-	std::shared_ptr<info<T>> GetInfo(const std::string& uniqueName, bool strict);
+	std::shared_ptr<info<T>> GetInfo(const unique_key& uniqueName, bool strict);
 
 	void Clean();
 
@@ -113,8 +175,13 @@ class cache_pool : public auxiliary_plugin
 	{
 		return kAuxiliary;
 	};
-	void UpdateTime(const std::string& uniqueName);
+	/**
+	 * @brief Mark element as most recently used
+	 */
+
+	void UpdateTime(const unique_key& uniqueName);
 	void CacheLimit(int theCacheLimit);
+	void CacheLimitBytes(size_t theCacheLimitBytes);
 
 	/**
 	 * @brief Return current cache size (number of elements)
@@ -122,6 +189,12 @@ class cache_pool : public auxiliary_plugin
 
 	size_t Size() const;
 
+	/**
+	 * @brief Return current cache size in bytes
+	 */
+
+	size_t SizeInBytes() const;
+
 	/**
 	 * @brief Replaces an element in the cache.
 	 *
@@ -129,14 +202,35 @@ class cache_pool : public auxiliary_plugin
 	 */
 
 	template <typename T>
-	void Replace(const std::string& uniqueName, std::shared_ptr<info<T>> info, bool pin);
+	void Replace(const unique_key& uniqueName, std::shared_ptr<info<T>> info, bool pin);
 
    private:
 	cache_pool();
 
-	std::map<std::string, cache_item> itsCache;
+	static const size_t kShardCount = 32;
+
+	cache_shard& Shard(const unique_key& uniqueName);
+
+	/**
+	 * @brief Evict least recently used elements until cache is within limits.
+	 *
+	 * Eviction starts from the given shard. Caller must not hold any shard lock.
+	 */
+
+	void Evict(size_t startShard);
+
+	/**
+	 * @brief Evict one element from a shard. Caller must hold exclusive lock to shard.
+	 *
+	 * @return True if an element was evicted
+	 */
+
+	bool EvictOne(cache_shard& shard);
+	bool IsOverLimit() const;
+
+	std::array<cache_shard, kShardCount> itsShards;
+
 	static cache_pool* itsInstance;
-	std::mutex itsAccessMutex;
 
 	// Cache limit specifies how many grids are held in the cache.
 	// When limit is reached, oldest grids are automatically pruned.
@@ -144,6 +238,14 @@ class cache_pool : public auxiliary_plugin
 	// separate configuration option to prevent himan from using cache)
 
 	int itsCacheLimit;
+
+	// Cache limit in bytes; zero means no limit. Pinned elements count
+	// towards the total size but are never evicted.
+
+	size_t itsCacheLimitBytes;
+
+	std::atomic<size_t> itsCacheSize;
+	std::atomic<size_t> itsCacheSizeBytes;
 };
 
 #ifndef HIMAN_AUXILIARY_INCLUDE
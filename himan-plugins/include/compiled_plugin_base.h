@@ -11,6 +11,11 @@
 #include "plugin_configuration.h"
 #include "timer.h"
 #include <boost/iterator/zip_iterator.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <write_options.h>
 
 template <class... Conts>
@@ -133,6 +138,30 @@ enum class ThreadDistribution
 	kThreadForLevel
 };
 
+/**
+ * @brief Input data that a plugin fetches for each grid it calculates.
+ *
+ * Used to read the inputs of the next grid while the current one is being
+ * calculated, see compiled_plugin_base::Prefetch().
+ */
+
+struct prefetch_input
+{
+	param par;
+
+	// If level type is kUnknownLevel, level of the calculated grid is used
+	level lvl;
+
+	// Added to the valid time of the calculated grid
+	time_duration offset;
+
+	explicit prefetch_input(const param& thePar, const level& theLvl = level(),
+	                        const time_duration& theOffset = time_duration(kHourResolution, 0))
+	    : par(thePar), lvl(theLvl), offset(theOffset)
+	{
+	}
+};
+
 class compiled_plugin_base
 {
    public:
@@ -190,6 +219,23 @@ class compiled_plugin_base
 	template <typename T>
 	void Run(std::shared_ptr<info<T>> myTargetInfo, unsigned short threadIndex);
 
+	/**
+	 * @brief Declare input data that is read for each calculated grid.
+	 *
+	 * When a thread is given the next forecast type/time/level to calculate,
+	 * data for the ones after that is fetched in the background by prefetch
+	 * threads. How many dimensions are read ahead (and how many prefetch
+	 * threads there are) is set with configuration::PrefetchDistance().
+	 * Fetched data goes to cache, and
+	 * fetcher makes sure that the same data is not read twice if Fetch() is
+	 * called while prefetch is still running.
+	 *
+	 * Has no effect if cache is not used for reads. Should be called before
+	 * Start().
+	 */
+
+	void Prefetch(const std::vector<prefetch_input>& inputs);
+
 	/**
 	 * @brief Set target params
 	 *
@@ -373,6 +419,53 @@ class compiled_plugin_base
 	 * those level-param combinations that we don't actually calculate.
 	 */
 	std::vector<std::pair<level, param>> itsLevelParams;
+
+	/**
+	 * @brief Give a calculated grid to writer threads
+	 *
+	 * Calling thread blocks if the queue is full. If no writer threads are
+	 * configured, data is written immediately in the calling thread.
+	 */
+
+	template <typename T>
+	void QueueWrite(std::shared_ptr<info<T>> targetInfo);
+
+	void StartWriterThreads();
+
+	/**
+	 * @brief Wait until all queued grids are written and stop writer threads
+	 */
+
+	void StopWriterThreads();
+	void WriterThread();
+
+	std::vector<std::thread> itsWriterThreads;
+	std::deque<std::function<void()>> itsWriteQueue;
+	std::mutex itsWriteQueueMutex;
+	std::condition_variable itsWriteQueueNotEmpty;
+	std::condition_variable itsWriteQueueNotFull;
+	size_t itsWriteQueueLimit = 0;
+	bool itsWriteQueueClosed = false;
+
+	template <typename T>
+	void SchedulePrefetch(const forecast_type& ftype, const forecast_time& ftime, const level& lvl);
+	void StartPrefetchThreads();
+
+	/**
+	 * @brief Drop reads that have not been started and stop prefetch threads
+	 */
+
+	void StopPrefetchThreads();
+	void PrefetchThread();
+
+	std::vector<prefetch_input> itsPrefetchInputs;
+	std::vector<std::thread> itsPrefetchThreads;
+	std::deque<std::function<void()>> itsPrefetchQueue;
+	std::mutex itsPrefetchQueueMutex;
+	std::condition_variable itsPrefetchQueueNotEmpty;
+	bool itsPrefetchQueueClosed = false;
+	bool itsPrefetchStarted = false;
+	size_t itsPrefetchDropCount = 0;
 };
 
 }  // namespace plugin
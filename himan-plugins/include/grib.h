@@ -10,11 +10,14 @@
 #include "auxiliary_plugin.h"
 #include "file_information.h"
 #include "info.h"
+#include "unique_key.h"
 
 class NFmiGrib;
 
 namespace himan
 {
+class mapped_file;
+
 namespace plugin
 {
 class grib : public io_plugin
@@ -65,10 +68,36 @@ class grib : public io_plugin
 	                                                    const search_options& options, bool readPackedData,
 	                                                    bool forceCaching) const;
 
+	/**
+	 * @brief Find messages that might match search options from a local grib file.
+	 *
+	 * Metadata of all messages in the file is read once to an index, which is shared
+	 * by all grib plugin instances. The returned file informations contain the offset
+	 * and length of each candidate message, and they can be read with FromFile().
+	 * Files that cannot be indexed (for example compressed files) are returned as-is.
+	 *
+	 * @param inputFile Input file name
+	 * @param options Search options (param, level, time)
+	 *
+	 * @return Locations of candidate messages, empty if file has no matching messages
+	 */
+
+	std::vector<file_information> Search(const file_information& inputFile, const search_options& options) const;
+
 	template <typename T>
 	file_information ToFile(info<T>& anInfo);
 	file_information ToFile(info<double>& anInfo);
 
+	/**
+	 * @brief Close the local files that the given plugin has appended to.
+	 *
+	 * Files are kept open while messages are appended, and a file is closed
+	 * when all plugins writing to it have finished. Writer name is the plugin
+	 * name and its relative ordinal number, separated by '#'.
+	 */
+
+	void CloseFiles(const std::string& writerName);
+
    private:
 	void WriteAreaAndGrid(const std::shared_ptr<himan::grid>& grid, const producer& prod);
 	void WriteTime(const forecast_time& ftime, const producer& prod, const param& par);
@@ -89,9 +118,25 @@ class grib : public io_plugin
 	std::unique_ptr<grid> ReadAreaAndGrid() const;
 	himan::param ReadParam(const search_options& options, const producer& prod) const;
 	himan::forecast_time ReadTime() const;
-	himan::level ReadLevel(const search_options& options, const producer& prod) const;
+
+	/**
+	 * @brief Read level of current message
+	 *
+	 * If level type is not supported, program is aborted, or if abortOnError is
+	 * false, std::invalid_argument is thrown.
+	 */
+
+	himan::level ReadLevel(const search_options& options, const producer& prod, bool abortOnError = true) const;
 	himan::producer ReadProducer(const search_options& options) const;
 
+	/**
+	 * @brief Read the key of current message for message index
+	 *
+	 * Throws std::invalid_argument if level of the message is not supported.
+	 */
+
+	himan::unique_key ReadMessageKey(const search_options& options) const;
+
 	template <typename T>
 	void ReadData(std::shared_ptr<info<T>> newInfo, bool readPackedData) const;
 
@@ -118,6 +163,15 @@ class grib : public io_plugin
 	                  size_t unpackedLen) const;
 
 	std::shared_ptr<NFmiGrib> itsGrib;
+
+	// File where the current message of itsGrib is read from: message is parsed
+	// in place, so the mapping must be kept alive as long as the message is used
+	mutable std::shared_ptr<const mapped_file> itsMappedFile;
+
+	// Memory buffer of the current message if it was parsed in place, or
+	// nullptr if grib_api read it from a file stream
+	mutable const unsigned char* itsMessageData = nullptr;
+	mutable size_t itsMessageLength = 0;
 };
 
 #ifndef HIMAN_AUXILIARY_INCLUDE
@@ -519,6 +519,39 @@ class hitool : public auxiliary_plugin
 	std::vector<T> PlusMinusArea(const param& wantedParam, const std::vector<T>& firstLevelValue,
 	                             const std::vector<T>& lastLevelValue) const;
 
+	/**
+	 * @brief Calculate several statistics of a parameter in a given height range
+	 *
+	 * Overcoat for VerticalStatistics(param, vector<T>, vector<T>, vector<HPModifierType>, vector<T>)
+	 */
+
+	template <typename T>
+	std::vector<std::vector<T>> VerticalStatistics(const param& wantedParam, T lowerHeight, T upperHeight,
+	                                               const std::vector<HPModifierType>& modifierTypes,
+	                                               const std::vector<T>& findValue = std::vector<T>()) const;
+
+	/**
+	 * @brief Calculate several statistics of a parameter in a given height range
+	 *
+	 * Result is the same as calling the corresponding Vertical* functions one by
+	 * one, but each hybrid level is fetched and read only once for all statistics.
+	 *
+	 * Only for hybrid levels.
+	 *
+	 * @param wantedParam Wanted parameter
+	 * @param firstLevelValue Lowest level value for each point, search will start here
+	 * @param lastLevelValue Highest level value for each point, search will stop here
+	 * @param modifierTypes Wanted statistics, for example kMaximumModifier and kAverageModifier
+	 * @param findValue Value to be searched for each point, used by count and find modifiers
+	 * @return One result for each modifier type, in the same order as the types
+	 */
+
+	template <typename T>
+	std::vector<std::vector<T>> VerticalStatistics(const param& wantedParam, const std::vector<T>& firstLevelValue,
+	                                               const std::vector<T>& lastLevelValue,
+	                                               const std::vector<HPModifierType>& modifierTypes,
+	                                               const std::vector<T>& findValue = std::vector<T>()) const;
+
 	/**
 	 * @brief Set current forecast time
 	 * @param theTime Wanted time
@@ -581,6 +614,34 @@ class hitool : public auxiliary_plugin
 	                                    const std::vector<T>& lastLevelValue = std::vector<T>(),
 	                                    const std::vector<T>& findValue = std::vector<T>()) const;
 
+	/**
+	 * @brief Aggregate vertical data with several modifiers at once
+	 *
+	 * Each level is fetched once and given to all modifiers that still need
+	 * it. A modifier is given only the levels of its own level range, so the
+	 * results are the same as with separate VerticalExtremeValue() calls.
+	 *
+	 * @return Result of each modifier, in the same order as the modifiers
+	 */
+
+	template <typename T>
+	std::vector<std::vector<T>> VerticalExtremeValues(const std::vector<std::shared_ptr<modifier>>& mods,
+	                                                  HPLevelType wantedLevelType, const param& wantedParam,
+	                                                  const std::vector<T>& firstLevelValue,
+	                                                  const std::vector<T>& lastLevelValue,
+	                                                  const std::vector<T>& findValue) const;
+
+	/**
+	 * @brief Determine the hybrid levels that a modifier needs for given heights
+	 *
+	 * @return Lowest and highest hybrid level number
+	 */
+
+	template <typename T>
+	std::pair<long, long> LevelRange(HPModifierType modifierType, const producer& prod,
+	                                 const std::vector<T>& firstLevelValue, const std::vector<T>& lastLevelValue,
+	                                 const std::vector<T>& findValue) const;
+
 	template <typename T>
 	std::pair<std::shared_ptr<info<T>>, std::shared_ptr<info<T>>> GetData(const level& wantedLevel,
 	                                                                      const param& wantedParam,
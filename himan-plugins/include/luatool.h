@@ -62,14 +62,33 @@ class luatool : public compiled_plugin, public compiled_plugin_base
 	luabind::object Fetch(const forecast_time& theTime, const level& theLevel, const param& theParam,
 	                      const forecast_type& theType) const;
 
+	/**
+	 * @brief Fetch data as a lua_array that refers to the fetched grid
+	 *
+	 * Unlike Fetch(), values are not converted to a lua table.
+	 */
+
+	luabind::object FetchArray(const forecast_time& theTime, const level& theLevel, const param& theParam) const;
+	luabind::object FetchArray(const forecast_time& theTime, const level& theLevel, const param& theParam,
+	                           const forecast_type& theType) const;
+
 	void WriteToFile(const info_t targetInfo, write_options opts = write_options()) override;
 	void WriteToFile(const info_t targetInfo);
 
    private:
 	void Calculate(std::shared_ptr<info<double>> theTargetInfo, unsigned short theThreadIndex) override;
 	void InitLua();
-	void ResetVariables(info_t myTargetInfo);
-	bool ReadFile(const std::string& luaFile);
+	void ResetVariables(luabind::object& env, info_t myTargetInfo);
+
+	/**
+	 * @brief Push compiled script to the top of the stack of the thread's lua state
+	 *
+	 * Script is compiled when it is first needed, and the compiled chunk is
+	 * reused for all following calculations of the thread.
+	 */
+
+	bool LoadFile(const std::string& luaFile);
+	bool ReadFile(const std::string& luaFile, const luabind::object& env);
 
 	write_options itsWriteOptions;
 };
@@ -0,0 +1,547 @@
+#pragma once
+
+#include "himan_common.h"
+#include "info.h"
+#include "moisture.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace himan
+{
+namespace plugin
+{
+/*
+ * class lua_array
+ *
+ * Array of grid values that is given to lua scripts as userdata instead of
+ * a lua table. Values are not copied element by element to lua: the array
+ * refers to a C++ vector, which can be the data of an info (no copy at all) or
+ * a vector of its own. Whole-array operations are executed in C++, and only
+ * single elements that a script explicitly asks for cross the lua/C++ border.
+ *
+ * Storage can be shared with other arrays and infos. When an array is
+ * modified and someone else still refers to the same storage, the values
+ * are copied first, so that for example cached data is never changed
+ * through an array.
+ *
+ * Missing values propagate: result of an operation is missing if any of
+ * its operands is missing.
+ *
+ * Functions in lua_array_ops are written as plain loops over contiguous
+ * memory without function calls, so that the compiler can vectorize them.
+ */
+
+template <typename T>
+class lua_array
+{
+   public:
+	lua_array() : itsValues(std::make_shared<std::vector<T>>())
+	{
+	}
+	lua_array(size_t size, T fillValue) : itsValues(std::make_shared<std::vector<T>>(size, fillValue))
+	{
+	}
+	explicit lua_array(std::vector<T>&& values) : itsValues(std::make_shared<std::vector<T>>(std::move(values)))
+	{
+	}
+	explicit lua_array(std::shared_ptr<std::vector<T>> values) : itsValues(values)
+	{
+	}
+
+	/**
+	 * @brief Create an array that refers to the current data of an info
+	 *
+	 * Array keeps the data alive even if the info changes to other data later.
+	 */
+
+	static lua_array<T> View(std::shared_ptr<info<T>> anInfo)
+	{
+		const auto b = anInfo->Base();
+		return lua_array<T>(std::shared_ptr<std::vector<T>>(b, &b->data.Values()));
+	}
+
+	size_t Size() const
+	{
+		return itsValues->size();
+	}
+	const std::vector<T>& Values() const
+	{
+		return *itsValues;
+	}
+
+	/**
+	 * @brief Return values for modification, copying them first if they are shared
+	 */
+
+	std::vector<T>& MutableValues()
+	{
+		if (itsValues.use_count() > 1)
+		{
+			itsValues = std::make_shared<std::vector<T>>(*itsValues);
+		}
+
+		return *itsValues;
+	}
+
+	// Element access uses lua indexing (starting from one)
+
+	T Get(size_t theIndex) const
+	{
+		return itsValues->at(theIndex - 1);
+	}
+	void Set(size_t theIndex, T theValue)
+	{
+		if (theIndex == 0 || theIndex > Size())
+		{
+			throw std::out_of_range("Array index " + std::to_string(theIndex) + " is outside of [1, " +
+			                        std::to_string(Size()) + "]");
+		}
+
+		MutableValues()[theIndex - 1] = theValue;
+	}
+	void Fill(T theValue)
+	{
+		auto& vals = MutableValues();
+		std::fill(vals.begin(), vals.end(), theValue);
+	}
+
+	/**
+	 * @brief Return an array that has a copy of the values of this array
+	 */
+
+	lua_array<T> Copy() const
+	{
+		return lua_array<T>(std::vector<T>(*itsValues));
+	}
+
+   private:
+	std::shared_ptr<std::vector<T>> itsValues;
+};
+
+namespace lua_array_ops
+{
+template <typename T>
+void CheckSize(const lua_array<T>& a, const lua_array<T>& b)
+{
+	if (a.Size() != b.Size())
+	{
+		throw std::invalid_argument("Array sizes differ: " + std::to_string(a.Size()) + " vs " +
+		                            std::to_string(b.Size()));
+	}
+}
+
+template <typename T, typename F>
+lua_array<T> Transform(const lua_array<T>& a, F f)
+{
+	std::vector<T> ret(a.Size());
+	std::transform(a.Values().begin(), a.Values().end(), ret.begin(), f);
+	return lua_array<T>(std::move(ret));
+}
+
+template <typename T, typename F>
+lua_array<T> Transform(const lua_array<T>& a, const lua_array<T>& b, F f)
+{
+	CheckSize(a, b);
+
+	std::vector<T> ret(a.Size());
+	std::transform(a.Values().begin(), a.Values().end(), b.Values().begin(), ret.begin(), f);
+	return lua_array<T>(std::move(ret));
+}
+
+template <typename T, typename F>
+lua_array<T> Transform(const lua_array<T>& a, const lua_array<T>& b, const lua_array<T>& c, F f)
+{
+	CheckSize(a, b);
+	CheckSize(a, c);
+
+	const size_t n = a.Size();
+	const T* __restrict pa = a.Values().data();
+	const T* __restrict pb = b.Values().data();
+	const T* __restrict pc = c.Values().data();
+
+	std::vector<T> ret(n);
+	T* __restrict pr = ret.data();
+
+	for (size_t i = 0; i < n; i++)
+	{
+		pr[i] = f(pa[i], pb[i], pc[i]);
+	}
+
+	return lua_array<T>(std::move(ret));
+}
+
+// Reduce the valid values of an array; missing values are skipped
+
+template <typename T, typename F>
+T Reduce(const lua_array<T>& a, T init, F f)
+{
+	T ret = init;
+
+	for (const T& x : a.Values())
+	{
+		if (IsValid(x))
+		{
+			ret = f(ret, x);
+		}
+	}
+
+	return ret;
+}
+
+// Comparison results are one (true) or zero (false), or missing if either
+// of the compared values is missing
+
+template <typename T, typename F>
+lua_array<T> Compare(const lua_array<T>& a, const lua_array<T>& b, F f)
+{
+	return Transform(a, b, [=](T x, T y) { return (IsMissing(x) || IsMissing(y)) ? MissingValue<T>() : T(f(x, y)); });
+}
+
+template <typename T, typename F>
+lua_array<T> Compare(const lua_array<T>& a, T y, F f)
+{
+	return Transform(a, [=](T x) { return (IsMissing(x) || IsMissing(y)) ? MissingValue<T>() : T(f(x, y)); });
+}
+
+// pow(x, 0) and pow(1, y) are one even if the other value is NaN, so missing
+// values are checked explicitly
+
+template <typename T>
+lua_array<T> Pow(const lua_array<T>& a, T y)
+{
+	return Transform(a, [=](T x) { return (IsMissing(x) || IsMissing(y)) ? MissingValue<T>() : std::pow(x, y); });
+}
+template <typename T>
+lua_array<T> Gt(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Compare(a, b, [](T x, T y) { return x > y; });
+}
+template <typename T>
+lua_array<T> Gt(const lua_array<T>& a, T y)
+{
+	return Compare(a, y, [](T u, T v) { return u > v; });
+}
+template <typename T>
+lua_array<T> Ge(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Compare(a, b, [](T x, T y) { return x >= y; });
+}
+template <typename T>
+lua_array<T> Ge(const lua_array<T>& a, T y)
+{
+	return Compare(a, y, [](T u, T v) { return u >= v; });
+}
+template <typename T>
+lua_array<T> Lt(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Compare(a, b, [](T x, T y) { return x < y; });
+}
+template <typename T>
+lua_array<T> Lt(const lua_array<T>& a, T y)
+{
+	return Compare(a, y, [](T u, T v) { return u < v; });
+}
+template <typename T>
+lua_array<T> Le(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Compare(a, b, [](T x, T y) { return x <= y; });
+}
+template <typename T>
+lua_array<T> Le(const lua_array<T>& a, T y)
+{
+	return Compare(a, y, [](T u, T v) { return u <= v; });
+}
+template <typename T>
+lua_array<T> Eq(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Compare(a, b, [](T x, T y) { return x == y; });
+}
+template <typename T>
+lua_array<T> Eq(const lua_array<T>& a, T y)
+{
+	return Compare(a, y, [](T u, T v) { return u == v; });
+}
+template <typename T>
+lua_array<T> Ne(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Compare(a, b, [](T x, T y) { return x != y; });
+}
+template <typename T>
+lua_array<T> Ne(const lua_array<T>& a, T y)
+{
+	return Compare(a, y, [](T u, T v) { return u != v; });
+}
+
+// Elementwise math
+
+template <typename T>
+lua_array<T> Abs(const lua_array<T>& a)
+{
+	return Transform(a, [](T x) { return std::abs(x); });
+}
+template <typename T>
+lua_array<T> Sqrt(const lua_array<T>& a)
+{
+	return Transform(a, [](T x) { return std::sqrt(x); });
+}
+template <typename T>
+lua_array<T> Exp(const lua_array<T>& a)
+{
+	return Transform(a, [](T x) { return std::exp(x); });
+}
+template <typename T>
+lua_array<T> Log(const lua_array<T>& a)
+{
+	return Transform(a, [](T x) { return std::log(x); });
+}
+template <typename T>
+lua_array<T> Log10(const lua_array<T>& a)
+{
+	return Transform(a, [](T x) { return std::log10(x); });
+}
+template <typename T>
+lua_array<T> Floor(const lua_array<T>& a)
+{
+	return Transform(a, [](T x) { return std::floor(x); });
+}
+template <typename T>
+lua_array<T> Ceil(const lua_array<T>& a)
+{
+	return Transform(a, [](T x) { return std::ceil(x); });
+}
+
+// Elementwise minimum and maximum; result is missing if either value is missing
+
+template <typename T>
+lua_array<T> Min(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Transform(a, b, [](T x, T y) { return (IsMissing(x) || IsMissing(y)) ? MissingValue<T>() : std::min(x, y); });
+}
+template <typename T>
+lua_array<T> Min(const lua_array<T>& a, T y)
+{
+	return Transform(a, [=](T x) { return (IsMissing(x) || IsMissing(y)) ? MissingValue<T>() : std::min(x, y); });
+}
+template <typename T>
+lua_array<T> Max(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Transform(a, b, [](T x, T y) { return (IsMissing(x) || IsMissing(y)) ? MissingValue<T>() : std::max(x, y); });
+}
+template <typename T>
+lua_array<T> Max(const lua_array<T>& a, T y)
+{
+	return Transform(a, [=](T x) { return (IsMissing(x) || IsMissing(y)) ? MissingValue<T>() : std::max(x, y); });
+}
+template <typename T>
+lua_array<T> Clamp(const lua_array<T>& a, T lower, T upper)
+{
+	return Transform(a, [=](T x) { return std::min(std::max(x, lower), upper); });
+}
+
+// Select values from a where condition is true (non-zero), and from b where
+// it is false. Result is missing where condition is missing.
+
+template <typename T>
+lua_array<T> Where(const lua_array<T>& cond, const lua_array<T>& a, const lua_array<T>& b)
+{
+	return Transform(cond, a, b, [](T c, T x, T y) { return IsMissing(c) ? MissingValue<T>() : (c != T(0) ? x : y); });
+}
+template <typename T>
+lua_array<T> Where(const lua_array<T>& cond, const lua_array<T>& a, T y)
+{
+	return Transform(cond, a, [=](T c, T x) { return IsMissing(c) ? MissingValue<T>() : (c != T(0) ? x : y); });
+}
+template <typename T>
+lua_array<T> Where(const lua_array<T>& cond, T x, const lua_array<T>& b)
+{
+	return Transform(cond, b, [=](T c, T y) { return IsMissing(c) ? MissingValue<T>() : (c != T(0) ? x : y); });
+}
+template <typename T>
+lua_array<T> Where(const lua_array<T>& cond, T x, T y)
+{
+	return Transform(cond, [=](T c) { return IsMissing(c) ? MissingValue<T>() : (c != T(0) ? x : y); });
+}
+
+// Missing values
+
+template <typename T>
+lua_array<T> MissingMask(const lua_array<T>& a)
+{
+	return Transform(a, [](T x) { return T(IsMissing(x)); });
+}
+template <typename T>
+lua_array<T> FillMissing(const lua_array<T>& a, T value)
+{
+	return Transform(a, [=](T x) { return IsMissing(x) ? value : x; });
+}
+
+// Reductions over valid values. If there are no valid values, result is
+// missing (zero for Count and Sum).
+
+template <typename T>
+T Count(const lua_array<T>& a)
+{
+	return Reduce(a, T(0), [](T r, T) { return r + T(1); });
+}
+template <typename T>
+T Sum(const lua_array<T>& a)
+{
+	return Reduce(a, T(0), [](T r, T x) { return r + x; });
+}
+template <typename T>
+T Mean(const lua_array<T>& a)
+{
+	const T n = Count(a);
+	return (n == T(0)) ? MissingValue<T>() : Sum(a) / n;
+}
+template <typename T>
+T MinValue(const lua_array<T>& a)
+{
+	const T ret = Reduce(a, std::numeric_limits<T>::max(), [](T r, T x) { return std::min(r, x); });
+	return (Count(a) == T(0)) ? MissingValue<T>() : ret;
+}
+template <typename T>
+T MaxValue(const lua_array<T>& a)
+{
+	const T ret = Reduce(a, std::numeric_limits<T>::lowest(), [](T r, T x) { return std::max(r, x); });
+	return (Count(a) == T(0)) ? MissingValue<T>() : ret;
+}
+
+// Unit conversions
+
+template <typename T>
+lua_array<T> KelvinToCelsius(const lua_array<T>& a)
+{
+	return a - static_cast<T>(constants::kKelvin);
+}
+template <typename T>
+lua_array<T> CelsiusToKelvin(const lua_array<T>& a)
+{
+	return a + static_cast<T>(constants::kKelvin);
+}
+template <typename T>
+lua_array<T> PaToHPa(const lua_array<T>& a)
+{
+	return a * T(0.01);
+}
+template <typename T>
+lua_array<T> HPaToPa(const lua_array<T>& a)
+{
+	return a * T(100);
+}
+
+// Moisture functions from metutil. Arguments are in the same units as in
+// metutil (temperatures in Kelvins, pressure in Pa, relative humidity in
+// percent).
+
+template <typename T>
+lua_array<T> DewPointFromRH(const lua_array<T>& t, const lua_array<T>& rh)
+{
+	return Transform(t, rh, [](T T_, T RH) {
+		return (IsMissing(T_) || IsMissing(RH)) ? MissingValue<T>() : metutil::DewPointFromRH_<T>(T_, RH);
+	});
+}
+
+// Relative humidity from temperature and dewpoint, in percent [0, 100]
+// (same formula as in relative_humidity plugin)
+
+template <typename T>
+lua_array<T> RelativeHumidity(const lua_array<T>& t, const lua_array<T>& td)
+{
+	const T b = T(17.27);
+	const T c = T(237.3);
+	const T k = static_cast<T>(constants::kKelvin);
+
+	return Transform(t, td, [=](T T_, T TD) {
+		T_ -= k;
+		TD -= k;
+
+		const T rh = std::exp(b * (TD / (TD + c)) - b * (T_ / (T_ + c)));
+		return IsMissing(rh) ? rh : std::min(std::max(T(0), rh), T(1)) * 100;
+	});
+}
+template <typename T>
+lua_array<T> ThetaE(const lua_array<T>& t, const lua_array<T>& td, const lua_array<T>& p)
+{
+	return Transform(t, td, p, [](T T_, T TD, T P) {
+		return (IsMissing(T_) || IsMissing(TD) || IsMissing(P)) ? MissingValue<T>()
+		                                                         : metutil::ThetaE_<T>(T_, TD, P);
+	});
+}
+}  // namespace lua_array_ops
+
+// Arithmetic does not need special handling for missing values, as missing
+// value is NaN
+
+template <typename T>
+lua_array<T> operator+(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return lua_array_ops::Transform(a, b, [](T x, T y) { return x + y; });
+}
+template <typename T>
+lua_array<T> operator+(const lua_array<T>& a, T y)
+{
+	return lua_array_ops::Transform(a, [=](T x) { return x + y; });
+}
+template <typename T>
+lua_array<T> operator+(T x, const lua_array<T>& b)
+{
+	return b + x;
+}
+template <typename T>
+lua_array<T> operator-(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return lua_array_ops::Transform(a, b, [](T x, T y) { return x - y; });
+}
+template <typename T>
+lua_array<T> operator-(const lua_array<T>& a, T y)
+{
+	return lua_array_ops::Transform(a, [=](T x) { return x - y; });
+}
+template <typename T>
+lua_array<T> operator-(T x, const lua_array<T>& b)
+{
+	return lua_array_ops::Transform(b, [=](T y) { return x - y; });
+}
+template <typename T>
+lua_array<T> operator*(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return lua_array_ops::Transform(a, b, [](T x, T y) { return x * y; });
+}
+template <typename T>
+lua_array<T> operator*(const lua_array<T>& a, T y)
+{
+	return lua_array_ops::Transform(a, [=](T x) { return x * y; });
+}
+template <typename T>
+lua_array<T> operator*(T x, const lua_array<T>& b)
+{
+	return b * x;
+}
+template <typename T>
+lua_array<T> operator/(const lua_array<T>& a, const lua_array<T>& b)
+{
+	return lua_array_ops::Transform(a, b, [](T x, T y) { return x / y; });
+}
+template <typename T>
+lua_array<T> operator/(const lua_array<T>& a, T y)
+{
+	return lua_array_ops::Transform(a, [=](T x) { return x / y; });
+}
+template <typename T>
+lua_array<T> operator/(T x, const lua_array<T>& b)
+{
+	return lua_array_ops::Transform(b, [=](T y) { return x / y; });
+}
+template <typename T>
+lua_array<T> operator-(const lua_array<T>& a)
+{
+	return lua_array_ops::Transform(a, [](T x) { return -x; });
+}
+}  // namespace plugin
+}  // namespace himan
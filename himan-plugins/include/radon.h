@@ -33,6 +33,19 @@ namespace himan
 {
 namespace plugin
 {
+/**
+ * @brief Heights and pressures of a hybrid level, from table hybrid_level_height
+ */
+
+struct hybrid_level_height
+{
+	long level_value;
+	double minimum_height;
+	double maximum_height;
+	double minimum_pressure;
+	double maximum_pressure;
+};
+
 class radon : public auxiliary_plugin
 {
    public:
@@ -61,10 +74,30 @@ class radon : public auxiliary_plugin
 
 	/**
 	 * @brief Return filename of a field
+	 *
+	 * When a parameter is first requested, the file locations of all its levels
+	 * for all forecast times of the plugin are read to an index with a single
+	 * query. Following requests of the parameter are answered from the index.
 	 */
 
 	std::vector<file_information> Files(search_options& options);
 
+	/**
+	 * @brief Return a producer metadata attribute.
+	 *
+	 * Values are cached for the lifetime of the process.
+	 */
+
+	std::string ProducerMetaData(long producerId, const std::string& attName);
+
+	/**
+	 * @brief Return the heights of all hybrid levels of a producer.
+	 *
+	 * Values are cached for the lifetime of the process.
+	 */
+
+	std::vector<hybrid_level_height> HybridLevelHeights(long producerId);
+
 	/**
 	 * @brief Return previ data in CSV format
 	 */
@@ -80,6 +113,23 @@ class radon : public auxiliary_plugin
 
 	bool Save(const info<double>& resultInfo, const file_information& finfo, const std::string& targetGeomName);
 
+	/**
+	 * @brief Write grid metadata rows queued by Save() to database.
+	 *
+	 * Rows are written in batches, one statement per table. Save() flushes
+	 * automatically when enough rows are pending or the oldest of them is too
+	 * old; this function must be called when a plugin finishes.
+	 *
+	 * Rows of grids written to S3 objects that are not complete yet are held
+	 * back until the object is complete, see s3::Flush().
+	 *
+	 * If writing fails, rows that were not written are queued again and an
+	 * exception is thrown. Failure of an earlier flush that was done in the
+	 * background is thrown by the next call.
+	 */
+
+	void Flush();
+
 	/**
 	 * @brief Function to expose the NFmiRadonDB interface
 	 *
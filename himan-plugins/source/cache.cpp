@@ -8,12 +8,12 @@
 #include "logger.h"
 #include "plugin_factory.h"
 #include "util.h"
-#include <time.h>
 
 using namespace std;
 using namespace himan::plugin;
 
-typedef lock_guard<mutex> Lock;
+typedef boost::shared_lock<boost::shared_mutex> ReadLock;
+typedef boost::unique_lock<boost::shared_mutex> WriteLock;
 
 cache::cache()
 {
@@ -33,12 +33,15 @@ void cache::Insert(shared_ptr<info<T>> anInfo, bool pin)
 	// Cached data is never replaced by another data that has
 	// the same uniqueName
 
-	const string uniqueName = util::UniqueName<T>(*localInfo);
+	const unique_key uniqueName = util::UniqueKey<T>(*localInfo);
 
 	if (cache_pool::Instance()->Exists(uniqueName))
 	{
 		// TODO: should we replace existing item?
-		itsLogger.Trace("Data with key " + uniqueName + " already exists at cache");
+		if (itsLogger.DebugState() <= kTraceMsg)
+		{
+			itsLogger.Trace("Data with key " + static_cast<string>(uniqueName) + " already exists at cache");
+		}
 
 		// Update timestamp of this cache item
 		cache_pool::Instance()->UpdateTime(uniqueName);
@@ -51,9 +54,12 @@ void cache::Insert(shared_ptr<info<T>> anInfo, bool pin)
 		itsLogger.Trace("Removing packed data from cached info");
 		localInfo->PackedData()->Clear();
 	}
-#endif
 
 	ASSERT(localInfo->PackedData()->HasData() == false);
+#else
+	// Without CUDA packed data is stored to cache as is, and it is unpacked
+	// every time it is read from cache (see cache_pool::GetInfo())
+#endif
 
 	// localInfo might contain multiple grids. When adding data to cache, we need
 	// to make sure that single info contains only single grid.
@@ -82,7 +88,7 @@ vector<shared_ptr<himan::info<double>>> cache::GetInfo(search_options& options,
 template <typename T>
 vector<shared_ptr<himan::info<T>>> cache::GetInfo(search_options& options, bool strict)
 {
-	const string uniqueName = util::UniqueName(options);
+	const unique_key uniqueName = util::UniqueKey(options);
 
 	vector<shared_ptr<himan::info<T>>> infos;
 
@@ -92,7 +98,13 @@ vector<shared_ptr<himan::info<T>>> cache::GetInfo(search_options& options, bool
 		infos.push_back(foundInfo);
 	}
 
-	itsLogger.Trace("Data " + string(foundInfo ? "found" : "not found") + " for " + uniqueName);
+	// Key is formatted to string only when it is really logged
+
+	if (itsLogger.DebugState() <= kTraceMsg)
+	{
+		itsLogger.Trace("Data " + string(foundInfo ? "found" : "not found") + " for " +
+		                static_cast<string>(uniqueName));
+	}
 
 	return infos;
 }
@@ -128,7 +140,7 @@ void cache::Replace(shared_ptr<info<T>> anInfo, bool pin)
 		localInfo = newInfo;
 	}
 
-	cache_pool::Instance()->Replace<T>(util::UniqueName<T>(*localInfo), localInfo, pin);
+	cache_pool::Instance()->Replace<T>(util::UniqueKey<T>(*localInfo), localInfo, pin);
 }
 
 template void cache::Replace<double>(shared_ptr<info<double>>, bool);
@@ -136,7 +148,7 @@ template void cache::Replace<float>(shared_ptr<info<float>>, bool);
 
 cache_pool* cache_pool::itsInstance = NULL;
 
-cache_pool::cache_pool() : itsCacheLimit(-1)
+cache_pool::cache_pool() : itsCacheLimit(-1), itsCacheLimitBytes(0), itsCacheSize(0), itsCacheSizeBytes(0)
 {
 	itsLogger = logger("cache_pool");
 }
@@ -155,163 +167,385 @@ void cache_pool::CacheLimit(int theCacheLimit)
 {
 	itsCacheLimit = theCacheLimit;
 }
-bool cache_pool::Exists(const string& uniqueName)
+
+void cache_pool::CacheLimitBytes(size_t theCacheLimitBytes)
 {
-	Lock lock(itsAccessMutex);
-	return itsCache.count(uniqueName) > 0;
+	itsCacheLimitBytes = theCacheLimitBytes;
 }
 
+cache_shard& cache_pool::Shard(const unique_key& uniqueName)
+{
+	return itsShards[uniqueName.Hash() % kShardCount];
+}
+
+bool cache_pool::Exists(const unique_key& uniqueName)
+{
+	const auto& shard = Shard(uniqueName);
+
+	ReadLock lock(shard.mutex);
+	return shard.index.count(uniqueName) > 0;
+}
+
+namespace
+{
 template <typename T>
-void cache_pool::Insert(const string& uniqueName, shared_ptr<himan::info<T>> anInfo, bool pin)
+size_t DataSizeInBytes(const shared_ptr<himan::info<T>>& anInfo)
 {
-	cache_item item;
-	item.info = anInfo;
-	item.access_time = time(nullptr);
-	item.pinned = pin;
+	const auto pdata = anInfo->PackedData();
 
+	if (pdata && pdata->HasData())
 	{
-		Lock lock(itsAccessMutex);
-
-		itsCache.insert(pair<string, cache_item>(uniqueName, item));
+		return pdata->SizeInBytes();
 	}
 
-	itsLogger.Trace("Data added to cache with name: " + uniqueName + ", pinned: " + to_string(pin));
+	return anInfo->Data().Size() * sizeof(T);
+}
 
-	if (itsCacheLimit > -1 && itsCache.size() > static_cast<size_t>(itsCacheLimit))
+#ifdef DEBUG
+template <typename T>
+size_t Checksum(const shared_ptr<himan::info<T>>& anInfo)
+{
+	// FNV-1a over the raw bytes, so that missing values are handled too
+
+	const auto& values = anInfo->Data().Values();
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values.data());
+
+	size_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < values.size() * sizeof(T); i++)
 	{
-		Clean();
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
 	}
-}
 
-template void cache_pool::Insert<double>(const string&, shared_ptr<himan::info<double>>, bool);
-template void cache_pool::Insert<float>(const string&, shared_ptr<himan::info<float>>, bool);
+	return hash;
+}
+#endif
 
 template <typename T>
-void cache_pool::Replace(const string& uniqueName, shared_ptr<himan::info<T>> anInfo, bool pin)
+struct other_type;
+
+template <>
+struct other_type<double>
 {
-	cache_item item;
-	item.info = anInfo;
-	item.access_time = time(nullptr);
-	item.pinned = pin;
+	typedef float type;
+};
 
-	// possible race condition ?
+template <>
+struct other_type<float>
+{
+	typedef double type;
+};
+}  // namespace
 
-	const auto it = itsCache.find(uniqueName);
+template <typename T>
+void cache_pool::Insert(const unique_key& uniqueName, shared_ptr<himan::info<T>> anInfo, bool pin)
+{
+	const size_t shardIndex = uniqueName.Hash() % kShardCount;
+	auto& shard = itsShards[shardIndex];
+	const size_t size = DataSizeInBytes<T>(anInfo);
 
-	if (it != itsCache.end())
 	{
+		WriteLock lock(shard.mutex);
+
+		if (shard.index.count(uniqueName) > 0)
 		{
-			Lock lock(itsAccessMutex);
-			itsCache[uniqueName] = item;
+			return;
 		}
-		itsLogger.Trace("Data with name " + uniqueName + " replaced");
+
+		cache_list& list = (pin) ? shard.pinnedList : shard.lruList;
+
+		list.emplace_front(uniqueName);
+
+		auto& item = list.front();
+		item.Info(type2type<T>()) = anInfo;
+		item.size = size;
+		item.pinned = pin;
+#ifdef DEBUG
+		item.Checksum(type2type<T>()) = Checksum<T>(anInfo);
+#endif
+
+		shard.index.emplace(uniqueName, list.begin());
+
+		itsCacheSize++;
+		itsCacheSizeBytes += size;
 	}
-	else
+
+	if (itsLogger.DebugState() <= kTraceMsg)
 	{
-		Insert<T>(uniqueName, anInfo, pin);
+		itsLogger.Trace("Data added to cache with name: " + static_cast<string>(uniqueName) +
+		                ", size: " + to_string(size) + " bytes, pinned: " + to_string(pin));
+	}
+
+	if (IsOverLimit())
+	{
+		Evict(shardIndex);
 	}
 }
 
-template void cache_pool::Replace<double>(const string&, shared_ptr<himan::info<double>>, bool);
-template void cache_pool::Replace<float>(const string&, shared_ptr<himan::info<float>>, bool);
+template void cache_pool::Insert<double>(const unique_key&, shared_ptr<himan::info<double>>, bool);
+template void cache_pool::Insert<float>(const unique_key&, shared_ptr<himan::info<float>>, bool);
 
-void cache_pool::UpdateTime(const std::string& uniqueName)
+template <typename T>
+void cache_pool::Replace(const unique_key& uniqueName, shared_ptr<himan::info<T>> anInfo, bool pin)
 {
-	Lock lock(itsAccessMutex);
-	itsCache[uniqueName].access_time = time(nullptr);
+	const size_t shardIndex = uniqueName.Hash() % kShardCount;
+	auto& shard = itsShards[shardIndex];
+
+	{
+		WriteLock lock(shard.mutex);
+
+		const auto it = shard.index.find(uniqueName);
+
+		if (it == shard.index.end())
+		{
+			lock.unlock();
+			Insert<T>(uniqueName, anInfo, pin);
+			return;
+		}
+
+		auto elem = it->second;
+
+		itsCacheSizeBytes -= elem->size;
+
+		// converted data (if any) is now stale
+
+		elem->Info(type2type<T>()) = anInfo;
+		elem->Info(type2type<typename other_type<T>::type>()).reset();
+		elem->size = DataSizeInBytes<T>(anInfo);
+#ifdef DEBUG
+		elem->Checksum(type2type<T>()) = Checksum<T>(anInfo);
+#endif
+
+		itsCacheSizeBytes += elem->size;
+
+		// move element to the front of the correct list; iterator stays valid
+
+		cache_list& from = (elem->pinned) ? shard.pinnedList : shard.lruList;
+		cache_list& to = (pin) ? shard.pinnedList : shard.lruList;
+
+		to.splice(to.begin(), from, elem);
+		elem->pinned = pin;
+	}
+
+	if (itsLogger.DebugState() <= kTraceMsg)
+	{
+		itsLogger.Trace("Data with name " + static_cast<string>(uniqueName) + " replaced");
+	}
+
+	if (IsOverLimit())
+	{
+		Evict(shardIndex);
+	}
 }
-void cache_pool::Clean()
+
+template void cache_pool::Replace<double>(const unique_key&, shared_ptr<himan::info<double>>, bool);
+template void cache_pool::Replace<float>(const unique_key&, shared_ptr<himan::info<float>>, bool);
+
+void cache_pool::UpdateTime(const unique_key& uniqueName)
 {
-	ASSERT(itsCacheLimit > 0);
-	if (itsCache.size() <= static_cast<size_t>(itsCacheLimit))
+	const auto& shard = Shard(uniqueName);
+
+	ReadLock lock(shard.mutex);
+
+	const auto it = shard.index.find(uniqueName);
+
+	if (it != shard.index.end())
 	{
-		return;
+		it->second->referenced.store(true, memory_order_relaxed);
 	}
+}
 
-	string oldestName;
-	time_t oldestTime = INT_MAX;
+bool cache_pool::IsOverLimit() const
+{
+	return (itsCacheLimit > -1 && itsCacheSize > static_cast<size_t>(itsCacheLimit)) ||
+	       (itsCacheLimitBytes > 0 && itsCacheSizeBytes > itsCacheLimitBytes);
+}
 
+bool cache_pool::EvictOne(cache_shard& shard)
+{
+	// Second chance: elements that have been read since they were last
+	// considered for eviction are moved back to the front of the list.
+	// Every element is moved at most once per call, so the loop is bounded.
+
+	while (!shard.lruList.empty())
 	{
-		Lock lock(itsAccessMutex);
+		auto oldest = prev(shard.lruList.end());
+
+		if (oldest->referenced.exchange(false, memory_order_relaxed))
+		{
+			shard.lruList.splice(shard.lruList.begin(), shard.lruList, oldest);
+			continue;
+		}
 
-		for (const auto& kv : itsCache)
+		if (itsLogger.DebugState() <= kTraceMsg)
 		{
-			if (kv.second.access_time < oldestTime && !kv.second.pinned)
-			{
-				oldestName = kv.first;
-				oldestTime = kv.second.access_time;
-			}
+			itsLogger.Trace("Data cleared from cache: " + static_cast<string>(oldest->key) +
+			                ", size: " + to_string(oldest->size) + " bytes");
 		}
 
-		ASSERT(!oldestName.empty());
+		itsCacheSize--;
+		itsCacheSizeBytes -= oldest->size;
+
+		shard.index.erase(oldest->key);
+		shard.lruList.erase(oldest);
 
-		itsCache.erase(oldestName);
+		return true;
 	}
 
-	itsLogger.Trace("Data cleared from cache: " + oldestName + " with time: " + to_string(oldestTime));
-	itsLogger.Trace("Cache size: " + to_string(itsCache.size()));
+	return false;
 }
 
-namespace
-{
-template <typename T>
-struct cache_visitor : public boost::static_visitor<std::shared_ptr<himan::info<T>>>
+void cache_pool::Evict(size_t startShard)
 {
-   public:
-	shared_ptr<himan::info<T>> operator()(shared_ptr<himan::info<double>>& fnd) const
-	{
-		return make_shared<himan::info<T>>(*fnd);
-	}
-	shared_ptr<himan::info<T>> operator()(shared_ptr<himan::info<float>>& fnd) const
+	// Evict first from the shard where data was just added to, and continue
+	// to other shards only if that was not enough. Only one shard is locked
+	// at a time.
+
+	for (size_t i = 0; i < kShardCount && IsOverLimit(); i++)
 	{
-		return make_shared<himan::info<T>>(*fnd);
+		auto& shard = itsShards[(startShard + i) % kShardCount];
+
+		WriteLock lock(shard.mutex);
+
+		while (IsOverLimit() && EvictOne(shard))
+		{
+		}
 	}
-};
-}  // namespace
+
+	itsLogger.Trace("Cache size: " + to_string(itsCacheSize) + " elements, " + to_string(itsCacheSizeBytes) + " bytes");
+}
+
+void cache_pool::Clean()
+{
+	Evict(0);
+}
 
 template <typename T>
-shared_ptr<himan::info<T>> cache_pool::GetInfo(const string& uniqueName, bool strict)
+shared_ptr<himan::info<T>> cache_pool::GetInfo(const unique_key& uniqueName, bool strict)
 {
-	std::map<std::string, cache_item>::iterator it;
+	typedef typename other_type<T>::type U;
+
+	auto& shard = Shard(uniqueName);
+
+	shared_ptr<info<T>> found;
+	shared_ptr<info<U>> other;
+#ifdef DEBUG
+	size_t checksum = 0;
+#endif
+
+	{
+		ReadLock lock(shard.mutex);
+
+		const auto it = shard.index.find(uniqueName);
+
+		if (it == shard.index.end())
+		{
+			return nullptr;
+		}
+
+		it->second->referenced.store(true, memory_order_relaxed);
+
+		// copy the shared pointer so that the element stays alive even if it
+		// is evicted while we are using it
+
+		found = it->second->Info(type2type<T>());
+#ifdef DEBUG
+		checksum = it->second->Checksum(type2type<T>());
+#endif
+
+		if (!found)
+		{
+			other = it->second->Info(type2type<U>());
+		}
+	}
 
+	if (found)
 	{
-		Lock lock(itsAccessMutex);
-		it = itsCache.find(uniqueName);
+#ifdef DEBUG
+		if (Checksum<T>(found) != checksum)
+		{
+			itsLogger.Fatal("Cached data of " + static_cast<string>(uniqueName) +
+			                " has been modified in place; info::Detach() must be called before modifying fetched data");
+			himan::Abort();
+		}
+#endif
+
+		// Data is found from cache with correct data type: return a new info
+		// that shares the data with the cached one, so that caller can move
+		// the iterators freely
+
+		auto ret = make_shared<info<T>>(*found);
+
+		if (ret->PackedData()->HasData())
+		{
+			// Cached data is packed: unpack it to the returned info only, cache
+			// keeps the packed data
+			util::Unpack<T>({ret}, false);
+		}
+
+		return ret;
 	}
 
-	if (it == itsCache.end())
+	if (strict)
 	{
 		return nullptr;
 	}
 
-	try
+	ASSERT(other);
+
+	if (other->PackedData()->HasData())
 	{
-		// if data is directly found from cache with correct data type,
-		// return that
-		return make_shared<info<T>>(*boost::get<std::shared_ptr<info<T>>>(it->second.info));
+		// Packed data does not depend on data type: unpack it directly to
+		// wanted type, no need to store a converted copy to cache
+
+		auto converted = make_shared<info<T>>(*other);
+		converted->Base()->pdata = other->PackedData();
+
+		util::Unpack<T>({converted}, false);
+
+		return converted;
 	}
-	catch (boost::bad_get& e)
+
+	// Convert to wanted data type and store the result so that next request
+	// does not have to convert again
+
+	auto converted = make_shared<info<T>>(*other);
+	const size_t size = DataSizeInBytes<T>(converted);
+
 	{
-		if (strict)
+		WriteLock lock(shard.mutex);
+
+		const auto it = shard.index.find(uniqueName);
+
+		if (it != shard.index.end() && it->second->Info(type2type<U>()) == other &&
+		    !it->second->Info(type2type<T>()))
 		{
-			return nullptr;
+			it->second->Info(type2type<T>()) = converted;
+#ifdef DEBUG
+			it->second->Checksum(type2type<T>()) = Checksum<T>(converted);
+#endif
+			it->second->size += size;
+			itsCacheSizeBytes += size;
 		}
-
-		// convert to wanted data type
-		return boost::apply_visitor(cache_visitor<T>(), it->second.info);
 	}
-	catch (exception& e)
+
+	if (IsOverLimit())
 	{
-		itsLogger.Error(e.what());
+		Evict(uniqueName.Hash() % kShardCount);
 	}
 
-	return nullptr;
+	return make_shared<info<T>>(*converted);
 }
 
-template shared_ptr<himan::info<double>> cache_pool::GetInfo<double>(const string&, bool);
-template shared_ptr<himan::info<float>> cache_pool::GetInfo<float>(const string&, bool);
+template shared_ptr<himan::info<double>> cache_pool::GetInfo<double>(const unique_key&, bool);
+template shared_ptr<himan::info<float>> cache_pool::GetInfo<float>(const unique_key&, bool);
 
 size_t cache_pool::Size() const
 {
-	return itsCache.size();
+	return itsCacheSize;
+}
+
+size_t cache_pool::SizeInBytes() const
+{
+	return itsCacheSizeBytes;
 }
@@ -7,8 +7,8 @@
 #include "logger.h"
 #include "numerical_functions.h"
 #include "plugin_factory.h"
+#include "thread_pool.h"
 #include "util.h"
-#include <future>
 
 #include "debug.h"
 #include "fetcher.h"
@@ -220,44 +220,17 @@ string PrintMean(const vector<T>& vec)
 void MoistLift(const float* Piter, const float* Titer, const float* Penv, float* Tparcel, size_t size)
 {
 	// Split MoistLift (integration of a saturated air parcel upwards in atmosphere)
-	// to several threads since it is very CPU intensive
+	// to several tasks since it is very CPU intensive
 
-	vector<future<void>> futures;
+	auto pool = himan::thread_pool::Instance();
+	const size_t grain = std::max<size_t>(256, size / (4 * pool->Size()));
 
-	size_t workers = 6;
-
-	if (size % workers != 0)
-	{
-		workers = 4;
-		if (size % workers != 0)
+	pool->ParallelFor(0, size, grain, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
 		{
-			workers = 3;
-			if (size % workers != 0)
-			{
-				workers = 1;
-			}
+			Tparcel[i] = himan::metutil::MoistLiftA_<float>(Piter[i], Titer[i], Penv[i]);
 		}
-	}
-
-	const size_t splitSize = static_cast<size_t>(floor(size / workers));
-
-	for (size_t num = 0; num < workers; num++)
-	{
-		const size_t start = num * splitSize;
-		futures.push_back(async(launch::async,
-		                        [&](size_t _start) {
-			                        for (size_t i = _start; i < _start + splitSize; i++)
-			                        {
-				                        Tparcel[i] = himan::metutil::MoistLiftA_<float>(Piter[i], Titer[i], Penv[i]);
-			                        }
-		                        },
-		                        start));
-	}
-
-	for (auto& future : futures)
-	{
-		future.get();
-	}
+	});
 }
 
 cape::cape() : itsBottomLevel(kHybrid, kHPMissingInt), itsUseVirtualTemperature(true)
@@ -396,7 +369,8 @@ void cape::MostUnstableCAPE(shared_ptr<info<float>> myTargetInfo, short threadIn
 
 	tmr.Start();
 
-	vector<future<tuple15f>> futures;
+	// Result of each source level
+	vector<tuple15f> taskResults(num);
 
 	// This is where we store the results of the runs
 	vector<tuple15f> results;
@@ -404,48 +378,41 @@ void cape::MostUnstableCAPE(shared_ptr<info<float>> myTargetInfo, short threadIn
 	// This is where we put thetae values so they are more convenient to read later on
 	vec2d refValues(N);
 
-	for (size_t taskIndex = 0; taskIndex < num; taskIndex++)
-	{
-		log.Debug("Launching async task #" + to_string(taskIndex));
+	himan::thread_pool::Instance()->ParallelFor(0, num, 1, [&](size_t taskIndex, size_t) {
+		logger tasklog("muCAPEThread#" + to_string(threadIndex) + "asyncTask#" + to_string(taskIndex));
 
-		futures.push_back(async(
-		    launch::async,
-		    [&myTargetInfo, this](const cape_source& sourceValues, short threadId, size_t taskId) {
-			    logger tasklog("muCAPEThread#" + to_string(threadId) + "asyncTask#" + to_string(taskId));
+		const cape_source sourceValues = make_tuple(Ts[taskIndex], TDs[taskIndex], Ps[taskIndex]);
 
-			    timer tasktmr(true);
-			    auto LCL = GetLCL(sourceValues);
-			    tasktmr.Stop();
-			    tasklog.Debug("LCL in " + to_string(tasktmr.GetTime()) + "ms");
+		timer tasktmr(true);
+		auto LCL = GetLCL(sourceValues);
+		tasktmr.Stop();
+		tasklog.Debug("LCL in " + to_string(tasktmr.GetTime()) + "ms");
 
-			    tasktmr.Start();
-			    auto LFC = GetLFC(myTargetInfo, LCL.first, LCL.second);
-			    tasktmr.Stop();
-			    tasklog.Debug("LFC in " + to_string(tasktmr.GetTime()) + "ms");
+		tasktmr.Start();
+		auto LFC = GetLFC(myTargetInfo, LCL.first, LCL.second);
+		tasktmr.Stop();
+		tasklog.Debug("LFC in " + to_string(tasktmr.GetTime()) + "ms");
 
-			    const auto missingLFCcount =
-			        count_if(LFC[0].first.begin(), LFC[0].first.end(), [](const float& f) { return IsMissing(f); });
+		const auto missingLFCcount =
+		    count_if(LFC[0].first.begin(), LFC[0].first.end(), [](const float& f) { return IsMissing(f); });
 
-			    if (LFC[0].first.empty() || static_cast<int>(LFC[0].first.size()) == missingLFCcount)
-			    {
-				    tasklog.Warning("LFC level not found");
-				    return tuple15f();
-			    }
-
-			    tasktmr.Start();
-			    auto CAPE = GetCAPE(myTargetInfo, LFC[0]);
-			    tasktmr.Stop();
-			    tasklog.Debug("CAPE in " + to_string(tasktmr.GetTime()) + "ms");
+		if (LFC[0].first.empty() || static_cast<int>(LFC[0].first.size()) == missingLFCcount)
+		{
+			tasklog.Warning("LFC level not found");
+			return;
+		}
 
-			    return tuple_cat(LCL, LFC[0], LFC[1], CAPE);
+		tasktmr.Start();
+		auto CAPE = GetCAPE(myTargetInfo, LFC[0]);
+		tasktmr.Stop();
+		tasklog.Debug("CAPE in " + to_string(tasktmr.GetTime()) + "ms");
 
-		    },
-		    make_tuple(Ts[taskIndex], TDs[taskIndex], Ps[taskIndex]), threadIndex, taskIndex));
-	}
+		taskResults[taskIndex] = tuple_cat(LCL, LFC[0], LFC[1], CAPE);
+	});
 
-	for (size_t i = 0; i < futures.size(); i++)
+	for (size_t i = 0; i < taskResults.size(); i++)
 	{
-		auto res = futures[i].get();
+		const auto& res = taskResults[i];
 
 		if (get<0>(res).empty())
 		{
@@ -539,13 +506,14 @@ void cape::MostUnstableCAPE(shared_ptr<info<float>> myTargetInfo, short threadIn
 		}
 	}
 
-	future<vector<float>> CINfut =
-	    async(launch::async, &cape::GetCIN, this, myTargetInfo, LPLT, LPLP, LCLP, CinLFCP, CinLFCZ);
+	vector<float> CIN, LCLZ;
 
-	log.Debug("Fetching LCL height");
-	auto LCLZ = h->VerticalValue<float>(ZParam, LCLP);
+	himan::thread_pool::Instance()->Invoke({[&]() { CIN = GetCIN(myTargetInfo, LPLT, LPLP, LCLP, CinLFCP, CinLFCZ); },
+	                                 [&]() {
+		                                 log.Debug("Fetching LCL height");
+		                                 LCLZ = h->VerticalValue<float>(ZParam, LCLP);
+	                                 }});
 
-	auto CIN = CINfut.get();
 	CheckDataConsistency(LCLZ, LFCT, LFCP, LFCZ, ELT, ELP, ELZ, LastELT, LastELP, LastELZ, CAPE, CAPE1040, CAPE3km,
 	                     CIN);
 	SetDataToInfo(myTargetInfo, LCLT, LCLP, LCLZ, CinLFCT, CinLFCP, CinLFCZ, ELT, ELP, ELZ, LastELT, LastELP, LastELZ,
@@ -673,15 +641,17 @@ void cape::Calculate(shared_ptr<info<float>> myTargetInfo, unsigned short thread
 
 	aTimer.Start();
 
-	// CAPE is integrated from lowest LFC
-	future<CAPEdata> CAPEfut = async(launch::async, &cape::GetCAPE, this, myTargetInfo, LFC[0]);
-
-	// CIN is integrated to highest LFC, because surface&500m mix LPL is always below 650hPa
-	future<vector<float>> CINfut = async(launch::async, &cape::GetCIN, this, myTargetInfo, get<0>(sourceValues),
-	                                     get<2>(sourceValues), LCL.second, LastLFCP, LastLFCZ);
-
-	auto CAPEresult = CAPEfut.get();
-	auto CIN = CINfut.get();
+	CAPEdata CAPEresult;
+	vector<float> CIN;
+
+	himan::thread_pool::Instance()->Invoke({// CAPE is integrated from lowest LFC
+	                                 [&]() { CAPEresult = GetCAPE(myTargetInfo, LFC[0]); },
+	                                 // CIN is integrated to highest LFC, because surface&500m mix LPL is always
+	                                 // below 650hPa
+	                                 [&]() {
+		                                 CIN = GetCIN(myTargetInfo, get<0>(sourceValues), get<2>(sourceValues),
+		                                              LCL.second, LastLFCP, LastLFCZ);
+	                                 }});
 
 	aTimer.Stop();
 
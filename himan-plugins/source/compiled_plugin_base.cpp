@@ -6,15 +6,20 @@
 
 #include "compiled_plugin_base.h"
 #include "cuda_helper.h"
+#include "file_accessor.h"
 #include "logger.h"
 #include "plugin_factory.h"
+#include "s3.h"
 #include "statistics.h"
+#include "thread_pool.h"
 #include "util.h"
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 
 #include "cache.h"
 #include "fetcher.h"
+#include "grib.h"
 #include "radon.h"
 #include "writer.h"
 
@@ -24,85 +29,130 @@ using namespace himan::plugin;
 
 mutex dimensionMutex;
 
-template <typename T>
-bool compiled_plugin_base::Next(info<T>& myTargetInfo)
+namespace
 {
-	lock_guard<mutex> lock(dimensionMutex);
-
-	if (!itsDimensionsRemaining)
-	{
-		return false;
-	}
+// Move iterators to the next dimension that is given to a thread.
+// Returns false if there are no dimensions left.
 
-	if (itsThreadDistribution == ThreadDistribution::kThreadForAny ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForForecastTypeAndLevel ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForTimeAndLevel ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForLevel)
+bool AdvanceIterators(ThreadDistribution threadDistribution, forecast_type_iter& forecastTypeIterator,
+                      time_iter& timeIterator, level_iter& levelIterator)
+{
+	if (threadDistribution == ThreadDistribution::kThreadForAny ||
+	    threadDistribution == ThreadDistribution::kThreadForForecastTypeAndLevel ||
+	    threadDistribution == ThreadDistribution::kThreadForTimeAndLevel ||
+	    threadDistribution == ThreadDistribution::kThreadForLevel)
 	{
-		if (itsLevelIterator.Next())
+		if (levelIterator.Next())
 		{
-			bool ret = myTargetInfo.template Find<level>(itsLevelIterator.At());
-			ASSERT(ret);
-			ret = myTargetInfo.template Find<forecast_time>(itsTimeIterator.At());
-			ASSERT(ret);
-			ret = myTargetInfo.template Find<forecast_type>(itsForecastTypeIterator.At());
-			ASSERT(ret);
-
-			return ret;
+			return true;
 		}
 
 		// No more levels at this forecast type/time combination; rewind level iterator
 
-		itsLevelIterator.First();
+		levelIterator.First();
 	}
 
-	if (itsThreadDistribution == ThreadDistribution::kThreadForAny ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForForecastTypeAndTime ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForTimeAndLevel ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForTime)
+	if (threadDistribution == ThreadDistribution::kThreadForAny ||
+	    threadDistribution == ThreadDistribution::kThreadForForecastTypeAndTime ||
+	    threadDistribution == ThreadDistribution::kThreadForTimeAndLevel ||
+	    threadDistribution == ThreadDistribution::kThreadForTime)
 	{
-		if (itsTimeIterator.Next())
+		if (timeIterator.Next())
 		{
-			bool ret = myTargetInfo.template Find<forecast_time>(itsTimeIterator.At());
-			ASSERT(ret);
-			ret = myTargetInfo.template Find<level>(itsLevelIterator.At());
-			ASSERT(ret);
-			ret = myTargetInfo.template Find<forecast_type>(itsForecastTypeIterator.At());
-			ASSERT(ret);
-
-			return ret;
+			return true;
 		}
 
 		// No more times at this forecast type; rewind time iterator, level iterator is
 		// already at first place
 
-		itsTimeIterator.First();
+		timeIterator.First();
 	}
 
-	if (itsThreadDistribution == ThreadDistribution::kThreadForAny ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForForecastTypeAndTime ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForForecastTypeAndLevel ||
-	    itsThreadDistribution == ThreadDistribution::kThreadForForecastType)
+	if (threadDistribution == ThreadDistribution::kThreadForAny ||
+	    threadDistribution == ThreadDistribution::kThreadForForecastTypeAndTime ||
+	    threadDistribution == ThreadDistribution::kThreadForForecastTypeAndLevel ||
+	    threadDistribution == ThreadDistribution::kThreadForForecastType)
 	{
-		if (itsForecastTypeIterator.Next())
+		if (forecastTypeIterator.Next())
 		{
-			bool ret = myTargetInfo.template Find<forecast_time>(itsTimeIterator.At());
-			ASSERT(ret);
-			ret = myTargetInfo.template Find<level>(itsLevelIterator.At());
-			ASSERT(ret);
-			ret = myTargetInfo.template Find<forecast_type>(itsForecastTypeIterator.At());
-			ASSERT(ret);
-
-			return ret;
+			return true;
 		}
 	}
-	// future threads calling for new dimensions aren't getting any
-
-	itsDimensionsRemaining = false;
 
 	return false;
 }
 
+// Read data from files packed if it's unpacked later in GPU, or if packed
+// data is kept in cache.
+
+bool ReadPackedData(const configuration& conf)
+{
+	return conf.UseCudaForPacking() || conf.UsePackedCache();
+}
+
+// In packed cache mode fetcher has already inserted the packed data to cache,
+// and there is no point in keeping an unpacked copy there too.
+
+bool AddUnpackedToCache(const configuration& conf)
+{
+	return conf.UseCacheForReads() && !conf.UsePackedCache();
+}
+}  // namespace
+
+template <typename T>
+bool compiled_plugin_base::Next(info<T>& myTargetInfo)
+{
+	lock_guard<mutex> lock(dimensionMutex);
+
+	if (!itsDimensionsRemaining)
+	{
+		return false;
+	}
+
+	if (!AdvanceIterators(itsThreadDistribution, itsForecastTypeIterator, itsTimeIterator, itsLevelIterator))
+	{
+		// future threads calling for new dimensions aren't getting any
+
+		itsDimensionsRemaining = false;
+
+		return false;
+	}
+
+	bool ret = myTargetInfo.template Find<forecast_time>(itsTimeIterator.At());
+	ASSERT(ret);
+	ret = myTargetInfo.template Find<level>(itsLevelIterator.At());
+	ASSERT(ret);
+	ret = myTargetInfo.template Find<forecast_type>(itsForecastTypeIterator.At());
+	ASSERT(ret);
+
+	if (!itsPrefetchInputs.empty())
+	{
+		// Start reading data for the dimensions that are given out next. On the
+		// first call all of them are scheduled, after that only the one that
+		// just came within prefetch distance.
+
+		forecast_type_iter forecastTypeIterator(itsForecastTypeIterator);
+		time_iter timeIterator(itsTimeIterator);
+		level_iter levelIterator(itsLevelIterator);
+
+		const size_t distance = static_cast<size_t>(itsConfiguration->PrefetchDistance());
+
+		for (size_t i = 1;
+		     i <= distance && AdvanceIterators(itsThreadDistribution, forecastTypeIterator, timeIterator, levelIterator);
+		     i++)
+		{
+			if (i == distance || !itsPrefetchStarted)
+			{
+				SchedulePrefetch<T>(forecastTypeIterator.At(), timeIterator.At(), levelIterator.At());
+			}
+		}
+
+		itsPrefetchStarted = true;
+	}
+
+	return ret;
+}
+
 template bool compiled_plugin_base::Next<double>(info<double>&);
 template bool compiled_plugin_base::Next<float>(info<float>&);
 
@@ -321,7 +371,7 @@ void compiled_plugin_base::SetThreadCount()
 	}
 
 	const auto cnfCount = itsConfiguration->ThreadCount();
-	itsThreadCount = (cnfCount == -1) ? static_cast<short>(std::min(12, static_cast<int>(dims))) : cnfCount;
+	itsThreadCount = (cnfCount == -1) ? static_cast<short>(std::min(thread_pool::Instance()->Size(), dims)) : cnfCount;
 	itsConfiguration->Statistics()->UsedThreadCount(itsThreadCount);
 }
 
@@ -400,24 +450,40 @@ void compiled_plugin_base::Start()
 		}
 	}
 
+	// Input files that were mapped by earlier plugins may have changed
+	file_accessor::NewMappingGeneration();
+
 	SetThreadCount();
 	SetInitialIteratorPositions();
+	StartWriterThreads();
+	StartPrefetchThreads();
 
 	itsBaseLogger.Info("Plugin is using data type: " + TypeToName<T>());
 
-	vector<thread> threads;
+	// Calculating threads are tasks in the process-wide thread pool, so that
+	// concurrently executed plugins and nested parallel loops share the cores
 
-	for (short i = 0; i < itsThreadCount; i++)
+	itsBaseLogger.Info("Starting " + to_string(itsThreadCount) + " tasks in a pool of " +
+	                   to_string(thread_pool::Instance()->Size()) + " threads");
+
+	try
 	{
-		itsBaseLogger.Info("Thread " + to_string(i) + " starting");
-		threads.emplace_back(thread(&compiled_plugin_base::Run<T>, this, make_shared<info<T>>(*baseInfo), i + 1));
+		thread_pool::Instance()->ParallelFor(0, static_cast<size_t>(itsThreadCount), 1, [&](size_t first, size_t) {
+			Run<T>(make_shared<info<T>>(*baseInfo), static_cast<unsigned short>(first + 1));
+		});
 	}
-
-	for (auto& t : threads)
+	catch (...)
 	{
-		t.join();
+		// Writer and prefetch threads must be joined before they are destroyed
+
+		StopPrefetchThreads();
+		StopWriterThreads();
+		throw;
 	}
 
+	StopPrefetchThreads();
+	StopWriterThreads();
+
 	Finish();
 }
 
@@ -462,15 +528,337 @@ void compiled_plugin_base::Run(shared_ptr<info<T>> myTargetInfo, unsigned short
 			itsConfiguration->Statistics()->AddToValueCount(myTargetInfo->Data().Size());
 		}
 
-		WriteToFile(myTargetInfo);
+		QueueWrite(myTargetInfo);
 	}
 }
 
 template void compiled_plugin_base::Run<double>(shared_ptr<info<double>>, unsigned short);
 template void compiled_plugin_base::Run<float>(shared_ptr<info<float>>, unsigned short);
 
+void compiled_plugin_base::Prefetch(const vector<prefetch_input>& inputs)
+{
+	if (!itsConfiguration->UseCacheForReads())
+	{
+		itsBaseLogger.Debug("Cache is not used for reads, prefetching is disabled");
+		return;
+	}
+
+	itsPrefetchInputs = inputs;
+}
+
+template <typename T>
+void compiled_plugin_base::SchedulePrefetch(const forecast_type& ftype, const forecast_time& ftime, const level& lvl)
+{
+	// Called with dimensionMutex held
+
+	const auto inputs = itsPrefetchInputs;
+	const auto conf = itsConfiguration;
+
+	auto task = [=]() {
+		auto f = GET_PLUGIN(fetcher);
+
+		for (const auto& input : inputs)
+		{
+			forecast_time inputTime = ftime;
+			inputTime.ValidDateTime() += input.offset;
+
+			const level inputLevel = (input.lvl.Type() == kUnknownLevel) ? lvl : input.lvl;
+
+			try
+			{
+				// Result is not needed, fetcher stores it to cache
+				f->Fetch<T>(conf, inputTime, inputLevel, input.par, ftype, conf->UsePackedCache(), true);
+			}
+			catch (...)
+			{
+				// Missing data is reported when plugin fetches it
+			}
+		}
+	};
+
+	{
+		lock_guard<mutex> lock(itsPrefetchQueueMutex);
+
+		itsPrefetchQueue.push_back(task);
+
+		// If reading is slower than calculation, the oldest queued dimensions
+		// have already been given to calculating threads: reading them here
+		// would only delay the ones that are still ahead
+
+		while (itsPrefetchQueue.size() > static_cast<size_t>(itsConfiguration->PrefetchDistance()))
+		{
+			itsPrefetchQueue.pop_front();
+			itsPrefetchDropCount++;
+		}
+	}
+
+	itsPrefetchQueueNotEmpty.notify_one();
+}
+
+void compiled_plugin_base::StartPrefetchThreads()
+{
+	if (itsPrefetchInputs.empty())
+	{
+		return;
+	}
+
+	// Reads are done in threads of their own and not in the thread pool, as
+	// calculating tasks keep all pool threads busy until the plugin finishes
+
+	const auto prefetchCount = itsConfiguration->PrefetchDistance();
+
+	itsPrefetchQueueClosed = false;
+	itsPrefetchStarted = false;
+	itsPrefetchDropCount = 0;
+
+	itsBaseLogger.Debug("Starting " + to_string(prefetchCount) + " prefetch threads");
+
+	for (short i = 0; i < prefetchCount; i++)
+	{
+		itsPrefetchThreads.emplace_back(&compiled_plugin_base::PrefetchThread, this);
+	}
+}
+
+void compiled_plugin_base::StopPrefetchThreads()
+{
+	if (itsPrefetchThreads.empty())
+	{
+		return;
+	}
+
+	size_t dropped;
+
+	{
+		// Calculation has ended, so reads that have not been started yet are
+		// not needed anymore
+
+		lock_guard<mutex> lock(itsPrefetchQueueMutex);
+		itsPrefetchQueueClosed = true;
+		itsPrefetchDropCount += itsPrefetchQueue.size();
+		itsPrefetchQueue.clear();
+		dropped = itsPrefetchDropCount;
+	}
+
+	itsPrefetchQueueNotEmpty.notify_all();
+
+	for (auto& prefetchThread : itsPrefetchThreads)
+	{
+		prefetchThread.join();
+	}
+
+	itsPrefetchThreads.clear();
+
+	itsBaseLogger.Debug("Prefetch threads stopped, " + to_string(dropped) + " dimensions were not read ahead");
+}
+
+void compiled_plugin_base::PrefetchThread()
+{
+	while (true)
+	{
+		function<void()> task;
+
+		{
+			unique_lock<mutex> lock(itsPrefetchQueueMutex);
+			itsPrefetchQueueNotEmpty.wait(lock, [&]() { return !itsPrefetchQueue.empty() || itsPrefetchQueueClosed; });
+
+			if (itsPrefetchQueueClosed)
+			{
+				return;
+			}
+
+			task = move(itsPrefetchQueue.front());
+			itsPrefetchQueue.pop_front();
+		}
+
+		timer t(true);
+
+		task();
+
+		t.Stop();
+
+		// Time of reads that were finished while calculating threads were still
+		// running is the time by which reading overlapped calculation
+
+		bool overlapped;
+
+		{
+			lock_guard<mutex> lock(itsPrefetchQueueMutex);
+			overlapped = !itsPrefetchQueueClosed;
+		}
+
+		if (overlapped && itsConfiguration->StatisticsEnabled())
+		{
+			itsConfiguration->Statistics()->AddToPrefetchCount(1);
+			itsConfiguration->Statistics()->AddToPrefetchTime(t.GetTime());
+		}
+	}
+}
+
+void compiled_plugin_base::StartWriterThreads()
+{
+	const auto writerCount = itsConfiguration->WriteThreadCount();
+
+	if (writerCount <= 0)
+	{
+		return;
+	}
+
+	// Queue is bounded so that compute threads cannot get too far ahead of
+	// writers: each queued element holds a calculated grid in memory
+
+	itsWriteQueueLimit = static_cast<size_t>(2 * writerCount);
+	itsWriteQueueClosed = false;
+
+	itsBaseLogger.Debug("Starting " + to_string(writerCount) + " writer threads");
+
+	for (short i = 0; i < writerCount; i++)
+	{
+		itsWriterThreads.emplace_back(&compiled_plugin_base::WriterThread, this);
+	}
+}
+
+void compiled_plugin_base::StopWriterThreads()
+{
+	if (itsWriterThreads.empty())
+	{
+		return;
+	}
+
+	timer t(true);
+
+	{
+		lock_guard<mutex> lock(itsWriteQueueMutex);
+		itsWriteQueueClosed = true;
+	}
+
+	itsWriteQueueNotEmpty.notify_all();
+
+	for (auto& writerThread : itsWriterThreads)
+	{
+		writerThread.join();
+	}
+
+	itsWriterThreads.clear();
+
+	if (itsConfiguration->StatisticsEnabled())
+	{
+		t.Stop();
+		itsConfiguration->Statistics()->AddToWriteDrainTime(t.GetTime());
+	}
+}
+
+void compiled_plugin_base::WriterThread()
+{
+	while (true)
+	{
+		function<void()> task;
+
+		{
+			unique_lock<mutex> lock(itsWriteQueueMutex);
+			itsWriteQueueNotEmpty.wait(lock, [&]() { return !itsWriteQueue.empty() || itsWriteQueueClosed; });
+
+			if (itsWriteQueue.empty())
+			{
+				// queue is closed and all data is written
+				return;
+			}
+
+			task = move(itsWriteQueue.front());
+			itsWriteQueue.pop_front();
+		}
+
+		itsWriteQueueNotFull.notify_one();
+
+		try
+		{
+			task();
+		}
+		catch (const exception& e)
+		{
+			itsBaseLogger.Fatal("Writing data failed: " + string(e.what()));
+			himan::Abort();
+		}
+	}
+}
+
+template <typename T>
+void compiled_plugin_base::QueueWrite(shared_ptr<info<T>> targetInfo)
+{
+	if (itsWriterThreads.empty())
+	{
+		WriteToFile(targetInfo);
+		return;
+	}
+
+	// Calling thread continues with the same info instance: give writer
+	// a copy that has the current iterator positions. Data is shared and it
+	// is not modified when the calling thread moves to next grid.
+
+	auto tempInfo = make_shared<info<T>>(*targetInfo);
+
+	timer t(true);
+
+	{
+		unique_lock<mutex> lock(itsWriteQueueMutex);
+		itsWriteQueueNotFull.wait(lock, [&]() { return itsWriteQueue.size() < itsWriteQueueLimit; });
+
+		itsWriteQueue.push_back([=]() { WriteToFile(tempInfo); });
+	}
+
+	itsWriteQueueNotEmpty.notify_one();
+
+	if (itsConfiguration->StatisticsEnabled())
+	{
+		t.Stop();
+		itsConfiguration->Statistics()->AddToWriteQueueWaitTime(t.GetTime());
+	}
+}
+
+template void compiled_plugin_base::QueueWrite<double>(shared_ptr<info<double>>);
+template void compiled_plugin_base::QueueWrite<float>(shared_ptr<info<float>>);
+
 void compiled_plugin_base::Finish()
 {
+	const string writerName = itsConfiguration->Name() + "#" + to_string(itsConfiguration->RelativeOrdinalNumber());
+	const auto fileType = itsConfiguration->OutputFileType();
+
+	if (itsConfiguration->WriteStorageType() == kLocalFileSystem &&
+	    (fileType == kGRIB || fileType == kGRIB1 || fileType == kGRIB2))
+	{
+		GET_PLUGIN(grib)->CloseFiles(writerName);
+	}
+
+	if (itsConfiguration->WriteStorageType() == kS3ObjectStorageSystem &&
+	    itsConfiguration->WriteMode() == kFewGridsToAFile)
+	{
+		// Objects of this plugin are complete, make them readable. With other write
+		// modes objects are shared between plugins and they are finished when
+		// Himan exits.
+
+		try
+		{
+			s3::Flush(writerName);
+		}
+		catch (const exception& e)
+		{
+			itsBaseLogger.Fatal(e.what());
+			himan::Abort();
+		}
+	}
+
+	if (itsConfiguration->WriteToDatabase() && itsConfiguration->DatabaseType() == kRadon)
+	{
+		try
+		{
+			GET_PLUGIN(radon)->Flush();
+		}
+		catch (const exception& e)
+		{
+			itsBaseLogger.Fatal(e.what());
+			himan::Abort();
+		}
+	}
+
 	if (itsConfiguration->StatisticsEnabled())
 	{
 		itsTimer.Stop();
@@ -683,24 +1071,22 @@ shared_ptr<info<T>> compiled_plugin_base::Fetch(const forecast_time& theTime, co
 		/*
 		 * Fetching of packed data is quite convoluted:
 		 *
-		 * 1) Fetch packed data iff cuda unpacking is enabled (UseCudaForPacking() == true): it makes no sense
-		 * to unpack the data in himan with CPU. If we allow fetcher to return packed data, it will implicitly
-		 * disable cache integration of fetched data.
+		 * 1) Fetch packed data iff cuda unpacking is enabled (UseCudaForPacking() == true) or packed data is
+		 * kept in cache (UsePackedCache() == true). If we allow fetcher to return packed data, it will implicitly
+		 * disable cache integration of fetched data, unless packed data is kept in cache.
 		 *
-		 * 2a) If caller does not want packed data (returnPacked == false), unpack it here and insert to cache.
+		 * 2a) If caller does not want packed data (returnPacked == false), unpack it here and insert to cache
+		 * (in packed cache mode the packed data is already in cache).
 		 *
 		 * 2b) If caller wants packed data, return data as-is and leave cache integration to caller.
 		 */
 
-		ret =
-		    f->Fetch<T>(itsConfiguration, theTime, theLevel, theParams, theType, itsConfiguration->UseCudaForPacking());
+		ret = f->Fetch<T>(itsConfiguration, theTime, theLevel, theParams, theType, ReadPackedData(*itsConfiguration));
 
-#ifdef HAVE_CUDA
 		if (!returnPacked && ret->PackedData()->HasData())
 		{
-			util::Unpack<T>({ret}, itsConfiguration->UseCacheForReads());
+			util::Unpack<T>({ret}, AddUnpackedToCache(*itsConfiguration));
 		}
-#endif
 	}
 	catch (HPExceptionType& e)
 	{
@@ -736,15 +1122,12 @@ shared_ptr<info<T>> compiled_plugin_base::Fetch(const forecast_time& theTime, co
 
 	try
 	{
-		ret =
-		    f->Fetch<T>(itsConfiguration, theTime, theLevel, theParam, theType, itsConfiguration->UseCudaForPacking());
+		ret = f->Fetch<T>(itsConfiguration, theTime, theLevel, theParam, theType, ReadPackedData(*itsConfiguration));
 
-#ifdef HAVE_CUDA
 		if (!returnPacked && ret->PackedData()->HasData())
 		{
-			util::Unpack<T>({ret}, itsConfiguration->UseCacheForReads());
+			util::Unpack<T>({ret}, AddUnpackedToCache(*itsConfiguration));
 		}
-#endif
 	}
 	catch (HPExceptionType& e)
 	{
@@ -779,14 +1162,12 @@ shared_ptr<info<T>> compiled_plugin_base::Fetch(const forecast_time& theTime, co
 
 	try
 	{
-		ret = f->Fetch<T>(cnf, theTime, theLevel, theParam, theType, cnf->UseCudaForPacking());
+		ret = f->Fetch<T>(cnf, theTime, theLevel, theParam, theType, ReadPackedData(*cnf));
 
-#ifdef HAVE_CUDA
 		if (!returnPacked && ret->PackedData()->HasData())
 		{
-			util::Unpack<T>({ret}, cnf->UseCacheForReads());
+			util::Unpack<T>({ret}, AddUnpackedToCache(*cnf));
 		}
-#endif
 	}
 	catch (HPExceptionType& e)
 	{
@@ -41,6 +41,10 @@ void dewpoint::Process(shared_ptr<const plugin_configuration> conf)
 
 	SetParams({requestedParam});
 
+	// Source data is read from the same level and time as the target data
+
+	Prefetch({prefetch_input(param("T-K")), prefetch_input(param("RH-PRCNT"))});
+
 	Start();
 }
 
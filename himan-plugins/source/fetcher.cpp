@@ -2,12 +2,14 @@
 #include "interpolate.h"
 #include "logger.h"
 #include "plugin_factory.h"
+#include "s3.h"
 #include "statistics.h"
 #include "util.h"
 #include <boost/filesystem/operations.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <fstream>
 #include <future>
+#include <unordered_map>
 
 #include "cache.h"
 #include "csv.h"
@@ -50,7 +52,7 @@ static mutex stickyMutex;
 // cache while the other threads will wait for the completion of that task.
 
 static mutex singleFetcherMutex;
-map<string, boost::shared_mutex> singleFetcherMap;
+unordered_map<unique_key, boost::shared_mutex> singleFetcherMap;
 
 string CreateNotFoundString(const vector<producer>& prods, const forecast_type& ftype, const forecast_time& time,
                             const level& lev, const vector<param>& params)
@@ -301,11 +303,11 @@ shared_ptr<info<T>> fetcher::FetchFromProducerSingle(search_options& opts, bool
 	 * Insert interpolated data to cache if
 	 * 1. Cache is not disabled locally (itsUseCache) AND
 	 * 2. Cache is not disabled globally (config->UseCache()) AND
-	 * 3. Data is not packed
+	 * 3. Data is not packed, or packed data is allowed in cache
 	 */
 
 	if (ret.first != HPDataFoundFrom::kCache && itsUseCache && opts.configuration->UseCacheForReads() &&
-	    !theInfos[0]->PackedData()->HasData())
+	    (!theInfos[0]->PackedData()->HasData() || opts.configuration->UsePackedCache()))
 	{
 		auto c = GET_PLUGIN(cache);
 		c->Insert<T>(theInfos[0]);
@@ -324,20 +326,21 @@ template <typename T>
 shared_ptr<info<T>> fetcher::FetchFromProducer(search_options& opts, bool readPackedData, bool suppressLogging)
 {
 	// When reading packed data, data is not pushed to cache because it's only unpacked
-	// later. Therefore there is no reason to synchronize thread access.
+	// later. Therefore there is no reason to synchronize thread access. The exception
+	// is packed cache mode, where packed data is stored to cache as is.
 	// TODO: *should* data be unpacked and pushed to cache (it's done so anyway later)?
-	if (readPackedData)
+	if (readPackedData && !opts.configuration->UsePackedCache())
 	{
 		return FetchFromProducerSingle<T>(opts, readPackedData, suppressLogging);
 	}
 
-	const auto uname = util::UniqueName(opts);
-	pair<map<string, boost::shared_mutex>::iterator, bool> muret;
+	const auto ukey = util::UniqueKey(opts);
+	pair<unordered_map<unique_key, boost::shared_mutex>::iterator, bool> muret;
 
 	// First acquire mutex to (possibly) modify map
 	unique_lock<mutex> sflock(singleFetcherMutex);
 
-	muret = singleFetcherMap.emplace(piecewise_construct, forward_as_tuple(uname), forward_as_tuple());
+	muret = singleFetcherMap.emplace(piecewise_construct, forward_as_tuple(ukey), forward_as_tuple());
 
 	if (muret.second == true)
 	{
@@ -367,6 +370,22 @@ vector<shared_ptr<info<T>>> fetcher::FromFile(const vector<file_information>& fi
 {
 	vector<shared_ptr<info<T>>> allInfos;
 
+	// Several S3 messages: read them concurrently with as few requests as possible
+	// to the S3 block cache, where the reads below will find them
+
+	vector<file_information> s3Files;
+
+	copy_if(files.begin(), files.end(), back_inserter(s3Files), [](const file_information& f) {
+		return f.storage_type == HPFileStorageType::kS3ObjectStorageSystem && f.offset && f.length;
+	});
+
+	if (s3Files.size() > 1)
+	{
+		const auto pconf = dynamic_pointer_cast<const plugin_configuration>(options.configuration);
+
+		s3::Prefetch(s3Files, pconf->StatisticsEnabled() ? pconf->Statistics() : nullptr);
+	}
+
 	for (const auto& inputFile : files)
 	{
 		if (inputFile.storage_type == HPFileStorageType::kLocalFileSystem &&
@@ -677,13 +696,19 @@ pair<HPDataFoundFrom, vector<shared_ptr<info<double>>>> fetcher::FetchFromAuxili
 
 				timer t(true);
 
-				ret = FromFile<double>(files, opts, readPackedData, true);
+				// In packed cache mode all grids are kept packed in cache, and they are
+				// unpacked only when they are read from cache
+
+				const bool packedCache = opts.configuration->UsePackedCache();
+
+				ret = FromFile<double>(files, opts, readPackedData || packedCache, true);
 
 				AuxiliaryFilesRotateAndInterpolate(opts, ret);
 
-#ifdef HAVE_CUDA
-				util::Unpack<double>(ret, false);
-#endif
+				if (!packedCache)
+				{
+					util::Unpack<double>(ret, false);
+				}
 
 				for (const auto& info : ret)
 				{
@@ -708,7 +733,33 @@ pair<HPDataFoundFrom, vector<shared_ptr<info<double>>>> fetcher::FetchFromAuxili
 		}
 		else
 		{
-			ret = FromFile<double>(files, opts, readPackedData, false);
+			// Search candidate messages from the message index of each grib file,
+			// and read only those. Other files are read as a whole.
+
+			vector<file_information> candidates;
+
+			for (const auto& file : files)
+			{
+				if (file.file_type == kGRIB || file.file_type == kGRIB1 || file.file_type == kGRIB2)
+				{
+					if (!boost::filesystem::exists(file.file_location))
+					{
+						itsLogger.Error("Input file '" + file.file_location + "' does not exist");
+						continue;
+					}
+
+					auto g = GET_PLUGIN(grib);
+					const auto found = g->Search(file, opts);
+
+					candidates.insert(candidates.end(), found.begin(), found.end());
+				}
+				else
+				{
+					candidates.push_back(file);
+				}
+			}
+
+			ret = FromFile<double>(candidates, opts, readPackedData, false);
 		}
 
 		if (!ret.empty())
@@ -839,13 +890,11 @@ bool fetcher::ApplyLandSeaMask(std::shared_ptr<const plugin_configuration> confi
 		ASSERT(itsLandSeaMaskThreshold >= -1 && itsLandSeaMaskThreshold <= 1);
 		ASSERT(itsLandSeaMaskThreshold != 0);
 
-#ifdef HAVE_CUDA
 		if (theInfo->PackedData()->HasData())
 		{
 			// We need to unpack
 			util::Unpack<T>({theInfo}, false);
 		}
-#endif
 
 		ASSERT(theInfo->PackedData()->HasData() == false);
 
@@ -988,7 +1037,8 @@ void fetcher::RotateVectorComponents(vector<shared_ptr<info<T>>>& components, co
 			std::vector<shared_ptr<info<T>>> list({other});
 			if (itsDoInterpolation && interpolate::Interpolate(target, list))
 			{
-				if (itsUseCache && config->UseCacheForReads() && !other->PackedData()->HasData())
+				if (itsUseCache && config->UseCacheForReads() &&
+				    (!other->PackedData()->HasData() || config->UsePackedCache()))
 				{
 					auto c = GET_PLUGIN(cache);
 					c->Insert<T>(other);
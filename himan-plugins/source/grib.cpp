@@ -9,11 +9,21 @@
 #include "producer.h"
 #include "reduced_gaussian_grid.h"
 #include "s3.h"
+#include "simple_packing.h"
 #include "stereographic_grid.h"
 #include "timer.h"
 #include "util.h"
 #include <algorithm>
+#include <atomic>
 #include <boost/filesystem.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
 
 using namespace std;
 using namespace himan::plugin;
@@ -155,15 +165,8 @@ long DetermineBitsPerValue(const vector<T>& values, double precision)
 
 	// define manual minmax search as std::minmax_element uses std::less
 	// for comparison which does not work well with nan
-	T min = himan::MissingValue<T>(), max = himan::MissingValue<T>();
-
-	for (const auto& v : values)
-	{
-		// man fmin:
-		// "If one argument is a NaN, the other argument is returned."
-		min = fmin(min, v);
-		max = fmax(max, v);
-	}
+	T min, max;
+	himan::simple_packing::MinMax(values.data(), values.size(), min, max);
 
 	// Required scale value to reach wanted precision
 	const T D = static_cast<T>(std::pow(10, precision));
@@ -999,7 +1002,7 @@ void grib::WriteForecastType(const forecast_type& forecastType, const producer&
 
 			try
 			{
-				const long ensembleSize = stol(r->RadonDB().GetProducerMetaData(prod.Id(), "ensemble size"));
+				const long ensembleSize = stol(r->ProducerMetaData(prod.Id(), "ensemble size"));
 				itsGrib->Message().SetLongKey("numberOfForecastsInEnsemble", ensembleSize);
 			}
 			catch (const invalid_argument& e)
@@ -1302,103 +1305,302 @@ himan::file_information grib::CreateGribMessage(info<T>& anInfo)
 template himan::file_information grib::CreateGribMessage<double>(info<double>&);
 template himan::file_information grib::CreateGribMessage<float>(info<float>&);
 
-void grib::DetermineMessageNumber(file_information& finfo)
+namespace
 {
-	// message length can only be received from eccodes since it includes
-	// all grib headers etc
-	finfo.length = itsGrib->Message().GetLongKey("totalLength");
+bool IsS3Location(const std::string& fileLocation)
+{
+	return fileLocation.find("s3://") != string::npos;
+}
+
+// Messages are appended to output file only if write mode allows several
+// messages per file and the file is not compressed
+
+bool AppendsToFile(const himan::configuration& conf)
+{
+	return ((conf.WriteMode() == himan::kAllGridsToAFile || conf.WriteMode() == himan::kFewGridsToAFile) &&
+	        conf.FileCompression() != himan::kGZIP && conf.FileCompression() != himan::kBZIP2);
+}
 
-	if (itsWriteOptions.configuration->WriteMode() == kSingleGridToAFile)
+void CreateParentDirectories(const std::string& fileLocation)
+{
+	namespace fs = boost::filesystem;
+	fs::path pathname(fileLocation);
+
+	if (!pathname.parent_path().empty() && !fs::is_directory(pathname.parent_path()))
 	{
-		finfo.offset = 0;
-		finfo.message_no = 0;
-		return;
+		fs::create_directories(pathname.parent_path());
 	}
+}
 
-	// appending to a file is a serial operation -- two threads cannot
-	// append to a single file simultaneously. therefore offset is just
-	// the size of the file so far.
+// Local file that grib messages are appended to. Each message reserves its
+// range of the file and its message number with a single atomic addition,
+// and is then written to that range with pwrite(). Concurrent writers do
+// not need to wait for each other, and the file is opened and examined only
+// once.
 
-	try
+class output_file
+{
+   public:
+	explicit output_file(const std::string& fileName) : itsFileName(fileName), itsFd(-1), itsNext(0), itsFailed(false)
 	{
-		finfo.offset = boost::filesystem::file_size(finfo.file_location);
+		CreateParentDirectories(fileName);
+
+		itsFd = open(fileName.c_str(), O_WRONLY | O_CREAT, 0666);
+
+		if (itsFd == -1)
+		{
+			throw std::runtime_error("Unable to open file '" + fileName + "': " + strerror(errno));
+		}
+
+		struct stat st;
+
+		if (fstat(itsFd, &st) == -1)
+		{
+			const int err = errno;
+			close(itsFd);
+			throw std::runtime_error("Unable to stat file '" + fileName + "': " + strerror(err));
+		}
+
+		uint64_t size = static_cast<uint64_t>(st.st_size), count = 0;
+
+		if (size > 0)
+		{
+			// file existed before Himan started --> count the messages from
+			// the existing file and start numbering from there
+
+			count = himan::file_accessor::Map(fileName, true)->Messages().size();
+		}
+
+		if (size > kOffsetMask || count > kCountMax)
+		{
+			close(itsFd);
+			throw std::runtime_error("File '" + fileName + "' is too large to append to");
+		}
+
+		itsNext = (count << kOffsetBits) | size;
 	}
-	catch (const boost::filesystem::filesystem_error& e)
+
+	~output_file()
 	{
-		finfo.offset = 0;
+		close(itsFd);
 	}
 
-	// handling message number is a bit tricker. fmigrib library cannot really
-	// be used for tracking message no of written messages, because neither it
-	// nor eccodes has any visibility to any ossibly existing messages in a file
-	// that is appended to. therefore here we are tracking the message count per
-	// file
+	output_file(const output_file&) = delete;
+	output_file& operator=(const output_file&) = delete;
 
-	static std::map<std::string, unsigned long> messages;
+	/**
+	 * @brief Reserve space for a message
+	 *
+	 * @return Offset and message number of the message
+	 */
 
-	try
+	std::pair<unsigned long, unsigned long> Reserve(unsigned long length)
 	{
-		messages.at(finfo.file_location) = messages.at(finfo.file_location) + 1;
+		if (itsFailed)
+		{
+			// Space of the failed message is a hole in the file: messages after it
+			// would have wrong message numbers
+			throw std::runtime_error("Earlier write to file '" + itsFileName + "' has failed, not appending to it");
+		}
+
+		if (length > kOffsetMask)
+		{
+			throw std::runtime_error("Message is too large to write to file '" + itsFileName + "'");
+		}
+
+		const uint64_t prev = itsNext.fetch_add((uint64_t(1) << kOffsetBits) + length);
+
+		const uint64_t offset = prev & kOffsetMask;
+		const uint64_t messageNo = prev >> kOffsetBits;
+
+		if (offset + length > kOffsetMask || messageNo >= kCountMax)
+		{
+			throw std::runtime_error("File '" + itsFileName + "' is too large to append to");
+		}
+
+		return std::make_pair(static_cast<unsigned long>(offset), static_cast<unsigned long>(messageNo));
 	}
-	catch (const out_of_range& e)
+
+	void Write(unsigned long offset, const unsigned char* data, size_t length) const
 	{
-		if (finfo.offset.get() == 0)
+		size_t written = 0;
+
+		while (written < length)
 		{
-			// offset is zero --> file does not exist yet --> start counting from msg 0
-			messages[finfo.file_location] = 0;
+			const ssize_t ret = pwrite(itsFd, data + written, length - written, offset + written);
+
+			if (ret == -1)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				itsFailed = true;
+				throw std::runtime_error("Unable to write to file '" + itsFileName + "': " + strerror(errno));
+			}
+
+			written += static_cast<size_t>(ret);
 		}
-		else
+	}
+
+   private:
+	// Offset of the next message is stored to the low 40 bits and the number
+	// of messages to the high 24 bits of the same counter
+
+	static const int kOffsetBits = 40;
+	static const uint64_t kOffsetMask = (uint64_t(1) << kOffsetBits) - 1;
+	static const uint64_t kCountMax = (uint64_t(1) << (64 - kOffsetBits)) - 1;
+
+	std::string itsFileName;
+	int itsFd;
+	std::atomic<uint64_t> itsNext;
+	mutable std::atomic<bool> itsFailed;
+};
+
+// Files that are appended to, and the plugins that are writing to each of them.
+// File is closed when all of its writers have finished.
+
+struct output_file_entry
+{
+	shared_ptr<output_file> file;
+	set<string> writers;
+};
+
+mutex outputFileMutex;
+unordered_map<string, output_file_entry> outputFiles;
+
+shared_ptr<output_file> OutputFile(const std::string& fileName, const std::string& writerName)
+{
+	lock_guard<mutex> lock(outputFileMutex);
+
+	auto& entry = outputFiles[fileName];
+
+	if (!entry.file)
+	{
+		try
 		{
-			// file existed before Himan started --> count the messages from
-			// the existing files and start numbering from there
+			entry.file = make_shared<output_file>(fileName);
+		}
+		catch (...)
+		{
+			outputFiles.erase(fileName);
+			throw;
+		}
+	}
+
+	entry.writers.insert(writerName);
+
+	return entry.file;
+}
+
+string WriterName(const himan::plugin_configuration& conf)
+{
+	return conf.Name() + "#" + to_string(conf.RelativeOrdinalNumber());
+}
+
+// Number of messages appended to each S3 object, protected by serializedWriteMutex
+
+map<string, unsigned long> s3MessageCounts;
+}  // namespace
+
+void grib::CloseFiles(const std::string& writerName)
+{
+	lock_guard<mutex> lock(outputFileMutex);
 
-			NFmiGrib rdr;
-			rdr.Open(finfo.file_location);
-			messages[finfo.file_location] = rdr.MessageCount();
+	for (auto it = outputFiles.begin(); it != outputFiles.end();)
+	{
+		it->second.writers.erase(writerName);
+
+		if (it->second.writers.empty())
+		{
+			// File descriptor is closed when the last write to the file returns
+			it = outputFiles.erase(it);
+		}
+		else
+		{
+			++it;
 		}
 	}
+}
+
+void grib::DetermineMessageNumber(file_information& finfo)
+{
+	// message length can only be received from eccodes since it includes
+	// all grib headers etc
+	finfo.length = itsGrib->Message().GetLongKey("totalLength");
+
+	if (!AppendsToFile(*itsWriteOptions.configuration))
+	{
+		finfo.offset = 0;
+		finfo.message_no = 0;
+		return;
+	}
 
-	finfo.message_no = messages.at(finfo.file_location);
+	if (IsS3Location(finfo.file_location))
+	{
+		// objects are always written from the beginning, so offset is the amount
+		// of data appended by this process
+		finfo.offset = s3::AppendedObjectSize(finfo.file_location);
+		finfo.message_no = s3MessageCounts[finfo.file_location]++;
+		return;
+	}
+
+	// fmigrib library cannot really be used for tracking message no of written
+	// messages, because neither it nor eccodes has any visibility to any possibly
+	// existing messages in a file that is appended to. therefore offset and
+	// message number are reserved from the output file
+
+	const auto reservation =
+	    OutputFile(finfo.file_location, WriterName(*itsWriteOptions.configuration))->Reserve(finfo.length.get());
+
+	finfo.offset = reservation.first;
+	finfo.message_no = reservation.second;
 }
 
 void grib::WriteMessageToFile(const file_information& finfo)
 {
 	timer aTimer(true);
-	bool appendToFile = (itsWriteOptions.configuration->WriteMode() == kAllGridsToAFile ||
-	                     itsWriteOptions.configuration->WriteMode() == kFewGridsToAFile);
+	const bool appendToFile = AppendsToFile(*itsWriteOptions.configuration);
 
-	if (appendToFile && (itsWriteOptions.configuration->FileCompression() == kGZIP ||
-	                     itsWriteOptions.configuration->FileCompression() == kBZIP2))
+	if (!appendToFile && itsWriteOptions.configuration->WriteMode() != kSingleGridToAFile)
 	{
 		itsLogger.Warning("Unable to write multiple grids to a packed file");
-		appendToFile = false;
 	}
 
-	if (finfo.file_location.find("s3://") != string::npos)
+	if (IsS3Location(finfo.file_location))
 	{
-		if (itsWriteOptions.configuration->WriteMode() != kSingleGridToAFile)
+		himan::buffer buff;
+		buff.length = finfo.length.get();
+		buff.data = static_cast<unsigned char*>(malloc(buff.length));
+		itsGrib->Message().GetMessage(buff.data, buff.length);
+
+		if (appendToFile)
 		{
-			itsLogger.Fatal("Write to S3 only supported with write_mode = single");
-			himan::Abort();
+			// message is uploaded in the background as a part of a multipart upload
+			s3::AppendToObject(finfo.file_location, buff, WriterName(*itsWriteOptions.configuration));
 		}
-
+		else
+		{
+			s3::WriteObject(finfo.file_location, buff);
+		}
+	}
+	else if (appendToFile)
+	{
 		himan::buffer buff;
 		buff.length = finfo.length.get();
 		buff.data = static_cast<unsigned char*>(malloc(buff.length));
 		itsGrib->Message().GetMessage(buff.data, buff.length);
-		s3::WriteObject(finfo.file_location, buff);
+
+		OutputFile(finfo.file_location, WriterName(*itsWriteOptions.configuration))
+		    ->Write(finfo.offset.get(), buff.data, buff.length);
+		file_accessor::Unmap(finfo.file_location);
 	}
 	else
 	{
-		namespace fs = boost::filesystem;
-		fs::path pathname(finfo.file_location);
-
-		if (!pathname.parent_path().empty() && !fs::is_directory(pathname.parent_path()))
-		{
-			fs::create_directories(pathname.parent_path());
-		}
-
-		itsGrib->Message().Write(finfo.file_location, appendToFile);
+		CreateParentDirectories(finfo.file_location);
+		itsGrib->Message().Write(finfo.file_location, false);
+		file_accessor::Unmap(finfo.file_location);
 	}
 
 	aTimer.Stop();
@@ -1429,8 +1631,9 @@ himan::file_information grib::ToFile(info<T>& anInfo)
 
 	auto finfo = CreateGribMessage<T>(anInfo);
 
-	if (itsWriteOptions.configuration->WriteMode() != kSingleGridToAFile)
+	if (IsS3Location(finfo.file_location) && itsWriteOptions.configuration->WriteMode() != kSingleGridToAFile)
 	{
+		// messages are appended to S3 objects in the order they are written
 		lock_guard<mutex> lock(serializedWriteMutex);
 		DetermineMessageNumber(finfo);
 		WriteMessageToFile(finfo);
@@ -2032,10 +2235,20 @@ himan::forecast_time grib::ReadTime() const
 	return t;
 }
 
-himan::level grib::ReadLevel(const search_options& opts, const producer& prod) const
+himan::level grib::ReadLevel(const search_options& opts, const producer& prod, bool abortOnError) const
 {
 	himan::HPLevelType levelType = kUnknownLevel;
 
+	auto Unsupported = [&](const string& msg) {
+		if (!abortOnError)
+		{
+			throw invalid_argument(msg);
+		}
+
+		itsLogger.Fatal(msg);
+		himan::Abort();
+	};
+
 	if (opts.configuration->DatabaseType() == kNoDatabase)
 	{
 		// Minimal set of levels for those who might try to run himan
@@ -2057,8 +2270,7 @@ himan::level grib::ReadLevel(const search_options& opts, const producer& prod) c
 				levelType = himan::kHybrid;
 				break;
 			default:
-				itsLogger.Fatal("Unsupported level type for no database mode: " + to_string(gribLevel));
-				himan::Abort();
+				Unsupported("Unsupported level type for no database mode: " + to_string(gribLevel));
 		}
 	}
 	else
@@ -2071,9 +2283,8 @@ himan::level grib::ReadLevel(const search_options& opts, const producer& prod) c
 
 		if (levelInfo.empty())
 		{
-			itsLogger.Fatal("Unsupported level type for producer " + to_string(prod.Id()) + ": " +
-			                to_string(gribLevel) + ", grib edition " + to_string(itsGrib->Message().Edition()));
-			himan::Abort();
+			Unsupported("Unsupported level type for producer " + to_string(prod.Id()) + ": " + to_string(gribLevel) +
+			            ", grib edition " + to_string(itsGrib->Message().Edition()));
 		}
 
 		string levelName = levelInfo["name"];
@@ -2094,7 +2305,14 @@ himan::level grib::ReadLevel(const search_options& opts, const producer& prod) c
 			}
 		}
 
-		levelType = HPStringToLevelType.at(levelName);
+		const auto it = HPStringToLevelType.find(levelName);
+
+		if (it == HPStringToLevelType.end())
+		{
+			Unsupported("Unsupported level name for producer " + to_string(prod.Id()) + ": " + levelName);
+		}
+
+		levelType = it->second;
 	}
 
 	himan::level l;
@@ -2230,6 +2448,136 @@ void ReadDataValues(vector<float>& values, NFmiGribMessage& msg)
 	delete[] arr;
 }
 
+himan::simple_packing::coefficients SimplePackingCoefficients(NFmiGribMessage& msg)
+{
+	himan::simple_packing::coefficients coeffs;
+	coeffs.bitsPerValue = static_cast<int>(msg.BitsPerValue());
+	coeffs.binaryScaleFactor = himan::util::ToPower(static_cast<double>(msg.BinaryScaleFactor()), 2);
+	coeffs.decimalScaleFactor = himan::util::ToPower(-static_cast<double>(msg.DecimalScaleFactor()), 10);
+	coeffs.referenceValue = msg.ReferenceValue();
+
+	return coeffs;
+}
+
+template <typename T>
+bool ReadSimplePackedValues(vector<T>& values, NFmiGribMessage& msg, const unsigned char* message,
+                            size_t messageLength)
+{
+	/*
+	 * Decode simple packing in himan instead of grib_api: values are decoded
+	 * directly to the data array without temporary arrays. If the message is
+	 * parsed in place from a memory buffer (mapped file or read buffer), packed
+	 * values are also decoded straight from that buffer. Returns false if
+	 * message cannot be decoded here and grib_api should be used instead.
+	 */
+
+	const int bpv = static_cast<int>(msg.BitsPerValue());
+
+	if (msg.PackingType() != "grid_simple" || !himan::simple_packing::IsSupported(bpv) ||
+	    msg.ValuesLength() != values.size())
+	{
+		return false;
+	}
+
+	const auto coeffs = SimplePackingCoefficients(msg);
+
+	vector<unsigned char> bitmap;
+
+	if (msg.Bitmap())
+	{
+		const size_t bitmapLength = msg.BytesLength("bitmap");
+
+		if (bitmapLength != values.size())
+		{
+			return false;
+		}
+
+		bitmap.resize((bitmapLength + 7) / 8);
+		msg.Bytes("bitmap", bitmap.data());
+	}
+
+	const size_t len = msg.PackedValuesLength();
+	const unsigned char* packedData = nullptr;
+	vector<unsigned char> packed;
+
+	if (message && len > 0)
+	{
+		const long offset = msg.GetLongKey("offsetBeforeData");
+
+		if (offset > 0 && static_cast<size_t>(offset) + len <= messageLength)
+		{
+			packedData = message + offset;
+		}
+	}
+
+	if (!packedData && len > 0)
+	{
+		packed.resize(len);
+		msg.PackedValues(packed.data());
+		packedData = packed.data();
+	}
+
+	himan::simple_packing::Unpack<T>(packedData, len, bitmap.empty() ? nullptr : bitmap.data(), values.data(),
+	                                 values.size(), coeffs);
+
+	return true;
+}
+
+#ifndef HAVE_CUDA
+template <typename T>
+bool ReadSimplePackedData(shared_ptr<himan::info<T>> newInfo, NFmiGribMessage& msg)
+{
+	/*
+	 * Store packed data as is to info, it is unpacked on CPU when data is
+	 * needed (util::Unpack). Data matrix is released, so the info only
+	 * takes as much memory as the packed message.
+	 */
+
+	auto& dm = newInfo->Data();
+
+	if (msg.PackingType() != "grid_simple" ||
+	    !himan::simple_packing::IsSupported(static_cast<int>(msg.BitsPerValue())) || msg.ValuesLength() != dm.Size())
+	{
+		return false;
+	}
+
+	const auto coeffs = SimplePackingCoefficients(msg);
+	auto packed = make_shared<himan::simple_packed>(coeffs.bitsPerValue, coeffs.binaryScaleFactor,
+	                                                coeffs.decimalScaleFactor, coeffs.referenceValue);
+
+	packed->unpackedLength = dm.Size();
+
+	if (msg.Bitmap())
+	{
+		const size_t bitmapLength = msg.BytesLength("bitmap");
+
+		if (bitmapLength != dm.Size())
+		{
+			return false;
+		}
+
+		packed->bitmap.resize((bitmapLength + 7) / 8);
+		msg.Bytes("bitmap", packed->bitmap.data());
+		packed->bitmapLength = bitmapLength;
+	}
+
+	const size_t len = msg.PackedValuesLength();
+
+	if (len > 0)
+	{
+		packed->data.resize(len);
+		msg.PackedValues(packed->data.data());
+		packed->packedLength = len;
+	}
+
+	auto b = newInfo->Base();
+	b->pdata = move(packed);
+	b->data = himan::matrix<T>(0, 0, 1, himan::MissingValue<T>());
+
+	return true;
+}
+#endif
+
 template <typename T>
 void grib::ReadData(shared_ptr<info<T>> newInfo, bool readPackedData) const
 {
@@ -2307,12 +2655,22 @@ void grib::ReadData(shared_ptr<info<T>> newInfo, bool readPackedData) const
 		b->pdata = move(packed);
 	}
 	else
+#elif !defined HAVE_CUDA
+	if (readPackedData && ReadSimplePackedData(newInfo, itsGrib->Message()))
+	{
+		itsLogger.Trace("Retrieved " + to_string(newInfo->PackedData()->packedLength) +
+		                " bytes of packed data from grib");
+	}
+	else
 #endif
 	{
-		dm.MissingValue(gribMissing);
-		ReadDataValues<T>(dm.Values(), itsGrib->Message());
+		if (ReadSimplePackedValues<T>(dm.Values(), itsGrib->Message(), itsMessageData, itsMessageLength) == false)
+		{
+			dm.MissingValue(gribMissing);
+			ReadDataValues<T>(dm.Values(), itsGrib->Message());
 
-		dm.MissingValue(MissingValue<T>());
+			dm.MissingValue(MissingValue<T>());
+		}
 
 		if (decodePrecipitationForm)
 		{
@@ -2496,6 +2854,24 @@ vector<shared_ptr<himan::info<double>>> grib::FromFile(const file_information& t
 	return FromFile<double>(theInputFile, options, readPackedData, readIfNotMatching);
 }
 
+namespace
+{
+// Uncompressed local files are memory mapped and messages are parsed directly
+// from the mapping
+
+bool IsMappable(const himan::file_information& finfo)
+{
+	if (finfo.storage_type != himan::kLocalFileSystem)
+	{
+		return false;
+	}
+
+	const string ext = boost::filesystem::path(finfo.file_location).extension().string();
+
+	return (ext != ".gz" && ext != ".bz2");
+}
+}  // namespace
+
 template <typename T>
 vector<shared_ptr<himan::info<T>>> grib::FromFile(const file_information& theInputFile, const search_options& options,
                                                   bool readPackedData, bool readIfNotMatching) const
@@ -2511,15 +2887,46 @@ vector<shared_ptr<himan::info<T>>> grib::FromFile(const file_information& theInp
 
 	timer aTimer(true);
 
-	if (readIfNotMatching || !theInputFile.offset)
+	const bool mapFile = IsMappable(theInputFile);
+
+	if ((readIfNotMatching || !theInputFile.offset) && mapFile)
 	{
-		// read all messages from local 'auxiliary' file
+		// read all messages from local 'auxiliary' file, using the message index
+		// of the memory mapped file
+
+		itsMappedFile = file_accessor::Map(theInputFile.file_location);
+
+		for (const auto& loc : itsMappedFile->Messages())
+		{
+			if (!itsGrib->ReadMessage(itsMappedFile->Data() + loc.offset, loc.length))
+			{
+				itsLogger.Error("Creating GRIB message from file '" + theInputFile.file_location + "' position " +
+				                to_string(loc.offset) + " failed");
+				continue;
+			}
+
+			itsMessageData = itsMappedFile->Data() + loc.offset;
+			itsMessageLength = loc.length;
+
+			auto newInfo = make_shared<info<T>>();
+			if (CreateInfoFromGrib(options, readPackedData, readIfNotMatching, newInfo) || readIfNotMatching)
+			{
+				infos.push_back(newInfo);
+				newInfo->First();
+			}
+		}
+	}
+	else if (readIfNotMatching || !theInputFile.offset)
+	{
+		// read all messages from compressed local 'auxiliary' file
 		if (!itsGrib->Open(theInputFile.file_location))
 		{
 			itsLogger.Error("Opening file '" + theInputFile.file_location + "' failed");
 			return infos;
 		}
 
+		itsMessageData = nullptr;
+
 		while (itsGrib->NextMessage())
 		{
 			auto newInfo = make_shared<info<T>>();
@@ -2532,15 +2939,51 @@ vector<shared_ptr<himan::info<T>>> grib::FromFile(const file_information& theInp
 	}
 	else
 	{
-		file_accessor fa;
-		const buffer buf = fa.Read(theInputFile);
+		// Local files are parsed directly from the mapping, other storage types
+		// are read to a buffer first
+
+		buffer buf;
+		unsigned char* data = nullptr;
+		unsigned long length = theInputFile.length.get();
+
+		if (mapFile)
+		{
+			itsMappedFile = file_accessor::Map(theInputFile.file_location);
+
+			if (theInputFile.offset.get() + length > itsMappedFile->Size())
+			{
+				// File may have grown after it was last checked
+				itsMappedFile = file_accessor::Map(theInputFile.file_location, true);
+			}
+
+			if (theInputFile.offset.get() + length > itsMappedFile->Size())
+			{
+				itsLogger.Error("Message at position " + to_string(theInputFile.offset.get()) + ":" +
+				                to_string(length) + " is outside of file '" + theInputFile.file_location + "'");
+				return infos;
+			}
+
+			data = itsMappedFile->Data() + theInputFile.offset.get();
+		}
+		else
+		{
+			const auto pconf = dynamic_pointer_cast<const plugin_configuration>(options.configuration);
 
-		if (!itsGrib->ReadMessage(buf.data, buf.length))
+			file_accessor fa;
+			buf = fa.Read(theInputFile, (pconf && pconf->StatisticsEnabled()) ? pconf->Statistics() : nullptr);
+			data = buf.data;
+			length = buf.length;
+		}
+
+		if (!itsGrib->ReadMessage(data, length))
 		{
 			itsLogger.Error("Creating GRIB message from memory failed");
 			return infos;
 		}
 
+		itsMessageData = data;
+		itsMessageLength = length;
+
 		auto newInfo = make_shared<info<T>>();
 
 		if (CreateInfoFromGrib(options, readPackedData, false, newInfo))
@@ -2550,6 +2993,10 @@ vector<shared_ptr<himan::info<T>>> grib::FromFile(const file_information& theInp
 		}
 	}
 
+	// Read buffer is released when this function returns
+	itsMessageData = nullptr;
+	itsMessageLength = 0;
+
 	aTimer.Stop();
 
 	const long duration = aTimer.GetTime();
@@ -2578,6 +3025,271 @@ template vector<shared_ptr<himan::info<double>>> grib::FromFile<double>(const fi
                                                                         bool, bool) const;
 template vector<shared_ptr<himan::info<float>>> grib::FromFile<float>(const file_information&, const search_options&,
                                                                       bool, bool) const;
+himan::unique_key grib::ReadMessageKey(const search_options& options) const
+{
+	// Producer is not part of the key: it is not used when checking if a
+	// message matches search options
+
+	const auto prod = ReadProducer(options);
+	const auto p = ReadParam(options, prod);
+	const auto t = ReadTime();
+	const auto l = ReadLevel(options, prod, false);
+
+	return unique_key(kHPMissingInt, t.OriginDateTime().ToEpoch(), t.ValidDateTime().ToEpoch(), p.Name(), l.Type(),
+	                  l.Value(), l.Value2(), static_cast<HPForecastType>(itsGrib->Message().ForecastType()),
+	                  static_cast<double>(itsGrib->Message().ForecastTypeValue()));
+}
+
+namespace
+{
+struct message_index_entry
+{
+	unsigned long offset;
+	unsigned long length;
+	unsigned long messageNo;
+};
+
+struct message_index
+{
+	message_index(size_t theFileSize, time_t theModificationTime)
+	    : fileSize(theFileSize), modificationTime(theModificationTime)
+	{
+	}
+
+	size_t fileSize;
+	time_t modificationTime;
+
+	once_flag createFlag;
+	unordered_multimap<himan::unique_key, message_index_entry> messages;
+};
+
+mutex messageIndexMutex;
+unordered_map<string, shared_ptr<message_index>> messageIndexes;
+
+const string kMessageIndexMagic = "himan_grib_index";
+const int kMessageIndexVersion = 1;
+
+// Index file is valid only for the same version of the file, and for the same
+// parameter naming
+
+string MessageIndexFingerprint(const message_index& index, const himan::search_options& options)
+{
+	const string paramFile = options.configuration->ParamFile();
+
+	return to_string(index.fileSize) + " " + to_string(index.modificationTime) + " " +
+	       to_string(static_cast<int>(options.configuration->DatabaseType())) + " " +
+	       (paramFile.empty() ? "-" : paramFile);
+}
+
+string MessageIndexFileName(const string& fileName)
+{
+	return fileName + ".himan_idx";
+}
+
+bool ReadMessageIndex(const string& fileName, const himan::search_options& options, message_index& index)
+{
+	ifstream in(MessageIndexFileName(fileName));
+
+	if (!in)
+	{
+		return false;
+	}
+
+	string magic, fingerprint;
+	int version;
+
+	in >> magic >> version;
+	in.ignore(1);
+	getline(in, fingerprint);
+
+	if (!in || magic != kMessageIndexMagic || version != kMessageIndexVersion ||
+	    fingerprint != MessageIndexFingerprint(index, options))
+	{
+		return false;
+	}
+
+	unordered_multimap<himan::unique_key, message_index_entry> messages;
+
+	message_index_entry entry;
+	time_t origin, valid;
+	string paramName;
+	int levelType, forecastType;
+
+	// Doubles are read as strings, because stream extraction does not accept
+	// nan as a value
+
+	string levelValue, levelValue2, forecastTypeValue;
+
+	while (in >> entry.offset >> entry.length >> entry.messageNo >> origin >> valid >> paramName >> levelType >>
+	       levelValue >> levelValue2 >> forecastType >> forecastTypeValue)
+	{
+		if (entry.offset + entry.length > index.fileSize)
+		{
+			return false;
+		}
+
+		try
+		{
+			messages.emplace(himan::unique_key(himan::kHPMissingInt, origin, valid, paramName,
+			                                   static_cast<himan::HPLevelType>(levelType), stod(levelValue),
+			                                   stod(levelValue2), static_cast<himan::HPForecastType>(forecastType),
+			                                   stod(forecastTypeValue)),
+			                 entry);
+		}
+		catch (const exception& e)
+		{
+			return false;
+		}
+	}
+
+	if (!in.eof())
+	{
+		return false;
+	}
+
+	index.messages = move(messages);
+	return true;
+}
+
+void WriteMessageIndex(const string& fileName, const himan::search_options& options,
+                       const vector<pair<himan::unique_key, message_index_entry>>& entries, const message_index& index)
+{
+	himan::logger log("grib");
+
+	const string indexFileName = MessageIndexFileName(fileName);
+
+	const bool written = himan::util::WriteFileAtomically(indexFileName, [&](ostream& out) {
+		out << kMessageIndexMagic << " " << kMessageIndexVersion << "\n"
+		    << MessageIndexFingerprint(index, options) << "\n";
+		out.precision(17);
+
+		for (const auto& e : entries)
+		{
+			const auto& key = e.first;
+			const auto& entry = e.second;
+
+			out << entry.offset << " " << entry.length << " " << entry.messageNo << " " << key.OriginTime() << " "
+			    << key.ValidTime() << " " << key.ParamName() << " " << static_cast<int>(key.LevelType()) << " "
+			    << key.LevelValue() << " " << key.LevelValue2() << " " << static_cast<int>(key.ForecastType())
+			    << " " << key.ForecastTypeValue() << "\n";
+		}
+	});
+
+	if (!written)
+	{
+		log.Warning("Unable to write message index file " + indexFileName);
+		return;
+	}
+
+	log.Debug("Wrote message index to " + indexFileName);
+}
+}  // namespace
+
+vector<himan::file_information> grib::Search(const file_information& theInputFile,
+                                             const search_options& options) const
+{
+	if (!IsMappable(theInputFile))
+	{
+		return {theInputFile};
+	}
+
+	itsMappedFile = file_accessor::Map(theInputFile.file_location);
+
+	shared_ptr<message_index> index;
+
+	{
+		lock_guard<mutex> lock(messageIndexMutex);
+
+		auto& cur = messageIndexes[theInputFile.file_location];
+
+		if (!cur || cur->fileSize != itsMappedFile->Size() ||
+		    cur->modificationTime != itsMappedFile->ModificationTime())
+		{
+			cur = make_shared<message_index>(itsMappedFile->Size(), itsMappedFile->ModificationTime());
+		}
+
+		index = cur;
+	}
+
+	call_once(index->createFlag, [&]() {
+		const bool store = options.configuration->StoreAuxiliaryFileIndex();
+
+		if (store && ReadMessageIndex(theInputFile.file_location, options, *index))
+		{
+			itsLogger.Debug("Read message index of file '" + theInputFile.file_location + "'");
+			return;
+		}
+
+		timer aTimer(true);
+
+		const auto& locations = itsMappedFile->Messages();
+
+		vector<pair<unique_key, message_index_entry>> entries;
+		entries.reserve(locations.size());
+
+		for (size_t i = 0; i < locations.size(); i++)
+		{
+			const auto& loc = locations[i];
+
+			if (!itsGrib->ReadMessage(itsMappedFile->Data() + loc.offset, loc.length))
+			{
+				itsLogger.Error("Creating GRIB message from file '" + theInputFile.file_location + "' position " +
+				                to_string(loc.offset) + " failed");
+				continue;
+			}
+
+			try
+			{
+				entries.emplace_back(ReadMessageKey(options), message_index_entry{loc.offset, loc.length, i});
+			}
+			catch (const invalid_argument& e)
+			{
+				// Message can not be requested with a level that himan does not
+				// know, so it is left out of the index
+				itsLogger.Debug("Message at position " + to_string(loc.offset) + " of file '" +
+				                theInputFile.file_location + "' is not indexed: " + e.what());
+			}
+		}
+
+		index->messages.insert(entries.begin(), entries.end());
+
+		aTimer.Stop();
+
+		itsLogger.Debug("Created message index of file '" + theInputFile.file_location + "' with " +
+		                to_string(entries.size()) + " messages in " + to_string(aTimer.GetTime()) + " ms");
+
+		if (store)
+		{
+			WriteMessageIndex(theInputFile.file_location, options, entries, *index);
+		}
+	});
+
+	const unique_key key(kHPMissingInt, options.time.OriginDateTime().ToEpoch(),
+	                     options.time.ValidDateTime().ToEpoch(), options.param.Name(), options.level.Type(),
+	                     options.level.Value(), options.level.Value2(), options.ftype.Type(), options.ftype.Value());
+
+	vector<file_information> ret;
+
+	const auto range = index->messages.equal_range(key);
+
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		file_information finfo = theInputFile;
+		finfo.offset = it->second.offset;
+		finfo.length = it->second.length;
+		finfo.message_no = it->second.messageNo;
+
+		ret.push_back(finfo);
+	}
+
+	// Keep the order of messages in file, so that first match wins as before
+
+	sort(ret.begin(), ret.end(),
+	     [](const file_information& a, const file_information& b) { return a.offset.get() < b.offset.get(); });
+
+	return ret;
+}
+
 void grib::UnpackBitmap(const unsigned char* __restrict__ bitmap, int* __restrict__ unpacked, size_t len,
                         size_t unpackedLen) const
 {
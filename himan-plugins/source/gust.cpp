@@ -95,6 +95,18 @@ void gust::Process(std::shared_ptr<const plugin_configuration> conf)
 
 	SetParams({theRequestedParam});
 
+	// Inputs that are read from fixed levels of the calculated time. Cloud
+	// cover parameters have alternative names and the temperature profile is
+	// read level by level, so they are not prefetched.
+
+	const bool groundLevel =
+	    (itsConfiguration->TargetProducer().Id() == 240 || itsConfiguration->TargetProducer().Id() == 243);
+	const level H0 = groundLevel ? level(kGround, 0) : level(kHeight, 0);
+	const level H10 = groundLevel ? H0 : level(kHeight, 10);
+
+	Prefetch({prefetch_input(param("FFG-MS"), H10), prefetch_input(param("MIXHGT-M"), H0),
+	          prefetch_input(param("Z-M2S2"), H0)});
+
 	Start();
 }
 
@@ -142,66 +142,72 @@ pair<level, level> hitool::LevelForHeight(const producer& prod, double height) c
 			break;
 	}
 
-	stringstream query;
-
-	if (itsHeightUnit == kM)
-	{
-		query << "SELECT min(CASE WHEN maximum_height <= " << height
-		      << " THEN level_value ELSE NULL END) AS lowest_level, "
-		      << "max(CASE WHEN minimum_height >= " << height << " THEN level_value ELSE NULL END) AS highest_level "
-		      << "FROM "
-		      << "hybrid_level_height "
-		      << "WHERE "
-		      << "producer_id = " << producerId;
-	}
-	else if (itsHeightUnit == kHPa)
-	{
-		// Add/subtract 1 already in the query, since due to the composition of the query it will return
-		// the first level that is higher than lower height and vice versa
-
-		query << "SELECT max(CASE WHEN minimum_pressure <= " << height
-		      << " THEN level_value+1 ELSE NULL END) AS lowest_level, "
-		      << "min(CASE WHEN maximum_pressure >= " << height
-		      << " THEN level_value-1 ELSE NULL END) AS highest_level "
-		      << "FROM "
-		      << "hybrid_level_height "
-		      << "WHERE "
-		      << "producer_id = " << producerId;
-		;
-	}
-
 	HPDatabaseType dbtype = itsConfiguration->DatabaseType();
 
-	vector<string> row;
-
 	long absolutelowest = kHPMissingInt, absolutehighest = kHPMissingInt;
+	long lowest = kHPMissingInt, highest = kHPMissingInt;
 
 	if (dbtype == kRadon)
 	{
+		// Hybrid level heights and producer metadata are cached by radon plugin,
+		// so that database is not queried again on every call
+
 		auto r = GET_PLUGIN(radon);
-		r->RadonDB().Query(query.str());
 
-		row = r->RadonDB().FetchRow();
+		for (const auto& lh : r->HybridLevelHeights(producerId))
+		{
+			if (itsHeightUnit == kM)
+			{
+				if (!IsMissing(lh.maximum_height) && lh.maximum_height <= height &&
+				    (lowest == kHPMissingInt || lh.level_value < lowest))
+				{
+					lowest = lh.level_value;
+				}
 
-		absolutelowest = stol(r->RadonDB().GetProducerMetaData(prod.Id(), "last hybrid level number"));
-		absolutehighest = stol(r->RadonDB().GetProducerMetaData(prod.Id(), "first hybrid level number"));
+				if (!IsMissing(lh.minimum_height) && lh.minimum_height >= height &&
+				    (highest == kHPMissingInt || lh.level_value > highest))
+				{
+					highest = lh.level_value;
+				}
+			}
+			else if (itsHeightUnit == kHPa)
+			{
+				// Add/subtract 1 already here, since it will return the first level that
+				// is higher than lower height and vice versa
+
+				if (!IsMissing(lh.minimum_pressure) && lh.minimum_pressure <= height &&
+				    (lowest == kHPMissingInt || lh.level_value + 1 > lowest))
+				{
+					lowest = lh.level_value + 1;
+				}
+
+				if (!IsMissing(lh.maximum_pressure) && lh.maximum_pressure >= height &&
+				    (highest == kHPMissingInt || lh.level_value - 1 < highest))
+				{
+					highest = lh.level_value - 1;
+				}
+			}
+		}
+
+		absolutelowest = stol(r->ProducerMetaData(prod.Id(), "last hybrid level number"));
+		absolutehighest = stol(r->ProducerMetaData(prod.Id(), "first hybrid level number"));
 	}
 
 	long newlowest = absolutelowest, newhighest = absolutehighest;
 
-	if (!row.empty())
+	if (dbtype == kRadon)
 	{
 		// If requested height is below lowest level (f.ex. 0 meters) or above highest (f.ex. 80km)
-		// database query will return null
+		// no level is found
 
-		if (row[0] != "")
+		if (lowest != kHPMissingInt)
 		{
-			// SQL query returns the level value that precedes the requested value.
+			// Search returns the level value that precedes the requested value.
 			// For first hybrid level (the highest ie max), get one level above the max level if possible
 			// For last hybrid level (the lowest ie min), get one level below the min level if possible
 			// This means that we have a buffer of three levels for both directions!
 
-			newlowest = stol(row[0]) + 1;
+			newlowest = lowest + 1;
 
 			if (newlowest > absolutelowest)
 			{
@@ -209,9 +215,9 @@ pair<level, level> hitool::LevelForHeight(const producer& prod, double height) c
 			}
 		}
 
-		if (row[1] != "")
+		if (highest != kHPMissingInt)
 		{
-			newhighest = stol(row[1]) - 1;
+			newhighest = highest - 1;
 
 			if (newhighest < absolutehighest)
 			{
@@ -230,26 +236,31 @@ pair<level, level> hitool::LevelForHeight(const producer& prod, double height) c
 	return make_pair(level(kHybrid, static_cast<double>(newlowest)), level(kHybrid, static_cast<double>(newhighest)));
 }
 
-template <typename T>
-vector<T> hitool::VerticalExtremeValue(shared_ptr<modifier> mod, HPLevelType wantedLevelType, const param& wantedParam,
-                                       const vector<T>& lowerHeight, const vector<T>& upperHeight,
-                                       const vector<T>& findValue) const
+namespace
 {
-	ASSERT(wantedLevelType == kHybrid);
+// Only these modifiers search for given values, for others find values would
+// just mark the grid points with missing find value as out of bounds
 
-	mod->FindValue(util::Convert<T, double>(findValue));
-	mod->LowerHeight(util::Convert<T, double>(lowerHeight));
-	mod->UpperHeight(util::Convert<T, double>(upperHeight));
-
-	if (itsHeightUnit == kHPa)
+bool UsesFindValue(HPModifierType modifierType)
+{
+	switch (modifierType)
 	{
-		mod->HeightInMeters(false);
+		case kCountModifier:
+		case kFindHeightModifier:
+		case kFindHeightGreaterThanModifier:
+		case kFindHeightLessThanModifier:
+		case kFindValueModifier:
+			return true;
+		default:
+			return false;
 	}
+}
+}  // namespace
 
-	// Should we loop over all producers ?
-
-	producer prod = itsConfiguration->SourceProducer(0);
-
+template <typename T>
+pair<long, long> hitool::LevelRange(HPModifierType modifierType, const producer& prod, const vector<T>& lowerHeight,
+                                    const vector<T>& upperHeight, const vector<T>& findValue) const
+{
 	// first means first in sorted order, ie smallest number ie the highest level
 
 	HPDatabaseType dbtype = itsConfiguration->DatabaseType();
@@ -262,8 +273,8 @@ vector<T> hitool::VerticalExtremeValue(shared_ptr<modifier> mod, HPLevelType wan
 
 		try
 		{
-			highestHybridLevel = stol(r->RadonDB().GetProducerMetaData(prod.Id(), "first hybrid level number"));
-			lowestHybridLevel = stol(r->RadonDB().GetProducerMetaData(prod.Id(), "last hybrid level number"));
+			highestHybridLevel = stol(r->ProducerMetaData(prod.Id(), "first hybrid level number"));
+			lowestHybridLevel = stol(r->ProducerMetaData(prod.Id(), "last hybrid level number"));
 		}
 		catch (const invalid_argument& e)
 		{
@@ -276,7 +287,7 @@ vector<T> hitool::VerticalExtremeValue(shared_ptr<modifier> mod, HPLevelType wan
 
 	string heightUnit = (itsHeightUnit == kM) ? "meters" : "hectopascal";
 
-	switch (mod->Type())
+	switch (modifierType)
 	{
 		case kAverageModifier:
 		case kMinimumModifier:
@@ -368,42 +379,157 @@ vector<T> hitool::VerticalExtremeValue(shared_ptr<modifier> mod, HPLevelType wan
 			break;
 	}
 
-	for (long levelValue = lowestHybridLevel; levelValue >= highestHybridLevel && !mod->CalculationFinished();
-	     levelValue--)
+	return make_pair(lowestHybridLevel, highestHybridLevel);
+}
+
+template <typename T>
+vector<vector<T>> hitool::VerticalExtremeValues(const vector<shared_ptr<modifier>>& mods, HPLevelType wantedLevelType,
+                                                const param& wantedParam, const vector<T>& lowerHeight,
+                                                const vector<T>& upperHeight, const vector<T>& findValue) const
+{
+	ASSERT(wantedLevelType == kHybrid);
+	ASSERT(!mods.empty());
+
+	// Should we loop over all producers ?
+
+	producer prod = itsConfiguration->SourceProducer(0);
+
+	// Level range of each modifier, and the range that covers all of them
+
+	vector<pair<long, long>> levelRanges;
+	levelRanges.reserve(mods.size());
+
+	long highestHybridLevel = kHPMissingInt, lowestHybridLevel = kHPMissingInt;
+
+	for (const auto& mod : mods)
+	{
+		if (UsesFindValue(mod->Type()))
+		{
+			if (findValue.empty())
+			{
+				itsLogger.Error(HPModifierTypeToString.at(mod->Type()) + " needs values to search for");
+				throw runtime_error("hitool: Unable to proceed");
+			}
+
+			mod->FindValue(util::Convert<T, double>(findValue));
+		}
+
+		mod->LowerHeight(util::Convert<T, double>(lowerHeight));
+		mod->UpperHeight(util::Convert<T, double>(upperHeight));
+
+		if (itsHeightUnit == kHPa)
+		{
+			mod->HeightInMeters(false);
+		}
+
+		const auto levelRange = LevelRange<T>(mod->Type(), prod, lowerHeight, upperHeight, findValue);
+
+		if (lowestHybridLevel == kHPMissingInt || levelRange.first > lowestHybridLevel)
+		{
+			lowestHybridLevel = levelRange.first;
+		}
+
+		if (highestHybridLevel == kHPMissingInt || levelRange.second < highestHybridLevel)
+		{
+			highestHybridLevel = levelRange.second;
+		}
+
+		levelRanges.push_back(levelRange);
+	}
+
+	if (mods.size() > 1)
+	{
+		itsLogger.Debug("Processing " + to_string(mods.size()) + " modifiers in level range " +
+		                to_string(lowestHybridLevel) + " .. " + to_string(highestHybridLevel));
+	}
+
+	auto AllFinished = [&mods]() {
+		return all_of(mods.begin(), mods.end(),
+		              [](const shared_ptr<modifier>& mod) { return mod->CalculationFinished(); });
+	};
+
+	for (long levelValue = lowestHybridLevel; levelValue >= highestHybridLevel && !AllFinished(); levelValue--)
 	{
 		level currentLevel(kHybrid, static_cast<double>(levelValue), "HYBRID");
 
-		auto data = GetData<double>(currentLevel, wantedParam, itsTime, itsForecastType);
+		// Data is fetched when the first modifier needs it, and the same grids
+		// are then given to all other modifiers
+
+		shared_ptr<info<double>> values, heights;
+
+		for (size_t i = 0; i < mods.size(); i++)
+		{
+			const auto& mod = mods[i];
+
+			if (levelValue > levelRanges[i].first || levelValue < levelRanges[i].second || mod->CalculationFinished())
+			{
+				continue;
+			}
 
-		auto values = data.first;
-		auto heights = data.second;
+			if (!values)
+			{
+				auto data = GetData<double>(currentLevel, wantedParam, itsTime, itsForecastType);
+
+				values = data.first;
+				heights = data.second;
 
-		ASSERT(heights->Grid()->Size() == values->Grid()->Size());
+				ASSERT(heights->Grid()->Size() == values->Grid()->Size());
 
-		values->First();
-		heights->First();
+				values->First();
+				heights->First();
+			}
 
-		mod->Process(values->Data().Values(), heights->Data().Values());
+			mod->Process(values->Data().Values(), heights->Data().Values());
 
 #ifdef DEBUG
-		size_t heightsCrossed = mod->HeightsCrossed();
+			size_t heightsCrossed = mod->HeightsCrossed();
+
+			string msg = "Level " + to_string(currentLevel.Value()) + ": height range crossed for " +
+			             to_string(heightsCrossed) + "/" + to_string(values->Data().Size()) + " grid points";
 
-		string msg = "Level " + to_string(currentLevel.Value()) + ": height range crossed for " +
-		             to_string(heightsCrossed) + "/" + to_string(values->Data().Size()) + " grid points";
+			if (mods.size() > 1)
+			{
+				msg += " (" + HPModifierTypeToString.at(mod->Type()) + ")";
+			}
 
-		itsLogger.Debug(msg);
+			itsLogger.Debug(msg);
 #endif
+		}
 	}
 
-	auto ret = mod->Result();
+	vector<vector<T>> ret;
+	ret.reserve(mods.size());
 
-	if (mod->HeightsCrossed() < itsConfiguration->BaseGrid()->Size())
+	for (const auto& mod : mods)
 	{
-		itsLogger.Warning(to_string(ret.size() - mod->HeightsCrossed()) +
-		                  " grid points did not reach upper height limit. Did I run out of vertical levels?");
+		const auto& result = mod->Result();
+
+		if (mod->HeightsCrossed() < itsConfiguration->BaseGrid()->Size())
+		{
+			itsLogger.Warning(to_string(result.size() - mod->HeightsCrossed()) +
+			                  " grid points did not reach upper height limit. Did I run out of vertical levels?");
+		}
+
+		ret.push_back(util::Convert<double, T>(result));
 	}
 
-	return util::Convert<double, T>(ret);
+	return ret;
+}
+
+template vector<vector<double>> hitool::VerticalExtremeValues<double>(const vector<shared_ptr<modifier>>&,
+                                                                      HPLevelType, const param&,
+                                                                      const vector<double>&, const vector<double>&,
+                                                                      const vector<double>&) const;
+template vector<vector<float>> hitool::VerticalExtremeValues<float>(const vector<shared_ptr<modifier>>&,
+                                                                    HPLevelType, const param&, const vector<float>&,
+                                                                    const vector<float>&, const vector<float>&) const;
+
+template <typename T>
+vector<T> hitool::VerticalExtremeValue(shared_ptr<modifier> mod, HPLevelType wantedLevelType, const param& wantedParam,
+                                       const vector<T>& lowerHeight, const vector<T>& upperHeight,
+                                       const vector<T>& findValue) const
+{
+	return VerticalExtremeValues<T>({mod}, wantedLevelType, wantedParam, lowerHeight, upperHeight, findValue)[0];
 }
 
 template vector<double> hitool::VerticalExtremeValue<double>(shared_ptr<modifier>, HPLevelType, const param&,
@@ -1415,6 +1541,51 @@ vector<T> hitool::PlusMinusArea(const param& wantedParam, const vector<T>& first
 template vector<double> hitool::PlusMinusArea<double>(const param&, const vector<double>&, const vector<double>&) const;
 template vector<float> hitool::PlusMinusArea<float>(const param&, const vector<float>&, const vector<float>&) const;
 
+template <typename T>
+vector<vector<T>> hitool::VerticalStatistics(const param& wantedParam, T lowerHeight, T upperHeight,
+                                             const vector<HPModifierType>& modifierTypes,
+                                             const vector<T>& findValue) const
+{
+	vector<T> firstLevelValue(itsConfiguration->BaseGrid()->Size(), lowerHeight);
+	vector<T> lastLevelValue(itsConfiguration->BaseGrid()->Size(), upperHeight);
+
+	return VerticalStatistics<T>(wantedParam, firstLevelValue, lastLevelValue, modifierTypes, findValue);
+}
+
+template vector<vector<double>> hitool::VerticalStatistics<double>(const param&, double, double,
+                                                                   const vector<HPModifierType>&,
+                                                                   const vector<double>&) const;
+template vector<vector<float>> hitool::VerticalStatistics<float>(const param&, float, float,
+                                                                 const vector<HPModifierType>&,
+                                                                 const vector<float>&) const;
+
+template <typename T>
+vector<vector<T>> hitool::VerticalStatistics(const param& wantedParam, const vector<T>& firstLevelValue,
+                                             const vector<T>& lastLevelValue,
+                                             const vector<HPModifierType>& modifierTypes,
+                                             const vector<T>& findValue) const
+{
+	ASSERT(!modifierTypes.empty());
+
+	vector<shared_ptr<modifier>> mods;
+	mods.reserve(modifierTypes.size());
+
+	for (const auto modifierType : modifierTypes)
+	{
+		mods.push_back(CreateModifier(modifierType));
+	}
+
+	return VerticalExtremeValues<T>(mods, kHybrid, wantedParam, firstLevelValue, lastLevelValue, findValue);
+}
+
+template vector<vector<double>> hitool::VerticalStatistics<double>(const param&, const vector<double>&,
+                                                                   const vector<double>&,
+                                                                   const vector<HPModifierType>&,
+                                                                   const vector<double>&) const;
+template vector<vector<float>> hitool::VerticalStatistics<float>(const param&, const vector<float>&,
+                                                                 const vector<float>&, const vector<HPModifierType>&,
+                                                                 const vector<float>&) const;
+
 void hitool::Time(const forecast_time& theTime)
 {
 	itsTime = theTime;
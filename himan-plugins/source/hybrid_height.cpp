@@ -47,6 +47,26 @@ void hybrid_height::Process(std::shared_ptr<const plugin_configuration> conf)
 
 	SetParams({param(HParam)});
 
+	if (itsUseGeopotential)
+	{
+		Prefetch({prefetch_input(ZParam), prefetch_input(ZParam, level(kHeight, 0))});
+	}
+	else
+	{
+		// A thread calculates all levels of a time, reading pressure and
+		// temperature of each
+
+		vector<prefetch_input> inputs;
+
+		for (const auto& lvl : itsConfiguration->Levels())
+		{
+			inputs.push_back(prefetch_input(PParam, lvl));
+			inputs.push_back(prefetch_input(TParam, lvl));
+		}
+
+		Prefetch(inputs);
+	}
+
 	Start<float>();
 }
 
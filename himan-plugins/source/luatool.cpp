@@ -6,6 +6,7 @@
 #include "latitude_longitude_grid.h"
 #include "lift.h"
 #include "logger.h"
+#include "luatool_array.h"
 #include "metutil.h"
 #include "numerical_functions.h"
 #include "plugin_factory.h"
@@ -13,12 +14,16 @@
 #include "statistics.h"
 #include "stereographic_grid.h"
 #include <boost/filesystem.hpp>
+#include <map>
 #include <thread>
 
 #ifndef __clang_analyzer__
 
 extern "C" {
 #include <lualib.h>
+#ifdef HAVE_LUAJIT
+#include <luajit.h>
+#endif
 }
 
 #include <luabind/adopt_policy.hpp>
@@ -37,6 +42,7 @@ void BindEnum(lua_State* L);
 int BindErrorHandler(lua_State* L);
 void BindPlugins(lua_State* L);
 void BindLib(lua_State* L);
+void BindArrayIndexing(lua_State* L);
 
 template <typename T>
 object VectorToTable(const std::vector<T>& vec);
@@ -46,14 +52,80 @@ std::vector<T> TableToVector(const object& table);
 
 namespace
 {
-thread_local lua_State* myL;
+// Lua state of a worker thread. State is created when the thread runs
+// luatool for the first time, and it is reused for all following times,
+// levels and scripts, so that standard libraries and bindings are registered
+// only once per thread.
+
+struct lua_vm
+{
+	lua_State* L = nullptr;
+
+	// Compiled scripts, as references to lua registry
+	std::map<std::string, int> chunks;
+
+	~lua_vm()
+	{
+		if (L)
+		{
+			lua_close(L);
+		}
+	}
+};
+
+thread_local lua_vm myVM;
 bool myUseCuda;
+
+// Name of the lua implementation this luatool is built with; configuration
+// option 'lua_engine' can require a specific one
+
+#ifdef HAVE_LUAJIT
+const std::string kLuaEngine = "luajit";
+const std::string kLuaEngineVersion = LUAJIT_VERSION;
+#else
+const std::string kLuaEngine = "lua";
+const std::string kLuaEngineVersion = LUA_RELEASE;
+#endif
+
+// Create a table for the global variables of one calculation. Variables that
+// scripts define end up in this table and disappear when the calculation is
+// finished; libraries and bindings are found from the real globals table.
+// _G refers to the new table, so that assignments through it are not kept
+// either.
+
+object NewEnvironment(lua_State* L)
+{
+	object env = newtable(L);
+	object meta = newtable(L);
+
+	meta["__index"] = globals(L);
+	setmetatable(env, meta);
+
+	env["_G"] = env;
+
+	return env;
 }
 
+// Set the table on top of the stack as the environment of function at
+// given index, and pop the table
+
+void SetEnvironment(lua_State* L, int funcIndex)
+{
+#if LUA_VERSION_NUM >= 502
+	// First upvalue of a main chunk is _ENV
+	if (lua_setupvalue(L, funcIndex, 1) == nullptr)
+	{
+		lua_pop(L, 1);
+	}
+#else
+	lua_setfenv(L, funcIndex);
+#endif
+}
+}  // namespace
+
 luatool::luatool() : itsWriteOptions()
 {
 	itsLogger = logger("luatool");
-	myL = 0;
 }
 
 luatool::~luatool()
@@ -63,6 +135,17 @@ void luatool::Process(std::shared_ptr<const plugin_configuration> conf)
 {
 	Init(conf);
 
+	const std::string engine = itsConfiguration->GetValue("lua_engine");
+
+	if (!engine.empty() && engine != kLuaEngine)
+	{
+		itsLogger.Fatal("Configuration requires lua engine '" + engine + "', but luatool is built with '" + kLuaEngine +
+		                "'. Check HIMAN_LIBRARY_PATH");
+		himan::Abort();
+	}
+
+	itsLogger.Debug("Lua engine is " + kLuaEngineVersion);
+
 	SetParams({param("DUMMY")});
 
 	if (!itsConfiguration->GetValue("ThreadDistribution").empty())
@@ -108,31 +191,46 @@ void luatool::Calculate(std::shared_ptr<info<double>> myTargetInfo, unsigned sho
 
 	InitLua();
 
-	ASSERT(myL);
+	ASSERT(myVM.L);
 	myThreadedLogger.Info("Calculating time " + static_cast<std::string>(myTargetInfo->Time().ValidDateTime()) +
 	                      " level " + static_cast<std::string>(myTargetInfo->Level()));
 
-	globals(myL)["logger"] = myThreadedLogger;
-
-	for (const std::string& luaFile : itsConfiguration->GetValueList("luafile"))
 	{
-		if (luaFile.empty())
+		// All scripts of this time and level share the same globals, like they
+		// would if they were run in a state of their own
+
+		object env = NewEnvironment(myVM.L);
+
+		env["logger"] = myThreadedLogger;
+
+		for (const std::string& luaFile : itsConfiguration->GetValueList("luafile"))
 		{
-			continue;
-		}
+			if (luaFile.empty())
+			{
+				continue;
+			}
 
-		myThreadedLogger.Info("Starting script " + luaFile);
+			myThreadedLogger.Info("Starting script " + luaFile);
 
-		ResetVariables(myTargetInfo);
-		ReadFile(luaFile);
+			ResetVariables(env, myTargetInfo);
+			ReadFile(luaFile, env);
+		}
 	}
 
-	lua_close(myL);
-	myL = 0;
+	// Release the data that the scripts referenced now, instead of keeping it
+	// until the next calculation of this thread
+
+	lua_settop(myVM.L, 0);
+	lua_gc(myVM.L, LUA_GCCOLLECT, 0);
 }
 
 void luatool::InitLua()
 {
+	if (myVM.L)
+	{
+		return;
+	}
+
 	lua_State* L = luaL_newstate();
 
 	ASSERT(L);
@@ -145,32 +243,31 @@ void luatool::InitLua()
 
 	BindEnum(L);
 	BindLib(L);
+	BindArrayIndexing(L);
 	BindPlugins(L);
 
-	myL = L;
+	myVM.L = L;
 }
 
-void luatool::ResetVariables(info_t myTargetInfo)
+void luatool::ResetVariables(object& env, info_t myTargetInfo)
 {
 	// Set some variable that are needed in luatool calculations
 	// but are too hard or complicated to create in the lua side
 
-	const auto L = myL;
-
-	globals(L)["luatool"] = boost::ref(*this);
-	globals(L)["result"] = myTargetInfo;
-	globals(L)["configuration"] = itsConfiguration;
-	globals(L)["write_options"] = boost::ref(itsWriteOptions);
+	env["luatool"] = boost::ref(*this);
+	env["result"] = myTargetInfo;
+	env["configuration"] = itsConfiguration;
+	env["write_options"] = boost::ref(itsWriteOptions);
 
 	// Useful variables
-	globals(L)["current_time"] = forecast_time(myTargetInfo->Time());
-	globals(L)["current_level"] = level(myTargetInfo->Level());
-	globals(L)["current_forecast_type"] = forecast_type(myTargetInfo->ForecastType());
-	globals(L)["missing"] = MissingDouble();
-	globals(L)["missingf"] = MissingFloat();
-	globals(L)["kHPMissingValue"] = kHPMissingValue;  // todo: remove this constant altogether
+	env["current_time"] = forecast_time(myTargetInfo->Time());
+	env["current_level"] = level(myTargetInfo->Level());
+	env["current_forecast_type"] = forecast_type(myTargetInfo->ForecastType());
+	env["missing"] = MissingDouble();
+	env["missingf"] = MissingFloat();
+	env["kHPMissingValue"] = kHPMissingValue;  // todo: remove this constant altogether
 
-	globals(L)["kKelvin"] = constants::kKelvin;
+	env["kKelvin"] = constants::kKelvin;
 
 	auto h = GET_PLUGIN(hitool);
 
@@ -181,25 +278,63 @@ void luatool::ResetVariables(info_t myTargetInfo)
 	auto r = GET_PLUGIN(radon);
 
 	// Useful plugins
-	globals(L)["hitool"] = h;
-	globals(L)["radon"] = r;
+	env["hitool"] = h;
+	env["radon"] = r;
 }
 
-bool luatool::ReadFile(const std::string& luaFile)
+bool luatool::LoadFile(const std::string& luaFile)
 {
+	lua_State* L = myVM.L;
+
+	const auto it = myVM.chunks.find(luaFile);
+
+	if (it != myVM.chunks.end())
+	{
+		lua_rawgeti(L, LUA_REGISTRYINDEX, it->second);
+		return true;
+	}
+
 	if (!boost::filesystem::exists(luaFile))
 	{
 		std::cerr << "Error: script " << luaFile << " does not exist\n";
 		return false;
 	}
 
+	if (luaL_loadfile(L, luaFile.c_str()))
+	{
+		itsLogger.Error(lua_tostring(L, -1));
+		lua_pop(L, 1);
+		return false;
+	}
+
+	lua_pushvalue(L, -1);
+	myVM.chunks[luaFile] = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	return true;
+}
+
+bool luatool::ReadFile(const std::string& luaFile, const object& env)
+{
+	ASSERT(myVM.L);
+
+	lua_State* L = myVM.L;
+
 	try
 	{
 		timer t(true);
-		ASSERT(myL);
-		if (luaL_dofile(myL, luaFile.c_str()))
+
+		if (!LoadFile(luaFile))
 		{
-			itsLogger.Error(lua_tostring(myL, -1));
+			return false;
+		}
+
+		env.push(L);
+		SetEnvironment(L, -2);
+
+		if (lua_pcall(L, 0, 0, 0))
+		{
+			itsLogger.Error(lua_tostring(L, -1));
+			lua_pop(L, 1);
 			return false;
 		}
 		t.Stop();
@@ -207,11 +342,13 @@ bool luatool::ReadFile(const std::string& luaFile)
 	}
 	catch (const error& e)
 	{
+		lua_settop(L, 0);
 		return false;
 	}
 	catch (const std::exception& e)
 	{
 		itsLogger.Error(e.what());
+		lua_settop(L, 0);
 		return false;
 	}
 
@@ -456,6 +593,11 @@ object GetValues(info_t& anInfo)
 	return VectorToTable<double>(VEC(anInfo));
 }
 template <typename T>
+lua_array<T> GetArray(std::shared_ptr<info<T>>& anInfo)
+{
+	return lua_array<T>::View(anInfo);
+}
+template <typename T>
 point GetLatLon(std::shared_ptr<info<T>>& anInfo, size_t theIndex)
 {
 	return anInfo->Grid()->LatLon(--theIndex);
@@ -881,6 +1023,70 @@ object VerticalPlusMinusArea(std::shared_ptr<hitool> h, const param& theParams,
 	return object();
 }
 
+std::vector<HPModifierType> TableToModifierTypes(const object& table)
+{
+	std::vector<HPModifierType> ret;
+
+	for (luabind::iterator iter(table), end; iter != end; ++iter)
+	{
+		ret.push_back(static_cast<HPModifierType>(object_cast<int>(*iter)));
+	}
+
+	return ret;
+}
+
+object StatisticsToTable(const std::vector<std::vector<double>>& results)
+{
+	object ret = newtable(myVM.L);
+
+	size_t i = 0;
+	for (const auto& result : results)
+	{
+		ret[++i] = VectorToTable<double>(result);
+	}
+
+	return ret;
+}
+
+object VerticalStatisticsGrid(std::shared_ptr<hitool> h, const param& theParam, const object& firstLevelValue,
+                              const object& lastLevelValue, const object& modifierTypes, const object& findValue)
+{
+	try
+	{
+		return StatisticsToTable(h->VerticalStatistics<double>(
+		    theParam, TableToVector<double>(firstLevelValue), TableToVector<double>(lastLevelValue),
+		    TableToModifierTypes(modifierTypes), TableToVector<double>(findValue)));
+	}
+	catch (const HPExceptionType& e)
+	{
+		if (e != kFileDataNotFound)
+		{
+			throw;
+		}
+	}
+
+	return object();
+}
+
+object VerticalStatistics(std::shared_ptr<hitool> h, const param& theParam, double firstLevelValue,
+                          double lastLevelValue, const object& modifierTypes)
+{
+	try
+	{
+		return StatisticsToTable(h->VerticalStatistics<double>(theParam, firstLevelValue, lastLevelValue,
+		                                                       TableToModifierTypes(modifierTypes)));
+	}
+	catch (const HPExceptionType& e)
+	{
+		if (e != kFileDataNotFound)
+		{
+			throw;
+		}
+	}
+
+	return object();
+}
+
 void Time(std::shared_ptr<hitool> h, const forecast_time& theTime)
 {
 	h->Time(theTime);
@@ -1055,6 +1261,43 @@ void Fill(matrix<T>& mat, T value)
 }
 }  // matrix_wrapper
 
+namespace array_wrapper
+{
+template <typename T>
+object ToTable(const lua_array<T>& arr)
+{
+	return VectorToTable<T>(arr.Values());
+}
+template <typename T>
+lua_array<T> FromTable(const object& table)
+{
+	return lua_array<T>(TableToVector<T>(table));
+}
+
+// Pointers to the values of an array, for LuaJIT FFI. Pointer is valid as
+// long as the array exists and its values are not modified by other means.
+
+template <typename T>
+object Pointer(const lua_array<T>& arr)
+{
+	lua_pushlightuserdata(myVM.L, const_cast<T*>(arr.Values().data()));
+	object ret(from_stack(myVM.L, -1));
+	lua_pop(myVM.L, 1);
+
+	return ret;
+}
+template <typename T>
+object MutablePointer(lua_array<T>& arr)
+{
+	// Values are copied first if they are shared
+	lua_pushlightuserdata(myVM.L, arr.MutableValues().data());
+	object ret(from_stack(myVM.L, -1));
+	lua_pop(myVM.L, 1);
+
+	return ret;
+}
+}  // array_wrapper
+
 namespace luabind_workaround
 {
 template <typename T>
@@ -1153,6 +1396,241 @@ matrix<T> ProbLimitEq2D(const matrix<T>& A, const matrix<T>& B, T limit)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 
+template <typename T>
+scope BindArray(const char* name)
+{
+	typedef lua_array<T> array_t;
+	typedef array_t (*array_fn)(const array_t&, const array_t&);
+	typedef array_t (*scalar_fn)(const array_t&, T);
+
+	return class_<array_t>(name)
+	              .def(constructor<size_t, T>())
+	              .def("Size", &array_t::Size)
+	              .def("Get", &array_t::Get)
+	              .def("Set", &array_t::Set)
+	              .def("Fill", &array_t::Fill)
+	              .def("Copy", &array_t::Copy)
+	              .def("ToTable", &array_wrapper::ToTable<T>)
+	              .def("Pointer", &array_wrapper::Pointer<T>)
+	              .def("MutablePointer", &array_wrapper::MutablePointer<T>)
+	              .def(self + self)
+	              .def(self + other<T>())
+	              .def(other<T>() + self)
+	              .def(self - self)
+	              .def(self - other<T>())
+	              .def(other<T>() - self)
+	              .def(self * self)
+	              .def(self * other<T>())
+	              .def(other<T>() * self)
+	              .def(self / self)
+	              .def(self / other<T>())
+	              .def(other<T>() / self)
+	              .def(-self)
+	              .def("Pow", &lua_array_ops::Pow<T>)
+	              .def("Gt", static_cast<array_fn>(&lua_array_ops::Gt<T>))
+	              .def("Gt", static_cast<scalar_fn>(&lua_array_ops::Gt<T>))
+	              .def("Ge", static_cast<array_fn>(&lua_array_ops::Ge<T>))
+	              .def("Ge", static_cast<scalar_fn>(&lua_array_ops::Ge<T>))
+	              .def("Lt", static_cast<array_fn>(&lua_array_ops::Lt<T>))
+	              .def("Lt", static_cast<scalar_fn>(&lua_array_ops::Lt<T>))
+	              .def("Le", static_cast<array_fn>(&lua_array_ops::Le<T>))
+	              .def("Le", static_cast<scalar_fn>(&lua_array_ops::Le<T>))
+	              .def("Eq", static_cast<array_fn>(&lua_array_ops::Eq<T>))
+	              .def("Eq", static_cast<scalar_fn>(&lua_array_ops::Eq<T>))
+	              .def("Ne", static_cast<array_fn>(&lua_array_ops::Ne<T>))
+	              .def("Ne", static_cast<scalar_fn>(&lua_array_ops::Ne<T>));
+}
+
+template <typename T>
+scope BindArrayFunctions()
+{
+	typedef lua_array<T> array_t;
+	typedef array_t (*array_fn)(const array_t&, const array_t&);
+	typedef array_t (*scalar_fn)(const array_t&, T);
+
+	return def("Abs", &lua_array_ops::Abs<T>),
+	       def("Sqrt", &lua_array_ops::Sqrt<T>),
+	       def("Exp", &lua_array_ops::Exp<T>),
+	       def("Log", &lua_array_ops::Log<T>),
+	       def("Log10", &lua_array_ops::Log10<T>),
+	       def("Floor", &lua_array_ops::Floor<T>),
+	       def("Ceil", &lua_array_ops::Ceil<T>),
+	       def("Min", static_cast<array_fn>(&lua_array_ops::Min<T>)),
+	       def("Min", static_cast<scalar_fn>(&lua_array_ops::Min<T>)),
+	       def("Max", static_cast<array_fn>(&lua_array_ops::Max<T>)),
+	       def("Max", static_cast<scalar_fn>(&lua_array_ops::Max<T>)),
+	       def("Clamp", &lua_array_ops::Clamp<T>),
+	       def("Where", static_cast<array_t (*)(const array_t&, const array_t&, const array_t&)>(&lua_array_ops::Where<T>)),
+	       def("Where", static_cast<array_t (*)(const array_t&, const array_t&, T)>(&lua_array_ops::Where<T>)),
+	       def("Where", static_cast<array_t (*)(const array_t&, T, const array_t&)>(&lua_array_ops::Where<T>)),
+	       def("Where", static_cast<array_t (*)(const array_t&, T, T)>(&lua_array_ops::Where<T>)),
+	       def("IsMissing", &lua_array_ops::MissingMask<T>),
+	       def("FillMissing", &lua_array_ops::FillMissing<T>),
+	       def("Count", &lua_array_ops::Count<T>),
+	       def("Sum", &lua_array_ops::Sum<T>),
+	       def("Mean", &lua_array_ops::Mean<T>),
+	       def("MinValue", &lua_array_ops::MinValue<T>),
+	       def("MaxValue", &lua_array_ops::MaxValue<T>),
+	       def("KelvinToCelsius", &lua_array_ops::KelvinToCelsius<T>),
+	       def("CelsiusToKelvin", &lua_array_ops::CelsiusToKelvin<T>),
+	       def("PaToHPa", &lua_array_ops::PaToHPa<T>),
+	       def("HPaToPa", &lua_array_ops::HPaToPa<T>),
+	       def("DewPointFromRH", &lua_array_ops::DewPointFromRH<T>),
+	       def("RelativeHumidity", &lua_array_ops::RelativeHumidity<T>),
+	       def("ThetaE", &lua_array_ops::ThetaE<T>);
+}
+
+// Element access with a[i] and a[i] = x, and length with #a. luabind uses
+// __index and __newindex of the instance metatable for member lookup, so
+// these functions handle numeric keys of arrays and pass everything else to
+// the original functions of luabind (first upvalue).
+//
+// No C++ objects with destructors may be alive when a lua error is raised.
+
+template <typename T>
+lua_array<T>* ToArray(lua_State* L, int index)
+{
+	const auto arr = object_cast_nothrow<lua_array<T>*>(object(from_stack(L, index)));
+	return arr ? *arr : nullptr;
+}
+
+template <typename T>
+bool IsArrayIndex(const lua_array<T>& arr, lua_Number key)
+{
+	return key >= 1 && key <= static_cast<lua_Number>(arr.Size()) && key == std::floor(key);
+}
+
+template <typename T>
+int GetElement(lua_State* L, const lua_array<T>& arr)
+{
+	const lua_Number key = lua_tonumber(L, 2);
+
+	if (!IsArrayIndex(arr, key))
+	{
+		return luaL_error(L, "Array index %f is outside of [1, %f]", key, static_cast<lua_Number>(arr.Size()));
+	}
+
+	lua_pushnumber(L, static_cast<lua_Number>(arr.Values()[static_cast<size_t>(key) - 1]));
+	return 1;
+}
+
+template <typename T>
+int SetElement(lua_State* L, lua_array<T>& arr)
+{
+	const lua_Number key = lua_tonumber(L, 2);
+	const lua_Number value = luaL_checknumber(L, 3);
+
+	if (!IsArrayIndex(arr, key))
+	{
+		return luaL_error(L, "Array index %f is outside of [1, %f]", key, static_cast<lua_Number>(arr.Size()));
+	}
+
+	// Values are copied first if they are shared
+	arr.MutableValues()[static_cast<size_t>(key) - 1] = static_cast<T>(value);
+	return 0;
+}
+
+int CallOriginal(lua_State* L, int nresults)
+{
+	if (lua_isnil(L, lua_upvalueindex(1)))
+	{
+		return luaL_error(L, "Operation is not supported by %s", luaL_typename(L, 1));
+	}
+
+	lua_pushvalue(L, lua_upvalueindex(1));
+	lua_insert(L, 1);
+	lua_call(L, lua_gettop(L) - 1, nresults);
+
+	return nresults;
+}
+
+int ArrayIndex(lua_State* L)
+{
+	if (lua_type(L, 2) == LUA_TNUMBER)
+	{
+		if (auto arr = ToArray<double>(L, 1))
+		{
+			return GetElement(L, *arr);
+		}
+		if (auto arr = ToArray<float>(L, 1))
+		{
+			return GetElement(L, *arr);
+		}
+	}
+
+	return CallOriginal(L, 1);
+}
+
+int ArrayNewIndex(lua_State* L)
+{
+	if (lua_type(L, 2) == LUA_TNUMBER)
+	{
+		if (auto arr = ToArray<double>(L, 1))
+		{
+			return SetElement(L, *arr);
+		}
+		if (auto arr = ToArray<float>(L, 1))
+		{
+			return SetElement(L, *arr);
+		}
+	}
+
+	return CallOriginal(L, 0);
+}
+
+int ArrayLength(lua_State* L)
+{
+	if (auto arr = ToArray<double>(L, 1))
+	{
+		lua_pushnumber(L, static_cast<lua_Number>(arr->Size()));
+		return 1;
+	}
+	if (auto arr = ToArray<float>(L, 1))
+	{
+		lua_pushnumber(L, static_cast<lua_Number>(arr->Size()));
+		return 1;
+	}
+
+	return CallOriginal(L, 1);
+}
+
+// Replace metamethods of the metatable of the value on top of the stack,
+// unless that has been done already (luabind can share one metatable between
+// all classes). Pops the value.
+
+void WrapArrayMetatable(lua_State* L)
+{
+	lua_getmetatable(L, -1);
+	lua_getfield(L, -1, "__himan_array");
+
+	if (lua_isnil(L, -1))
+	{
+		const std::vector<std::pair<const char*, lua_CFunction>> metamethods = {
+		    {"__index", &ArrayIndex}, {"__newindex", &ArrayNewIndex}, {"__len", &ArrayLength}};
+
+		for (const auto& m : metamethods)
+		{
+			lua_getfield(L, -2, m.first);
+			lua_pushcclosure(L, m.second, 1);
+			lua_setfield(L, -3, m.first);
+		}
+
+		lua_pushboolean(L, 1);
+		lua_setfield(L, -3, "__himan_array");
+	}
+
+	lua_pop(L, 3);
+}
+
+void BindArrayIndexing(lua_State* L)
+{
+	object(L, lua_array<double>(1, 0.)).push(L);
+	WrapArrayMetatable(L);
+
+	object(L, lua_array<float>(1, 0.f)).push(L);
+	WrapArrayMetatable(L);
+}
+
 void BindLib(lua_State* L)
 {
 	module(L)[class_<himan::info<double>, std::shared_ptr<himan::info<double>>>("info")
@@ -1199,6 +1677,7 @@ void BindLib(lua_State* L)
 	              .def("SetValues", &info_wrapper::SetValues<double>)
 	              .def("SetValuesFromMatrix", &info_wrapper::SetValuesFromMatrix<double>)
 	              .def("GetValues", &info_wrapper::GetValues<double>)
+	              .def("GetArray", &info_wrapper::GetArray<double>)
 	              .def("GetLatLon", &info_wrapper::GetLatLon<double>)
 	              .def("GetMissingValue", &info_wrapper::GetMissingValue<double>)
 	              .def("SetMissingValue", &info_wrapper::SetMissingValue<double>)
@@ -1245,6 +1724,7 @@ void BindLib(lua_State* L)
 	              .def("SetValues", &info_wrapper::SetValues<float>)
 	              .def("SetValuesFromMatrix", &info_wrapper::SetValuesFromMatrix<float>)
 	              .def("GetValues", &info_wrapper::GetValues<float>)
+	              .def("GetArray", &info_wrapper::GetArray<float>)
 	              .def("GetLatLon", &info_wrapper::GetLatLon<float>)
 	              .def("GetMissingValue", &info_wrapper::GetMissingValue<float>)
 	              .def("SetMissingValue", &info_wrapper::SetMissingValue<float>)
@@ -1301,6 +1781,12 @@ void BindLib(lua_State* L)
 	              .def("GetLastPoint", LUA_CMEMFN(point, reduced_gaussian_grid, LastPoint, void))
 	          ,
 #endif
+	          BindArray<double>("array"),
+	          BindArray<float>("arrayf"),
+	          BindArrayFunctions<double>(),
+	          BindArrayFunctions<float>(),
+	          def("TableToArray", &array_wrapper::FromTable<double>),
+	          def("TableToArrayf", &array_wrapper::FromTable<float>),
 	          class_<matrix<double>>("matrix")
 	              .def(constructor<size_t, size_t, size_t, double>())
 	              .def("SetValues", &matrix_wrapper::SetValues<double>)
@@ -1575,7 +2061,10 @@ void BindPlugins(lua_State* L)
                                                            const param&, const forecast_type&))
 	              .def("Fetch", LUA_CMEMFN(object, luatool, Fetch, const forecast_time&, const level&, const param&))
 	              .def("FetchWithType", LUA_CMEMFN(object, luatool, Fetch, const forecast_time&, const level&,
-	                                               const param&, const forecast_type&)),
+	                                               const param&, const forecast_type&))
+	              .def("FetchArray", LUA_CMEMFN(object, luatool, FetchArray, const forecast_time&, const level&, const param&))
+	              .def("FetchArrayWithType", LUA_CMEMFN(object, luatool, FetchArray, const forecast_time&, const level&,
+	                                                    const param&, const forecast_type&)),
 	          class_<hitool, std::shared_ptr<hitool>>("hitool")
 	              .def(constructor<>())
 	              .def("ClassName", &hitool::ClassName)
@@ -1600,6 +2089,8 @@ void BindPlugins(lua_State* L)
 	              .def("VerticalValue", &hitool_wrapper::VerticalValue)
 	              .def("VerticalPlusMinusAreaGrid", &hitool_wrapper::VerticalPlusMinusAreaGrid)
 	              .def("VerticalPlusMinusArea", &hitool_wrapper::VerticalPlusMinusArea)
+	              .def("VerticalStatisticsGrid", &hitool_wrapper::VerticalStatisticsGrid)
+	              .def("VerticalStatistics", &hitool_wrapper::VerticalStatistics)
 	              .def("SetHeightUnit", &hitool_wrapper::SetHeightUnit)
 	              .def("GetHeightUnit", &hitool_wrapper::GetHeightUnit),
 	          class_<radon, std::shared_ptr<radon>>("radon")
@@ -1638,12 +2129,31 @@ luabind::object luatool::Fetch(const forecast_time& theTime, const level& theLev
 	return VectorToTable<double>(x->Data().Values());
 }
 
+luabind::object luatool::FetchArray(const forecast_time& theTime, const level& theLevel, const param& theParam) const
+{
+	return luatool::FetchArray(theTime, theLevel, theParam, forecast_type(kDeterministic));
+}
+
+luabind::object luatool::FetchArray(const forecast_time& theTime, const level& theLevel, const param& theParam,
+                                    const forecast_type& theType) const
+{
+	auto x = compiled_plugin_base::Fetch(theTime, theLevel, theParam, theType, false);
+
+	if (!x)
+	{
+		return object();
+	}
+
+	// Array refers to the fetched data directly, no copy is made
+	return object(myVM.L, lua_array<double>::View(x));
+}
+
 template <typename T>
 object VectorToTable(const std::vector<T>& vec)
 {
-	ASSERT(myL);
+	ASSERT(myVM.L);
 
-	object ret = newtable(myL);
+	object ret = newtable(myVM.L);
 
 	size_t i = 0;
 	for (const T& val : vec)
@@ -1671,6 +2181,20 @@ std::vector<T> TableToVector(const object& table)
 		return std::vector<T>();
 	}
 
+	if (type(table) == LUA_TUSERDATA)
+	{
+		// Arrays are copied as a whole, not element by element
+
+		if (const auto arr = object_cast_nothrow<const lua_array<double>*>(table))
+		{
+			return std::vector<T>(arr.get()->Values().begin(), arr.get()->Values().end());
+		}
+		if (const auto arr = object_cast_nothrow<const lua_array<float>*>(table))
+		{
+			return std::vector<T>(arr.get()->Values().begin(), arr.get()->Values().end());
+		}
+	}
+
 	luabind::iterator iter(table), end;
 
 	auto size = std::distance(iter, end);
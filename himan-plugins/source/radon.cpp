@@ -7,10 +7,16 @@
 #include "logger.h"
 #include "plugin_factory.h"
 #include "point_list.h"
+#include "s3.h"
 #include "util.h"
 #include <boost/filesystem.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <set>
 #include <sstream>
 #include <thread>
+#include <unordered_map>
 
 using namespace std;
 using namespace himan::plugin;
@@ -19,6 +25,12 @@ const int MAX_WORKERS = 32;
 static once_flag oflag;
 static map<string, string> tableNameCache;
 static mutex tableNameMutex;
+static map<string, vector<vector<string>>> gridGeomCache;
+static mutex gridGeomMutex;
+static map<string, string> producerMetaDataCache;
+static mutex producerMetaDataMutex;
+static map<long, vector<himan::plugin::hybrid_level_height>> hybridLevelHeightCache;
+static mutex hybridLevelHeightMutex;
 
 void radon::Init()
 {
@@ -224,6 +236,17 @@ vector<vector<string>> GetGridGeoms(himan::plugin::search_options& options, uniq
 
 	const string ref_prod = options.prod.Name();
 	const string analtime = options.time.OriginDateTime().String("%Y-%m-%d %H:%M:%S+00");
+	const string key = ref_prod + "_" + analtime + "_" + himan::util::Join(sourceGeoms, ",");
+
+	{
+		lock_guard<mutex> lock(gridGeomMutex);
+		const auto it = gridGeomCache.find(key);
+
+		if (it != gridGeomCache.end())
+		{
+			return it->second;
+		}
+	}
 
 	if (sourceGeoms.empty())
 	{
@@ -244,6 +267,12 @@ vector<vector<string>> GetGridGeoms(himan::plugin::search_options& options, uniq
 		}
 	}
 
+	if (!gridgeoms.empty())
+	{
+		lock_guard<mutex> lock(gridGeomMutex);
+		gridGeomCache[key] = gridgeoms;
+	}
+
 	return gridgeoms;
 }
 
@@ -370,6 +399,322 @@ string CreateFileSQLQuery(himan::plugin::search_options& options, const vector<v
 	return query.str();
 }
 
+himan::file_information MakeFileInformation(const vector<string>& values)
+{
+	himan::file_information finfo;
+	finfo.file_location = values[0];
+	finfo.file_server = (values.size() > 7) ? values[7] : "";
+	finfo.file_type = static_cast<himan::HPFileType>(stoi(values[4]));  // 1 = GRIB1, 2=GRIB2
+	finfo.storage_type = static_cast<himan::HPFileStorageType>(stoi(values[5]));
+
+	try
+	{
+		finfo.offset = static_cast<unsigned long>(stoul(values[2]));
+		finfo.length = static_cast<unsigned long>(stoul(values[3]));
+		finfo.message_no = static_cast<unsigned long>(stoul(values[6]));
+	}
+	catch (const invalid_argument& e)
+	{
+		finfo.offset = boost::none;
+		finfo.length = boost::none;
+		finfo.message_no = boost::none;
+	}
+
+	return finfo;
+}
+
+// File index: when a parameter is first requested, file locations of all its
+// levels for all forecast times of the plugin are fetched with one query.
+// Following requests of the same parameter are answered from the index.
+// Entries of a parameter are dropped when grids of it are saved to radon, so
+// that the index never returns a location that has been replaced. Each drop
+// increases the generation of the parameter; locations that were queried
+// before the drop and stored after it would be stale, so they are discarded.
+
+struct file_index_entry
+{
+	size_t geometryOrder;  // position of geometry in the list of source geometries
+	himan::file_information finfo;
+};
+
+static mutex fileIndexMutex;
+static map<string, shared_ptr<once_flag>> fileIndexGroups;
+static unordered_map<string, file_index_entry> fileIndex;
+static unordered_map<string, size_t> fileIndexGenerations;
+
+string GeometryKey(const vector<vector<string>>& gridgeoms)
+{
+	string key;
+
+	for (const auto& geom : gridgeoms)
+	{
+		key += geom[0] + ",";
+	}
+
+	return key;
+}
+
+string FileIndexParamKey(long producerId, const himan::raw_time& originTime, const string& paramName)
+{
+	return to_string(producerId) + "|" + originTime.String("%Y-%m-%d %H:%M:%S") + "|" + paramName;
+}
+
+string FileIndexKey(const himan::plugin::search_options& options, const string& geometryKey, const string& levelValue,
+                    const string& levelValue2, long period, const string& forecastTypeId,
+                    const string& forecastTypeValue)
+{
+	return geometryKey + "|" +
+	       FileIndexParamKey(options.prod.Id(), options.time.OriginDateTime(), options.param.Name()) + "|" +
+	       himan::HPLevelTypeToString.at(options.level.Type()) + "|" + levelValue + "|" + levelValue2 + "|" +
+	       to_string(period) + "|" + forecastTypeId + "|" + forecastTypeValue;
+}
+
+// Remove index entries of parameters, given as keys from FileIndexParamKey.
+// Next request of a parameter loads its file locations again.
+
+void InvalidateFileIndex(const set<string>& paramKeys)
+{
+	if (paramKeys.empty())
+	{
+		return;
+	}
+
+	// Keys start with the geometry key, which does not contain '|'
+
+	auto matches = [&](const string& key) {
+		const auto pos = key.find('|');
+
+		if (pos == string::npos)
+		{
+			return false;
+		}
+
+		const auto end = key.find('|', key.find('|', key.find('|', pos + 1) + 1) + 1);
+
+		return paramKeys.count(key.substr(pos + 1, end == string::npos ? string::npos : end - pos - 1)) > 0;
+	};
+
+	lock_guard<mutex> lock(fileIndexMutex);
+
+	for (const auto& paramKey : paramKeys)
+	{
+		fileIndexGenerations[paramKey]++;
+	}
+
+	for (auto it = fileIndexGroups.begin(); it != fileIndexGroups.end();)
+	{
+		it = matches(it->first) ? fileIndexGroups.erase(it) : next(it);
+	}
+
+	for (auto it = fileIndex.begin(); it != fileIndex.end();)
+	{
+		it = matches(it->first) ? fileIndex.erase(it) : next(it);
+	}
+}
+
+string ForecastTypeValue(const himan::forecast_type& ftype)
+{
+	return (ftype.Type() >= 3 && ftype.Type() <= 4) ? to_string(ftype.Value()) : to_string(-1.);
+}
+
+void LoadFileIndex(const himan::plugin::search_options& options, const vector<vector<string>>& gridgeoms,
+                   unique_ptr<NFmiRadonDB>& itsRadonDB, himan::logger& logr)
+{
+	const string analtime = options.time.OriginDateTime().String("%Y-%m-%d %H:%M:%S+00");
+	const string level_name = himan::HPLevelTypeToString.at(options.level.Type());
+	const string geometryKey = GeometryKey(gridgeoms);
+	const string paramKey = FileIndexParamKey(options.prod.Id(), options.time.OriginDateTime(), options.param.Name());
+
+	size_t generation;
+
+	{
+		lock_guard<mutex> lock(fileIndexMutex);
+		generation = fileIndexGenerations[paramKey];
+	}
+
+	set<string> periods = {himan::util::MakeSQLInterval(options.time)};
+
+	for (const auto& time : options.configuration->Times())
+	{
+		if (time.OriginDateTime() == options.time.OriginDateTime())
+		{
+			periods.insert(himan::util::MakeSQLInterval(time));
+		}
+	}
+
+	string forecastTypeId = to_string(options.ftype.Type());
+
+	if (options.ftype.Type() == 1)
+	{
+		// ECMWF (and maybe others) use forecast type id == 2 for analysis hour
+		forecastTypeId += ",2";
+	}
+
+	map<string, size_t> geometryOrder;
+
+	for (size_t i = 0; i < gridgeoms.size(); i++)
+	{
+		geometryOrder.insert(make_pair(gridgeoms[i][0], i));
+	}
+
+	stringstream query;
+
+	// clang-format off
+
+	query << "SELECT t.file_location, g.name, byte_offset, byte_length, file_format_id, file_protocol_id, message_no, t.file_server, "
+	      << "t.geometry_id, t.level_value, t.level_value2, extract(epoch from t.forecast_period)::bigint, "
+	      << "t.forecast_type_id, t.forecast_type_value "
+	      << "FROM " << gridgeoms[0][4] << "." << gridgeoms[0][5] << " t, geom g, param p, level l"
+	      << " WHERE t.geometry_id = g.id"
+	      << " AND t.producer_id = " << options.prod.Id()
+	      << " AND t.param_id = p.id"
+	      << " AND l.id = t.level_id"
+	      << " AND t.analysis_time = '" << analtime << "'"
+	      << " AND p.name = '" << options.param.Name() << "'"
+	      << " AND l.name = upper('" << level_name << "')"
+	      << " AND t.forecast_period IN (";
+
+	// clang-format on
+
+	for (const auto& period : periods)
+	{
+		query << "'" << period << "',";
+	}
+
+	query.seekp(-1, ios_base::end);
+	query << ") AND forecast_type_id IN (" << forecastTypeId << ")"
+	      << " AND forecast_type_value = " << ForecastTypeValue(options.ftype) << " AND g.id IN (" << geometryKey;
+	query.seekp(-1, ios_base::end);
+	query << ")";
+
+	itsRadonDB->Query(query.str());
+
+	vector<vector<string>> rows;
+
+	while (true)
+	{
+		auto row = itsRadonDB->FetchRow();
+
+		if (row.empty())
+		{
+			break;
+		}
+
+		rows.push_back(move(row));
+	}
+
+	lock_guard<mutex> lock(fileIndexMutex);
+
+	if (fileIndexGenerations[paramKey] != generation)
+	{
+		// Grids of the parameter were saved while the query was running
+
+		logr.Trace("Discarding " + to_string(rows.size()) + " file locations for parameter " +
+		           options.param.Name() + ": index was invalidated during query");
+		return;
+	}
+
+	for (const auto& row : rows)
+	{
+		const string key =
+		    FileIndexKey(options, geometryKey, to_string(stod(row[9])), to_string(stod(row[10])), stol(row[11]),
+		                 row[12], to_string(stod(row[13])));
+		const size_t order = geometryOrder[row[8]];
+
+		auto it = fileIndex.find(key);
+
+		if (it == fileIndex.end() || order < it->second.geometryOrder)
+		{
+			fileIndex[key] = file_index_entry{order, MakeFileInformation(row)};
+		}
+	}
+
+	logr.Trace("Indexed " + to_string(rows.size()) + " file locations for parameter " + options.param.Name() + " level " +
+	           level_name);
+}
+
+bool FromFileIndex(const himan::plugin::search_options& options, const vector<vector<string>>& gridgeoms,
+                   unique_ptr<NFmiRadonDB>& itsRadonDB, himan::logger& logr, himan::file_information& finfo)
+{
+	// Index is used only if all geometries are in the same table
+
+	for (size_t i = 1; i < gridgeoms.size(); i++)
+	{
+		if (gridgeoms[0][1] != gridgeoms[i][1])
+		{
+			return false;
+		}
+	}
+
+	const string geometryKey = GeometryKey(gridgeoms);
+
+	string times;
+
+	for (const auto& time : options.configuration->Times())
+	{
+		times += static_cast<string>(time.Step()) + ",";
+	}
+
+	const string groupKey = geometryKey + "|" +
+	                        FileIndexParamKey(options.prod.Id(), options.time.OriginDateTime(), options.param.Name()) +
+	                        "|" + himan::HPLevelTypeToString.at(options.level.Type()) + "|" +
+	                        to_string(options.ftype.Type()) + "|" + ForecastTypeValue(options.ftype) + "|" + times;
+
+	shared_ptr<once_flag> flag;
+
+	{
+		lock_guard<mutex> lock(fileIndexMutex);
+		auto& f = fileIndexGroups[groupKey];
+
+		if (!f)
+		{
+			f = make_shared<once_flag>();
+		}
+
+		flag = f;
+	}
+
+	call_once(*flag, [&]() {
+		try
+		{
+			LoadFileIndex(options, gridgeoms, itsRadonDB, logr);
+		}
+		catch (const pqxx::sql_error& e)
+		{
+			// Requests of this parameter are queried one by one
+			logr.Warning("Unable to index file locations: " + string(e.what()));
+		}
+	});
+
+	const string levelValue = to_string(options.level.Value());
+	const string levelValue2 =
+	    to_string(options.level.Value2() == himan::kHPMissingValue ? -1. : options.level.Value2());
+	const long period = options.time.Step().Seconds();
+
+	vector<string> forecastTypeIds = {to_string(options.ftype.Type())};
+
+	if (period == 0 && options.ftype.Type() == 1)
+	{
+		forecastTypeIds.push_back("2");
+	}
+
+	lock_guard<mutex> lock(fileIndexMutex);
+
+	for (const auto& forecastTypeId : forecastTypeIds)
+	{
+		const auto it = fileIndex.find(FileIndexKey(options, geometryKey, levelValue, levelValue2, period,
+		                                            forecastTypeId, ForecastTypeValue(options.ftype)));
+
+		if (it != fileIndex.end())
+		{
+			finfo = it->second.finfo;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 vector<himan::file_information> radon::Files(search_options& options)
 {
 	Init();
@@ -384,6 +729,20 @@ vector<himan::file_information> radon::Files(search_options& options)
 		return ret;
 	}
 
+	if (options.prod.Class() == kGridClass)
+	{
+		file_information finfo;
+
+		if (FromFileIndex(options, gridgeoms, itsRadonDB, itsLogger, finfo))
+		{
+			return {finfo};
+		}
+	}
+
+	// Data is not in the index, for example because it is not from the forecast
+	// times of the plugin or because it has been added to database after the
+	// index was built
+
 	const auto query = CreateFileSQLQuery(options, gridgeoms);
 
 	if (query.empty())
@@ -419,26 +778,74 @@ vector<himan::file_information> radon::Files(search_options& options)
 
 	itsLogger.Trace("Found data for parameter " + options.param.Name() + " from radon geometry " + values[1]);
 
-	file_information finfo;
-	finfo.file_location = values[0];
-	finfo.file_server = values[7];
-	finfo.file_type = static_cast<HPFileType>(stoi(values[4]));  // 1 = GRIB1, 2=GRIB2
-	finfo.storage_type = static_cast<HPFileStorageType>(stoi(values[5]));
+	return {MakeFileInformation(values)};
+}
+
+string radon::ProducerMetaData(long producerId, const string& attName)
+{
+	const string key = to_string(producerId) + "_" + attName;
 
-	try
 	{
-		finfo.offset = static_cast<unsigned long>(stoul(values[2]));
-		finfo.length = static_cast<unsigned long>(stoul(values[3]));
-		finfo.message_no = static_cast<unsigned long>(stoul(values[6]));
+		lock_guard<mutex> lock(producerMetaDataMutex);
+		const auto it = producerMetaDataCache.find(key);
+
+		if (it != producerMetaDataCache.end())
+		{
+			return it->second;
+		}
 	}
-	catch (const invalid_argument& e)
+
+	Init();
+
+	const string value = itsRadonDB->GetProducerMetaData(producerId, attName);
+
+	lock_guard<mutex> lock(producerMetaDataMutex);
+	producerMetaDataCache[key] = value;
+
+	return value;
+}
+
+vector<himan::plugin::hybrid_level_height> radon::HybridLevelHeights(long producerId)
+{
 	{
-		finfo.offset = boost::none;
-		finfo.length = boost::none;
-		finfo.message_no = boost::none;
+		lock_guard<mutex> lock(hybridLevelHeightMutex);
+		const auto it = hybridLevelHeightCache.find(producerId);
+
+		if (it != hybridLevelHeightCache.end())
+		{
+			return it->second;
+		}
+	}
+
+	Init();
+
+	stringstream query;
+	query << "SELECT level_value, minimum_height, maximum_height, minimum_pressure, maximum_pressure "
+	      << "FROM hybrid_level_height WHERE producer_id = " << producerId;
+
+	itsRadonDB->Query(query.str());
+
+	auto ToDouble = [](const string& str) { return str.empty() ? MissingDouble() : stod(str); };
+
+	vector<hybrid_level_height> heights;
+
+	while (true)
+	{
+		const auto row = itsRadonDB->FetchRow();
+
+		if (row.empty())
+		{
+			break;
+		}
+
+		heights.push_back(
+		    {stol(row[0]), ToDouble(row[1]), ToDouble(row[2]), ToDouble(row[3]), ToDouble(row[4])});
 	}
 
-	return {finfo};
+	lock_guard<mutex> lock(hybridLevelHeightMutex);
+	hybridLevelHeightCache[producerId] = heights;
+
+	return heights;
 }
 
 bool radon::Save(const info<double>& resultInfo, const file_information& finfo, const string& targetGeomName)
@@ -570,6 +977,300 @@ bool radon::SavePrevi(const info<T>& resultInfo)
 template bool radon::SavePrevi<double>(const info<double>&);
 template bool radon::SavePrevi<float>(const info<float>&);
 
+namespace
+{
+// Lookups that are needed for every saved grid but whose results do not change
+// during a run are memoized
+
+mutex lookupMutex;
+map<string, map<string, string>> geometryCache;
+map<string, map<string, string>> tableCache;
+map<string, map<string, string>> levelCache;
+
+template <typename F>
+map<string, string> Memoize(map<string, map<string, string>>& cache, const string& key, F lookup)
+{
+	{
+		lock_guard<mutex> lock(lookupMutex);
+		const auto it = cache.find(key);
+
+		if (it != cache.end())
+		{
+			return it->second;
+		}
+	}
+
+	auto value = lookup();
+
+	if (!value.empty())
+	{
+		lock_guard<mutex> lock(lookupMutex);
+		cache[key] = value;
+	}
+
+	return value;
+}
+
+// Grid metadata rows waiting to be written to radon. Rows are grouped per
+// table, and a later row with the same key replaces the earlier one.
+
+struct grid_row
+{
+	string values;        // column values for insert
+	string keyCondition;  // where clause matching the unique key of the row
+	string fileColumns;   // file information columns for update
+	string indexKey;      // parameter key of file index
+};
+
+struct table_batch
+{
+	string schemaName;
+	string partitionName;
+	bool firstRecords;  // table had no records before this run
+	map<string, grid_row> rows;
+};
+
+const string gridColumns =
+    "producer_id, analysis_time, geometry_id, param_id, level_id, level_value, level_value2, forecast_period, "
+    "forecast_type_id, forecast_type_value, file_location, file_server, file_format_id, file_protocol_id, "
+    "message_no, byte_offset, byte_length";
+
+const string gridKeyColumns =
+    "producer_id, analysis_time, geometry_id, param_id, level_id, level_value, level_value2, forecast_period, "
+    "forecast_type_id, forecast_type_value";
+
+mutex batchMutex;
+map<string, table_batch> batches;
+size_t pendingRows = 0;
+chrono::steady_clock::time_point oldestPendingRow;
+
+// Rows of grids that are written to S3 objects that are not complete yet.
+// They are moved to batches when the object can be read, so that radon never
+// points to data that does not exist. Rows of failed objects are never written.
+
+struct held_row
+{
+	string fullTableName;
+	string schemaName;
+	string partitionName;
+	bool firstRecords;
+	grid_row row;
+};
+
+map<string, vector<held_row>> heldRows;
+
+// Add row to batch of a table. Called with batchMutex held.
+
+void QueueRow(const string& fullTableName, const string& schemaName, const string& partitionName, bool firstRecords,
+              const grid_row& row)
+{
+	auto& batch = batches[fullTableName];
+
+	if (batch.rows.empty())
+	{
+		batch.schemaName = schemaName;
+		batch.partitionName = partitionName;
+		batch.firstRecords = firstRecords;
+	}
+
+	if (pendingRows == 0)
+	{
+		oldestPendingRow = chrono::steady_clock::now();
+	}
+
+	const auto inserted = batch.rows.insert(make_pair(row.keyCondition, row));
+
+	if (inserted.second)
+	{
+		pendingRows++;
+	}
+	else
+	{
+		inserted.first->second = row;
+	}
+}
+
+// Move rows of objects that have been completed to batches. Called with
+// batchMutex held.
+
+void ReleaseHeldRows()
+{
+	for (auto it = heldRows.begin(); it != heldRows.end();)
+	{
+		if (himan::s3::IsIncompleteObject(it->first))
+		{
+			++it;
+			continue;
+		}
+
+		for (const auto& held : it->second)
+		{
+			QueueRow(held.fullTableName, held.schemaName, held.partitionName, held.firstRecords, held.row);
+		}
+
+		it = heldRows.erase(it);
+	}
+}
+
+// Rows are written when this many are pending, or when the oldest of them
+// has waited for the maximum age
+size_t batchSize = 500;
+const chrono::seconds maxBatchAge(10);
+once_flag batchFlag;
+
+// Only one batch is written at a time, so that rows of the same grid are
+// written in the order they were saved
+mutex flushMutex;
+
+size_t BatchSize()
+{
+	call_once(batchFlag, []() {
+		try
+		{
+			batchSize = max(1, stoi(himan::util::GetEnv("RADON_BATCH_SIZE")));
+		}
+		catch (...)
+		{
+		}
+	});
+
+	return batchSize;
+}
+
+// Put rows of batches that could not be written back to the queue, so that
+// they are written by the next flush. Rows queued after the failed flush are
+// newer and they are kept.
+
+void RequeueBatches(const map<string, table_batch>& failed)
+{
+	lock_guard<mutex> lock(batchMutex);
+
+	for (const auto& elem : failed)
+	{
+		auto& batch = batches[elem.first];
+
+		if (batch.rows.empty())
+		{
+			batch.schemaName = elem.second.schemaName;
+			batch.partitionName = elem.second.partitionName;
+			batch.firstRecords = elem.second.firstRecords;
+		}
+
+		for (const auto& row : elem.second.rows)
+		{
+			if (batch.rows.insert(row).second)
+			{
+				if (pendingRows == 0)
+				{
+					oldestPendingRow = chrono::steady_clock::now();
+				}
+
+				pendingRows++;
+			}
+		}
+	}
+}
+
+// Background thread writes rows that have waited for the maximum age even if
+// no more grids are saved, and rows that are still pending when the process
+// exits are written by an exit handler. Rows are therefore not lost if a
+// plugin does not flush when it finishes, or if the run ends with exit().
+//
+// Error of a flush that was not called by a plugin is thrown by the next
+// radon::Flush(), and if there is none, the exit handler aborts.
+
+mutex flusherMutex;
+condition_variable flusherCondition;
+thread flusherThread;
+bool stopFlusher = false;
+once_flag flusherFlag;
+
+mutex flushErrorMutex;
+string flushError;
+
+void FlushPendingRows()
+{
+	try
+	{
+		himan::plugin::radon r;
+		r.Flush();
+	}
+	catch (const exception& e)
+	{
+		himan::logger log("radon");
+		log.Error("Writing pending rows to radon failed: " + string(e.what()));
+
+		lock_guard<mutex> lock(flushErrorMutex);
+		flushError = e.what();
+	}
+}
+
+void FlusherThread()
+{
+	unique_lock<mutex> lock(flusherMutex);
+
+	while (!stopFlusher)
+	{
+		flusherCondition.wait_for(lock, maxBatchAge / 2);
+
+		bool flush;
+
+		{
+			lock_guard<mutex> batchLock(batchMutex);
+			flush = (pendingRows > 0 && chrono::steady_clock::now() - oldestPendingRow >= maxBatchAge);
+		}
+
+		if (flush && !stopFlusher)
+		{
+			lock.unlock();
+			FlushPendingRows();
+			lock.lock();
+		}
+	}
+}
+
+void StopFlusher()
+{
+	{
+		lock_guard<mutex> lock(flusherMutex);
+		stopFlusher = true;
+	}
+
+	flusherCondition.notify_all();
+
+	if (flusherThread.get_id() == this_thread::get_id())
+	{
+		// exit() was called while flushing: flush is not re-entered
+		flusherThread.detach();
+		return;
+	}
+
+	if (flusherThread.joinable())
+	{
+		flusherThread.join();
+	}
+
+	FlushPendingRows();
+
+	lock_guard<mutex> lock(flushErrorMutex);
+
+	if (!flushError.empty())
+	{
+		himan::logger log("radon");
+		log.Fatal("Rows were not written to radon: " + flushError);
+		himan::Abort();
+	}
+}
+
+void StartFlusher()
+{
+	call_once(flusherFlag, []() {
+		flusherThread = thread(&FlusherThread);
+		atexit(&StopFlusher);
+	});
+}
+}  // namespace
+
 template <typename T>
 bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, const string& targetGeomName)
 {
@@ -585,7 +1286,7 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 	 * 1. Get grid information
 	 * 2. Get model information
 	 * 3. Get data set information (ie model run)
-	 * 4. Insert or update
+	 * 4. Queue row for insert or update
 	 */
 
 	himan::point firstGridPoint = resultInfo.Grid()->FirstPoint();
@@ -627,7 +1328,8 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 
 	if (!targetGeomName.empty())
 	{
-		geominfo = itsRadonDB->GetGeometryDefinition(targetGeomName);
+		geominfo = Memoize(geometryCache, targetGeomName,
+		                   [&]() { return itsRadonDB->GetGeometryDefinition(targetGeomName); });
 	}
 
 	if (geominfo.empty())
@@ -636,8 +1338,14 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 		{
 			auto gr = dynamic_pointer_cast<regular_grid>(resultInfo.Grid());
 
-			geominfo = itsRadonDB->GetGeometryDefinition(gr->Ni(), gr->Nj(), firstGridPoint.Y(), firstGridPoint.X(),
-			                                             gr->Di(), gr->Dj(), gribVersion, gridType);
+			stringstream key;
+			key << gr->Ni() << "_" << gr->Nj() << "_" << firstGridPoint.Y() << "_" << firstGridPoint.X() << "_"
+			    << gr->Di() << "_" << gr->Dj() << "_" << gribVersion << "_" << gridType;
+
+			geominfo = Memoize(geometryCache, key.str(), [&]() {
+				return itsRadonDB->GetGeometryDefinition(gr->Ni(), gr->Nj(), firstGridPoint.Y(), firstGridPoint.X(),
+				                                         gr->Di(), gr->Dj(), gribVersion, gridType);
+			});
 		}
 	}
 
@@ -651,7 +1359,9 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 	const string geom_name = geominfo["name"];
 	auto analysisTime = resultInfo.Time().OriginDateTime().String("%Y-%m-%d %H:%M:%S+00");
 
-	auto tableinfo = itsRadonDB->GetTableName(resultInfo.Producer().Id(), analysisTime, geom_name);
+	auto tableinfo =
+	    Memoize(tableCache, to_string(resultInfo.Producer().Id()) + "_" + analysisTime + "_" + geom_name,
+	            [&]() { return itsRadonDB->GetTableName(resultInfo.Producer().Id(), analysisTime, geom_name); });
 
 	if (tableinfo.empty())
 	{
@@ -663,8 +1373,6 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 	const string table_name = tableinfo["partition_name"];
 	const string record_count = tableinfo["record_count"];
 
-	query.str("");
-
 	string host;
 
 	switch (finfo.storage_type)
@@ -692,12 +1400,13 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 		himan::Abort();
 	}
 
-	auto levelinfo = itsRadonDB->GetLevelFromDatabaseName(HPLevelTypeToString.at(resultInfo.Level().Type()));
+	const string levelName = HPLevelTypeToString.at(resultInfo.Level().Type());
+	auto levelinfo =
+	    Memoize(levelCache, levelName, [&]() { return itsRadonDB->GetLevelFromDatabaseName(levelName); });
 
 	if (levelinfo.empty())
 	{
-		itsLogger.Error("Level information not found from radon for level " +
-		                HPLevelTypeToString.at(resultInfo.Level().Type()) + ", producer " +
+		itsLogger.Error("Level information not found from radon for level " + levelName + ", producer " +
 		                to_string(resultInfo.Producer().Id()));
 		return false;
 	}
@@ -709,11 +1418,6 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 		return false;
 	}
 
-	/*
-	 * We have our own error logging for unique key violations
-	 */
-
-	// itsRadonDB->Verbose(false);
 	int forecastTypeValue = -1;  // default, deterministic/analysis
 
 	if (resultInfo.ForecastType().Type() >= 3 && resultInfo.ForecastType().Type() <= 4)
@@ -733,69 +1437,67 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 		return "NULL";
 	};
 
-	query
-	    << "INSERT INTO " << fullTableName
-	    << " (producer_id, analysis_time, geometry_id, param_id, level_id, level_value, level_value2, forecast_period, "
-	    << "forecast_type_id, forecast_type_value, file_location, file_server, file_format_id, file_protocol_id, "
-	    << "message_no, byte_offset, byte_length) VALUES (" << resultInfo.Producer().Id() << ", "
-	    << "'" << analysisTime << "', " << geom_id << ", " << resultInfo.Param().Id() << ", " << levelinfo["id"] << ", "
-	    << resultInfo.Level().Value() << ", " << levelValue2 << ", "
-	    << "'" << util::MakeSQLInterval(resultInfo.Time()) << "', "
-	    << static_cast<int>(resultInfo.ForecastType().Type()) << ", " << forecastTypeValue << ","
-	    << "'" << finfo.file_location << "', "
-	    << "'" << host << "', " << finfo.file_type << ", " << finfo.storage_type << ", "
-	    << FormatToSQL(finfo.message_no) << ", " << FormatToSQL(finfo.offset) << ", " << FormatToSQL(finfo.length)
-	    << ")";
+	grid_row row;
 
-	try
-	{
-		itsRadonDB->Execute(query.str());
-		itsRadonDB->Commit();
+	query << resultInfo.Producer().Id() << ", "
+	      << "'" << analysisTime << "', " << geom_id << ", " << resultInfo.Param().Id() << ", " << levelinfo["id"] << ", "
+	      << resultInfo.Level().Value() << ", " << levelValue2 << ", "
+	      << "'" << util::MakeSQLInterval(resultInfo.Time()) << "', "
+	      << static_cast<int>(resultInfo.ForecastType().Type()) << ", " << forecastTypeValue << ","
+	      << "'" << finfo.file_location << "', "
+	      << "'" << host << "', " << finfo.file_type << ", " << finfo.storage_type << ", "
+	      << FormatToSQL(finfo.message_no) << ", " << FormatToSQL(finfo.offset) << ", " << FormatToSQL(finfo.length);
 
-		// After first insert set record_count to 1, to mark that this partition has data
+	row.values = query.str();
 
-		if (record_count == "0")
-		{
-			itsLogger.Trace("Updating as_grid record_count column for " + fullTableName);
+	query.str("");
+	query << "file_location = '" << finfo.file_location << "', "
+	      << "file_server = '" << host << "', "
+	      << "file_format_id = " << finfo.file_type << ", "
+	      << "file_protocol_id = " << finfo.storage_type << ", "
+	      << "message_no = " << FormatToSQL(finfo.message_no) << ", "
+	      << "byte_offset = " << FormatToSQL(finfo.offset) << ", "
+	      << "byte_length = " << FormatToSQL(finfo.length);
 
-			query.str("");
-			query << "UPDATE as_grid SET record_count = 1 WHERE schema_name = '" << schema_name
-			      << "' AND partition_name = '" << table_name << "'";
+	row.fileColumns = query.str();
+
+	query.str("");
+	query << "producer_id = " << resultInfo.Producer().Id() << " AND "
+	      << "analysis_time = '" << analysisTime << "' AND "
+	      << "geometry_id = " << geom_id << " AND "
+	      << "param_id = " << resultInfo.Param().Id() << " AND "
+	      << "level_id = " << levelinfo["id"] << " AND "
+	      << "level_value = " << resultInfo.Level().Value() << " AND "
+	      << "level_value2 = " << levelValue2 << " AND "
+	      << "forecast_period = "
+	      << "'" << util::MakeSQLInterval(resultInfo.Time()) << "' AND "
+	      << "forecast_type_id = " << static_cast<int>(resultInfo.ForecastType().Type()) << " AND "
+	      << "forecast_type_value = " << forecastTypeValue;
+
+	row.keyCondition = query.str();
+	row.indexKey =
+	    FileIndexParamKey(resultInfo.Producer().Id(), resultInfo.Time().OriginDateTime(), resultInfo.Param().Name());
+
+	bool flush = false;
 
-			itsRadonDB->Execute(query.str());
-		}
-	}
-	catch (const pqxx::unique_violation& e)
 	{
-		itsRadonDB->Rollback();
+		lock_guard<mutex> lock(batchMutex);
 
-		query.str("");
-		query << "UPDATE " << fullTableName << " SET "
-		      << "file_location = '" << finfo.file_location << "', "
-		      << "file_server = '" << host << "', "
-		      << "file_format_id = " << finfo.file_type << ", "
-		      << "file_protocol_id = " << finfo.storage_type << ", "
-		      << "message_no = " << FormatToSQL(finfo.message_no) << ", "
-		      << "byte_offset = " << FormatToSQL(finfo.offset) << ", "
-		      << "byte_length = " << FormatToSQL(finfo.length) << " WHERE "
-		      << "producer_id = " << resultInfo.Producer().Id() << " AND "
-		      << "analysis_time = '" << analysisTime << "' AND "
-		      << "geometry_id = " << geom_id << " AND "
-		      << "param_id = " << resultInfo.Param().Id() << " AND "
-		      << "level_id = " << levelinfo["id"] << " AND "
-		      << "level_value = " << resultInfo.Level().Value() << " AND "
-		      << "level_value2 = " << levelValue2 << " AND "
-		      << "forecast_period = "
-		      << "'" << util::MakeSQLInterval(resultInfo.Time()) << "' AND "
-		      << "forecast_type_id = " << static_cast<int>(resultInfo.ForecastType().Type()) << " AND "
-		      << "forecast_type_value = " << forecastTypeValue;
-
-		itsRadonDB->Execute(query.str());
-		itsRadonDB->Commit();
+		if (finfo.storage_type == kS3ObjectStorageSystem && s3::IsIncompleteObject(finfo.file_location))
+		{
+			heldRows[finfo.file_location].push_back({fullTableName, schema_name, table_name, record_count == "0", row});
+		}
+		else
+		{
+			QueueRow(fullTableName, schema_name, table_name, record_count == "0", row);
+			flush = (pendingRows >= BatchSize() || chrono::steady_clock::now() - oldestPendingRow >= maxBatchAge);
+		}
 	}
 
+	StartFlusher();
+
 	query.str("");
-	query << "Saved information on file '" << finfo.file_location << "'";
+	query << "Queued information on file '" << finfo.file_location << "'";
 
 	if (finfo.message_no)
 	{
@@ -804,8 +1506,153 @@ bool radon::SaveGrid(const info<T>& resultInfo, const file_information& finfo, c
 
 	itsLogger.Trace(query.str());
 
+	if (flush)
+	{
+		Flush();
+	}
+
 	return true;
 }
 
 template bool radon::SaveGrid<double>(const info<double>&, const file_information&, const string&);
 template bool radon::SaveGrid<float>(const info<float>&, const file_information&, const string&);
+
+void radon::Flush()
+{
+	lock_guard<mutex> flushLock(flushMutex);
+
+	string earlierError;
+
+	{
+		lock_guard<mutex> lock(flushErrorMutex);
+		swap(earlierError, flushError);
+	}
+
+	map<string, table_batch> flushed;
+
+	{
+		lock_guard<mutex> lock(batchMutex);
+		ReleaseHeldRows();
+		swap(flushed, batches);
+		pendingRows = 0;
+	}
+
+	set<string> indexKeys;
+	auto tableIt = flushed.begin();
+
+	try
+	{
+		if (!flushed.empty())
+		{
+			Init();
+		}
+
+		for (; tableIt != flushed.end(); ++tableIt)
+		{
+			const string& fullTableName = tableIt->first;
+			const table_batch& batch = tableIt->second;
+
+			stringstream query;
+
+			query << "INSERT INTO " << fullTableName << " (" << gridColumns << ") VALUES ";
+
+			for (auto it = batch.rows.begin(); it != batch.rows.end(); ++it)
+			{
+				query << (it == batch.rows.begin() ? "" : ", ") << "(" << it->second.values << ")";
+			}
+
+			query << " ON CONFLICT (" << gridKeyColumns << ") DO UPDATE SET "
+			      << "file_location = EXCLUDED.file_location, file_server = EXCLUDED.file_server, "
+			      << "file_format_id = EXCLUDED.file_format_id, file_protocol_id = EXCLUDED.file_protocol_id, "
+			      << "message_no = EXCLUDED.message_no, byte_offset = EXCLUDED.byte_offset, "
+			      << "byte_length = EXCLUDED.byte_length";
+
+			try
+			{
+				itsRadonDB->Execute(query.str());
+				itsRadonDB->Commit();
+			}
+			catch (const pqxx::sql_error& e)
+			{
+				// Table might not have a unique index matching the key columns: save
+				// rows one by one, updating the rows that exist already
+
+				itsRadonDB->Rollback();
+				itsLogger.Warning("Batch insert to " + fullTableName +
+				                  " failed, saving rows one by one: " + e.what());
+
+				for (const auto& row : batch.rows)
+				{
+					try
+					{
+						itsRadonDB->Execute("INSERT INTO " + fullTableName + " (" + gridColumns + ") VALUES (" +
+						                    row.second.values + ")");
+						itsRadonDB->Commit();
+					}
+					catch (const pqxx::unique_violation&)
+					{
+						itsRadonDB->Rollback();
+						itsRadonDB->Execute("UPDATE " + fullTableName + " SET " + row.second.fileColumns +
+						                    " WHERE " + row.second.keyCondition);
+						itsRadonDB->Commit();
+					}
+				}
+			}
+
+			// After first insert set record_count to 1, to mark that this partition has data
+
+			if (batch.firstRecords)
+			{
+				itsLogger.Trace("Updating as_grid record_count column for " + fullTableName);
+
+				itsRadonDB->Execute("UPDATE as_grid SET record_count = 1 WHERE schema_name = '" +
+				                    batch.schemaName + "' AND partition_name = '" + batch.partitionName + "'");
+				itsRadonDB->Commit();
+
+				lock_guard<mutex> lock(lookupMutex);
+
+				for (auto& table : tableCache)
+				{
+					if (table.second["schema_name"] == batch.schemaName &&
+					    table.second["partition_name"] == batch.partitionName)
+					{
+						table.second["record_count"] = "1";
+					}
+				}
+			}
+
+			itsLogger.Debug("Saved " + to_string(batch.rows.size()) + " rows to " + fullTableName);
+
+			for (const auto& row : batch.rows)
+			{
+				indexKeys.insert(row.second.indexKey);
+			}
+		}
+	}
+	catch (...)
+	{
+		// Rows of this table and the following ones are written by the next flush
+
+		if (itsRadonDB)
+		{
+			try
+			{
+				itsRadonDB->Rollback();
+			}
+			catch (...)
+			{
+			}
+		}
+
+		RequeueBatches(map<string, table_batch>(tableIt, flushed.end()));
+		InvalidateFileIndex(indexKeys);
+		throw;
+	}
+
+	InvalidateFileIndex(indexKeys);
+
+	if (!earlierError.empty())
+	{
+		throw runtime_error("Writing rows to radon failed earlier: " + earlierError);
+	}
+}
@@ -181,6 +181,18 @@ void stability::Process(std::shared_ptr<const plugin_configuration> conf)
 	SetParams({QParam}, {HalfKMLevel});
 	SetParams({EBSParam}, {MaxWindLevel});
 
+	// Inputs that are read from fixed levels of the calculated time. Profiles
+	// that hitool reads from a range of levels are not prefetched.
+
+	const param CAPEParam("CAPE-JKG");
+	const param ELParam("EL-LAST-M");
+
+	Prefetch({prefetch_input(TParam, P850Level), prefetch_input(TDParam, P850Level), prefetch_input(TParam, P500Level),
+	          prefetch_input(CAPEParam, HalfKMLevel), prefetch_input(CAPEParam, MaxThetaELevel),
+	          prefetch_input(ELParam, HalfKMLevel), prefetch_input(ELParam, MaxThetaELevel),
+	          prefetch_input(param("LPL-M"), MaxThetaELevel), prefetch_input(UParam, itsBottomLevel),
+	          prefetch_input(VParam, itsBottomLevel), prefetch_input(HLParam, itsBottomLevel)});
+
 	Start();
 }
 
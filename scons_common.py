@@ -57,6 +57,13 @@ AddOption(
     help='no cuda build',
     default=False)
 
+AddOption(
+    '--luajit-build',
+    dest='luajit-build',
+    action='store_true',
+    help='build also a luajit version of luatool',
+    default=False)
+
 # Check build
 
 NOCUDA = GetOption('no-cuda-build')
@@ -85,6 +92,14 @@ env['HAVE_CUDA'] = False
 if not NOCUDA and os.path.isfile(cuda_toolkit_path + '/lib64/libcudart.so'):
         env['HAVE_CUDA'] = True
 
+# LuaJIT: luabind must be built against LuaJIT as well, library names
+# and include path can be changed with environment variables
+
+env['HAVE_LUAJIT'] = GetOption('luajit-build')
+env['LUAJIT_INCLUDE'] = os.environ.get('LUAJIT_INCLUDE', '/usr/include/luajit-2.1')
+env['LUAJIT_LIB'] = os.environ.get('LUAJIT_LIB', 'luajit-5.1')
+env['LUAJIT_LUABIND_LIB'] = os.environ.get('LUAJIT_LUABIND_LIB', 'luabind-luajit')
+
 env['HAVE_S3'] = False
 
 if os.path.isfile('/usr/include/libs3.h'):